@@ -0,0 +1,495 @@
+// Host microbenchmarks for the pixel buffer operations in displayFastLedCommon.cpp,
+// against the simulated FastLED in sim/ (no kernel is run, so nothing here
+// takes simulated time).
+//
+//      fastled_bench [--reps N] [--batch-ms MS] [--filter TEXT] [--json] [--cpu N]
+//
+// --reps       Timed batches per benchmark (default 21); the median is reported.
+// --batch-ms   Each batch runs the operation for at least this long (default 5).
+// --filter     Only run benchmarks whose name contains TEXT.
+// --json       One JSON object per line instead of CSV.
+// --cpu        Pin to that CPU first (Linux), which steadies the numbers.
+//
+// Two sets, over our strands and matrices (256/256/470/470):
+//   api/...    The display layer itself (clear_all_leds(), paint_random_leds(),
+//              fastLedArenaFill() etc.), on its arena, so layout and algorithm
+//              changes to displayFastLedCommon.cpp show up here.
+//   raw/...    The same primitives on buffers of our sizes (x1) and of four
+//              times them (x4), to show how each one scales.
+// Blend and copy go between the pairs (left strand into right and so on).
+// The matrix set (fastLedMatrix.cpp) does a fill rect, blit and scrolls on
+// both matrices, as api/matrix_... on the arena and as raw/matrix_xy_... with
+// an XY() per pixel, the way the FastLED examples do it, for comparison.
+// The ingest set (fastLedIngestFormat.cpp) takes a matrix sized packet of
+// each encoding into both matrices as the ESP32 does, the payload check and
+// then the decode: raw random LEDs, RLE of runs of 1 to 16, and an XOR
+// delta with one LED in 16 changed.
+//
+// CSV columns (the first line is the header):
+//      name,scale,leds,iterations,median_ns,min_ns,max_ns,ns_per_led,checksum
+// Times are per call of the operation.  The checksum is of the buffers
+// after one call from a fixed start (the same on every run), so it only
+// changes when the results do.
+// Build: pio run -e native_bench (then .pio/build/native_bench/program) or
+//      g++ -std=gnu++17 -O2 -DFASTLED_SIM -I sim -I src src/*.cpp sim/sim_arduino.cpp sim/sim_fastled.cpp
+//          sim/sim_kernel.cpp bench/bench_main.cpp -pthread -o fastled_bench
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+#include "fastLedMatrix.h"
+#include "fastLedIngestFormat.h"
+#include "fastLedRandomFill.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#ifdef __linux__
+# include <sched.h>
+#endif
+
+#define BENCH_STRANDS       4
+#define BENCH_BLEND_AMOUNT  96
+#define BENCH_SCALE         250     // Close to 255 so repeated scaling doesn't just go to black at once.
+
+static const uint16_t benchStrandLengths[BENCH_STRANDS] = { 256, 256, 470, 470 };
+
+typedef struct
+    {
+    uint32_t reps;
+    uint32_t batchMs;
+    const char* filter;
+    bool bJson;
+    } BenchOptions;
+
+// A whole layout (four strands, one after the other) for the raw benchmarks.
+typedef struct
+    {
+    std::vector<CRGB> leds;
+    CRGB* strands[BENCH_STRANDS];
+    uint16_t lengths[BENCH_STRANDS];
+    } BenchLayout;
+
+static BenchOptions benchOptions = { 21, 5, NULL, false };
+static bool bBenchHeaderDone = false;
+
+
+static void benchLayoutInit(BenchLayout* layout, uint8_t multiple)
+    {
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < BENCH_STRANDS; i++)
+        {
+        layout->lengths[i] = benchStrandLengths[i] * multiple;
+        total += layout->lengths[i];
+        }
+    layout->leds.assign(total, CRGB(0, 0, 0));
+    CRGB* strand = layout->leds.data();
+    for (uint8_t i = 0; i < BENCH_STRANDS; i++)
+        {
+        layout->strands[i] = strand;
+        strand += layout->lengths[i];
+        }
+    }
+
+/// @brief FNV-1a over some LEDs, as the simulation's wire hash.
+static uint32_t benchChecksum(const CRGB* leds, uint32_t count)
+    {
+    uint32_t hash = 2166136261UL;
+    const uint8_t* bytes = (const uint8_t*) leds;
+    for (uint32_t i = 0; i < count * sizeof(CRGB); i++)
+        {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+        }
+    return(hash);
+    }
+
+static uint64_t benchNowNs(void)
+    {
+    return((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+/// @brief Times operation (which works on leds LEDs) and prints a line for it.
+/// start puts its buffers (and generator) in a fixed state, then one call
+/// of operation gives the checksum (from check).  The batch size is worked
+/// out once, from a warm up, so every batch does the same work.
+static void benchRun(const char* name, const char* scale, uint32_t leds, const std::function<void(void)>& start,
+                     const std::function<void(void)>& operation, const std::function<uint32_t(void)>& check)
+    {
+    if (benchOptions.filter != NULL && strstr(name, benchOptions.filter) == NULL)
+        {
+        return;
+        }
+    start();
+    operation();
+    uint32_t checksum = check();
+
+    // Warm up (caches, branch predictors and the CPU clock), and size the batch.
+    uint64_t batchNs = (uint64_t) benchOptions.batchMs * 1000000;
+    uint32_t iterations = 1;
+    while (true)
+        {
+        uint64_t startNs = benchNowNs();
+        for (uint32_t i = 0; i < iterations; i++)
+            {
+            operation();
+            }
+        uint64_t elapsedNs = benchNowNs() - startNs;
+        if (elapsedNs >= batchNs)
+            {
+            break;
+            }
+        iterations = (elapsedNs < batchNs / 64) ? iterations * 8 : iterations * 2;
+        }
+
+    std::vector<double> perCallNs;
+    for (uint32_t rep = 0; rep < benchOptions.reps; rep++)
+        {
+        uint64_t startNs = benchNowNs();
+        for (uint32_t i = 0; i < iterations; i++)
+            {
+            operation();
+            }
+        perCallNs.push_back((double) (benchNowNs() - startNs) / iterations);
+        }
+    std::sort(perCallNs.begin(), perCallNs.end());
+    double medianNs = perCallNs[perCallNs.size() / 2];
+
+    if (benchOptions.bJson)
+        {
+        printf("{\"name\":\"%s\",\"scale\":\"%s\",\"leds\":%u,\"iterations\":%u,\"median_ns\":%.1f,"
+               "\"min_ns\":%.1f,\"max_ns\":%.1f,\"ns_per_led\":%.3f,\"checksum\":\"%08x\"}\n",
+               name, scale, leds, iterations, medianNs, perCallNs.front(), perCallNs.back(), medianNs / leds, checksum);
+        }
+    else
+        {
+        if (!bBenchHeaderDone)
+            {
+            printf("name,scale,leds,iterations,median_ns,min_ns,max_ns,ns_per_led,checksum\n");
+            bBenchHeaderDone = true;
+            }
+        printf("%s,%s,%u,%u,%.1f,%.1f,%.1f,%.3f,%08x\n",
+               name, scale, leds, iterations, medianNs, perCallNs.front(), perCallNs.back(), medianNs / leds, checksum);
+        }
+    fflush(stdout);
+    }
+
+
+/// @brief The display layer's own operations, on its arena.
+static void benchArena(void)
+    {
+    uint16_t arenaLeds = fastLedArenaSize();
+    std::function<uint32_t(void)> check = [arenaLeds] { return(benchChecksum(fastLedArenaLeds(), arenaLeds)); };
+    static std::vector<CRGB> source(arenaLeds);
+    FastLedRandom random = { FASTLED_RANDOM_DEFAULT_SEED };
+    fastLedRandomFill(&random, (uint8_t*) source.data(), source.size() * sizeof(CRGB));
+    std::function<void(void)> fromSource = [] { fastLedArenaCopy(source.data()); };
+    std::function<void(void)> reseed = [] { paint_random_leds_seed(FASTLED_RANDOM_DEFAULT_SEED); };
+
+    benchRun("api/clear_all_leds", "x1", arenaLeds, fromSource, [] { clear_all_leds(); }, check);
+    benchRun("api/paint_random_leds", "x1", arenaLeds, reseed, [] { paint_random_leds(); }, check);
+    benchRun("api/fill", "x1", arenaLeds, fromSource, [] { fastLedArenaFill(CRGB(32, 64, 128)); }, check);
+    benchRun("api/scale", "x1", arenaLeds, fromSource, [] { fastLedArenaScale(BENCH_SCALE); }, check);
+    benchRun("api/copy", "x1", arenaLeds, [] { clear_all_leds(); }, fromSource, check);
+
+    // Between the pairs of segments (strands, then matrices).
+    benchRun("api/blend_segments", "x1", arenaLeds, fromSource, []
+        {
+        for (uint8_t i = 0; i + 1 < fastLedSegmentCount(); i += 2)
+            {
+            const CRGB* from = fastLedSegmentLeds(i);
+            CRGB* to = fastLedSegmentLeds(i + 1);
+            blend(to, from, to, fastLedGetSegment(i + 1)->length, BENCH_BLEND_AMOUNT);
+            }
+        }, check);
+    benchRun("api/copy_segments", "x1", arenaLeds, fromSource, []
+        {
+        for (uint8_t i = 0; i + 1 < fastLedSegmentCount(); i += 2)
+            {
+            memcpy(fastLedSegmentLeds(i + 1), fastLedSegmentLeds(i), fastLedGetSegment(i + 1)->length * sizeof(CRGB));
+            }
+        }, check);
+    }
+
+/// @brief The same primitives on a layout of our sizes times multiple.
+static void benchRaw(uint8_t multiple)
+    {
+    static BenchLayout layout;
+    static std::vector<CRGB> source;
+    static FastLedRandom random;
+    benchLayoutInit(&layout, multiple);
+    static CRGB* leds;
+    static uint32_t count;
+    leds = layout.leds.data();
+    count = (uint32_t) layout.leds.size();
+    source.resize(count);
+    fastLedRandomSeed(&random, FASTLED_RANDOM_DEFAULT_SEED);
+    fastLedRandomFill(&random, (uint8_t*) source.data(), source.size() * sizeof(CRGB));
+    char scale[8];
+    snprintf(scale, sizeof(scale), "x%u", multiple);
+    std::function<uint32_t(void)> check = [] { return(benchChecksum(leds, count)); };
+    std::function<void(void)> fromSource = [] { memcpy(leds, source.data(), count * sizeof(CRGB)); };
+
+    benchRun("raw/clear", scale, count, fromSource, [] { memset(leds, 0, count * sizeof(CRGB)); }, check);
+    benchRun("raw/random_fill", scale, count, [] { fastLedRandomSeed(&random, FASTLED_RANDOM_DEFAULT_SEED); },
+             [] { fastLedRandomFill(&random, (uint8_t*) leds, count * sizeof(CRGB)); }, check);
+    benchRun("raw/fill_solid", scale, count, fromSource, [] { fill_solid(leds, count, CRGB(32, 64, 128)); }, check);
+    benchRun("raw/nscale8", scale, count, fromSource, [] { nscale8(leds, count, BENCH_SCALE); }, check);
+    benchRun("raw/copy", scale, count, [] { memset(leds, 0, count * sizeof(CRGB)); }, fromSource, check);
+    benchRun("raw/blend_strands", scale, count, fromSource, []
+        {
+        for (uint8_t i = 0; i + 1 < BENCH_STRANDS; i += 2)
+            {
+            blend(layout.strands[i + 1], layout.strands[i], layout.strands[i + 1], layout.lengths[i + 1], BENCH_BLEND_AMOUNT);
+            }
+        }, check);
+    benchRun("raw/copy_strands", scale, count, fromSource, []
+        {
+        for (uint8_t i = 0; i + 1 < BENCH_STRANDS; i += 2)
+            {
+            memcpy(layout.strands[i + 1], layout.strands[i], layout.lengths[i + 1] * sizeof(CRGB));
+            }
+        }, check);
+    }
+
+
+/// @brief XY() worked out per pixel, as in the FastLED examples.
+static inline uint16_t benchXY(uint8_t x, uint8_t y)
+    {
+    if (FASTLED_MATRIX_LAYOUT == FASTLED_MATRIX_SERPENTINE && (y & 1))
+        {
+        return((uint16_t) (y * FASTLED_MATRIX_WIDTH + FASTLED_MATRIX_WIDTH - 1 - x));
+        }
+    return((uint16_t) (y * FASTLED_MATRIX_WIDTH + x));
+    }
+
+/// @brief The matrix layer on both matrices, and the same by XY() per pixel.
+static void benchMatrix(void)
+    {
+    static const uint8_t matrices[] = { FASTLED_MATRIX_LEFT, FASTLED_MATRIX_RIGHT };
+    const uint32_t matrixLeds = FASTLED_MATRIX_WIDTH * FASTLED_MATRIX_HEIGHT;
+    static std::vector<CRGB> image(matrixLeds);
+    FastLedRandom random = { FASTLED_RANDOM_DEFAULT_SEED };
+    fastLedRandomFill(&random, (uint8_t*) image.data(), image.size() * sizeof(CRGB));
+    static std::vector<CRGB> source(fastLedArenaSize());
+    fastLedRandomFill(&random, (uint8_t*) source.data(), source.size() * sizeof(CRGB));
+    uint16_t arenaLeds = fastLedArenaSize();
+    std::function<uint32_t(void)> check = [arenaLeds] { return(benchChecksum(fastLedArenaLeds(), arenaLeds)); };
+    std::function<void(void)> fromSource = [] { fastLedArenaCopy(source.data()); };
+
+    benchRun("api/matrix_fill_rect", "x1", 2 * matrixLeds, fromSource, []
+        {
+        for (uint8_t matrix : matrices)
+            {
+            fastLedMatrixFillRect(matrix, 1, 1, FASTLED_MATRIX_WIDTH - 2, FASTLED_MATRIX_HEIGHT - 2, CRGB(32, 64, 128));
+            }
+        }, check);
+    benchRun("api/matrix_blit", "x1", 2 * matrixLeds, fromSource, []
+        {
+        for (uint8_t matrix : matrices)
+            {
+            fastLedMatrixBlit(matrix, 0, 0, image.data(), FASTLED_MATRIX_WIDTH, FASTLED_MATRIX_HEIGHT, FASTLED_MATRIX_WIDTH);
+            }
+        }, check);
+    benchRun("api/matrix_scroll_x", "x1", 2 * matrixLeds, fromSource, []
+        {
+        for (uint8_t matrix : matrices)
+            {
+            fastLedMatrixScroll(matrix, -1, 0, CRGB::Black);
+            }
+        }, check);
+    benchRun("api/matrix_scroll_y", "x1", 2 * matrixLeds, fromSource, []
+        {
+        for (uint8_t matrix : matrices)
+            {
+            fastLedMatrixScroll(matrix, 0, -1, CRGB::Black);
+            }
+        }, check);
+
+    static std::vector<CRGB> leds(2 * matrixLeds);
+    std::function<uint32_t(void)> checkRaw = [] { return(benchChecksum(leds.data(), (uint32_t) leds.size())); };
+    std::function<void(void)> fromSourceRaw = [] { memcpy(leds.data(), source.data(), leds.size() * sizeof(CRGB)); };
+    benchRun("raw/matrix_xy_fill_rect", "x1", 2 * matrixLeds, fromSourceRaw, []
+        {
+        for (uint8_t matrix = 0; matrix < 2; matrix++)
+            {
+            CRGB* pixels = leds.data() + matrix * matrixLeds;
+            for (uint8_t y = 1; y < FASTLED_MATRIX_HEIGHT - 1; y++)
+                {
+                for (uint8_t x = 1; x < FASTLED_MATRIX_WIDTH - 1; x++)
+                    {
+                    pixels[benchXY(x, y)] = CRGB(32, 64, 128);
+                    }
+                }
+            }
+        }, checkRaw);
+    benchRun("raw/matrix_xy_blit", "x1", 2 * matrixLeds, fromSourceRaw, []
+        {
+        for (uint8_t matrix = 0; matrix < 2; matrix++)
+            {
+            CRGB* pixels = leds.data() + matrix * matrixLeds;
+            for (uint8_t y = 0; y < FASTLED_MATRIX_HEIGHT; y++)
+                {
+                for (uint8_t x = 0; x < FASTLED_MATRIX_WIDTH; x++)
+                    {
+                    pixels[benchXY(x, y)] = image[y * FASTLED_MATRIX_WIDTH + x];
+                    }
+                }
+            }
+        }, checkRaw);
+    benchRun("raw/matrix_xy_scroll_x", "x1", 2 * matrixLeds, fromSourceRaw, []
+        {
+        for (uint8_t matrix = 0; matrix < 2; matrix++)
+            {
+            CRGB* pixels = leds.data() + matrix * matrixLeds;
+            for (uint8_t y = 0; y < FASTLED_MATRIX_HEIGHT; y++)
+                {
+                for (uint8_t x = 0; x + 1 < FASTLED_MATRIX_WIDTH; x++)
+                    {
+                    pixels[benchXY(x, y)] = pixels[benchXY(x + 1, y)];
+                    }
+                pixels[benchXY(FASTLED_MATRIX_WIDTH - 1, y)] = CRGB::Black;
+                }
+            }
+        }, checkRaw);
+    benchRun("raw/matrix_xy_scroll_y", "x1", 2 * matrixLeds, fromSourceRaw, []
+        {
+        for (uint8_t matrix = 0; matrix < 2; matrix++)
+            {
+            CRGB* pixels = leds.data() + matrix * matrixLeds;
+            for (uint8_t y = 0; y + 1 < FASTLED_MATRIX_HEIGHT; y++)
+                {
+                for (uint8_t x = 0; x < FASTLED_MATRIX_WIDTH; x++)
+                    {
+                    pixels[benchXY(x, y)] = pixels[benchXY(x, y + 1)];
+                    }
+                }
+            for (uint8_t x = 0; x < FASTLED_MATRIX_WIDTH; x++)
+                {
+                pixels[benchXY(x, FASTLED_MATRIX_HEIGHT - 1)] = CRGB::Black;
+                }
+            }
+        }, checkRaw);
+    }
+
+
+/// @brief A packet's payload check and decode into both matrices, as fastLedIngestTask().
+static void benchIngest(void)
+    {
+    static const uint8_t matrices[] = { FASTLED_MATRIX_LEFT, FASTLED_MATRIX_RIGHT };
+    const uint16_t matrixLeds = FASTLED_MATRIX_WIDTH * FASTLED_MATRIX_HEIGHT;
+    FastLedRandom random = { FASTLED_RANDOM_DEFAULT_SEED };
+    static std::vector<CRGB> source(fastLedArenaSize());
+    fastLedRandomFill(&random, (uint8_t*) source.data(), source.size() * sizeof(CRGB));
+    const CRGB* before = source.data() + fastLedGetSegment(FASTLED_MATRIX_LEFT)->offset;
+    std::vector<CRGB> runs(matrixLeds);
+    for (uint16_t i = 0; i < matrixLeds; )
+        {
+        uint16_t run = 1 + fastLedRandomNext(&random) % 16;
+        CRGB colour = CRGB(fastLedRandomNext(&random));
+        for (; run > 0 && i < matrixLeds; run--)
+            {
+            runs[i++] = colour;
+            }
+        }
+    std::vector<CRGB> changed(before, before + matrixLeds);
+    for (uint16_t i = 0; i < matrixLeds / 16; i++)
+        {
+        changed[fastLedRandomNext(&random) % matrixLeds] = CRGB(fastLedRandomNext(&random));
+        }
+    static uint8_t payloads[INGEST_ENCODINGS][INGEST_MAX_PAYLOAD_BYTES];
+    static uint16_t payloadBytes[INGEST_ENCODINGS];
+    static uint16_t payloadChecks[INGEST_ENCODINGS];
+    payloadBytes[INGEST_RAW] = (uint16_t) ingestEncodeRaw((const uint8_t*) changed.data(), matrixLeds,
+                                                          payloads[INGEST_RAW], INGEST_MAX_PAYLOAD_BYTES);
+    payloadBytes[INGEST_RLE] = (uint16_t) ingestEncodeRle((const uint8_t*) runs.data(), matrixLeds,
+                                                          payloads[INGEST_RLE], INGEST_MAX_PAYLOAD_BYTES);
+    payloadBytes[INGEST_XOR] = (uint16_t) ingestEncodeXor((const uint8_t*) changed.data(), (const uint8_t*) before, matrixLeds,
+                                                          payloads[INGEST_XOR], INGEST_MAX_PAYLOAD_BYTES);
+    for (uint8_t encoding = 0; encoding < INGEST_ENCODINGS; encoding++)
+        {
+        payloadChecks[encoding] = ingestPayloadCheck(payloads[encoding], payloadBytes[encoding]);
+        }
+    uint16_t arenaLeds = fastLedArenaSize();
+    std::function<uint32_t(void)> check = [arenaLeds] { return(benchChecksum(fastLedArenaLeds(), arenaLeds)); };
+    // Both matrices start as the left one of source, so the delta applies to either.
+    std::function<void(void)> fromSource = [before, matrixLeds]
+        {
+        fastLedArenaCopy(source.data());
+        for (uint8_t matrix : matrices)
+            {
+            memcpy(fastLedSegmentLeds(matrix), before, matrixLeds * sizeof(CRGB));
+            }
+        };
+
+    static const char* const names[INGEST_ENCODINGS] = { "api/ingest_raw", "api/ingest_rle", "api/ingest_xor" };
+    for (uint8_t encoding = 0; encoding < INGEST_ENCODINGS; encoding++)
+        {
+        benchRun(names[encoding], "x1", 2 * matrixLeds, fromSource, [encoding, matrixLeds]
+            {
+            for (uint8_t matrix : matrices)
+                {
+                if (ingestPayloadCheck(payloads[encoding], payloadBytes[encoding]) != payloadChecks[encoding]
+                    || ingestDecode(encoding, payloads[encoding], payloadBytes[encoding],
+                                    (uint8_t*) fastLedSegmentLeds(matrix), matrixLeds) != INGEST_OK)
+                    {
+                    fprintf(stderr, "%s didn't decode\n", names[encoding]);
+                    exit(1);
+                    }
+                }
+            }, check);
+        }
+    }
+
+
+int main(int argc, char** argv)
+    {
+    for (int i = 1; i < argc; i++)
+        {
+        std::string arg = argv[i];
+        if (arg == "--reps" && i + 1 < argc)
+            {
+            benchOptions.reps = std::max(1UL, strtoul(argv[++i], NULL, 10));
+            }
+        else if (arg == "--batch-ms" && i + 1 < argc)
+            {
+            benchOptions.batchMs = std::max(1UL, strtoul(argv[++i], NULL, 10));
+            }
+        else if (arg == "--filter" && i + 1 < argc)
+            {
+            benchOptions.filter = argv[++i];
+            }
+        else if (arg == "--json")
+            {
+            benchOptions.bJson = true;
+            }
+        else if (arg == "--cpu" && i + 1 < argc)
+            {
+            int cpu = atoi(argv[++i]);
+#ifdef __linux__
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+                {
+                fprintf(stderr, "can't pin to CPU %d\n", cpu);
+                }
+#else
+            fprintf(stderr, "--cpu %d ignored, Linux only\n", cpu);
+#endif
+            }
+        else
+            {
+            fprintf(stderr, "usage: %s [--reps N] [--batch-ms MS] [--filter TEXT] [--json] [--cpu N]\n", argv[0]);
+            return(1);
+            }
+        }
+
+    benchArena();
+    benchRaw(1);
+    benchRaw(4);
+    benchMatrix();
+    benchIngest();
+    return(0);
+    }
@@ -0,0 +1,107 @@
+#ifndef _SIM_ARDUINO_H_
+#define _SIM_ARDUINO_H_
+
+// Just enough of Arduino-ESP32 to build the firmware on the host (the native
+// environment in platformio.ini).  Time is simulated, see sim_kernel.h.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define IRAM_ATTR
+// RTC_NOINIT_ATTR variables go in their own section, which sim_main can
+// load from and save to a file (--rtc) as if it survived a reset.
+#define RTC_NOINIT_ATTR     __attribute__((section("sim_rtc_noinit")))
+#define DRAM_ATTR
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LOW     0
+#define HIGH    1
+#define INPUT   0x01
+#define OUTPUT  0x03
+#define SERIAL_8N1 0x800001c
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class Print
+    {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size);
+        size_t write(const char* text) { return(write((const uint8_t*) text, strlen(text))); }
+
+        size_t print(const char text[]) { return(write(text)); }
+        size_t print(char c) { return(write((uint8_t) c)); }
+        size_t print(unsigned char value, int base = DEC) { return(print((unsigned long) value, base)); }
+        size_t print(int value, int base = DEC) { return(print((long) value, base)); }
+        size_t print(unsigned int value, int base = DEC) { return(print((unsigned long) value, base)); }
+        size_t print(long value, int base = DEC);
+        size_t print(unsigned long value, int base = DEC);
+        size_t print(long long value, int base = DEC);
+        size_t print(unsigned long long value, int base = DEC);
+        size_t print(double value, int digits = 2);
+
+        size_t println(void) { return(write("\r\n")); }
+        template<typename T> size_t println(T value) { size_t n = print(value); return(n + println()); }
+        template<typename T> size_t println(T value, int format) { size_t n = print(value, format); return(n + println()); }
+    };
+
+class HardwareSerial : public Print
+    {
+    public:
+        void begin(unsigned long baud, uint32_t config = SERIAL_8N1);
+        int available(void);
+        int read(void);
+        int availableForWrite(void);
+        void flush(void);
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        using Print::write;
+    };
+
+extern HardwareSerial Serial;
+
+class EspClass
+    {
+    public:
+        void restart(void);
+        uint32_t getCycleCount(void);
+        uint32_t getFreeHeap(void);
+        uint32_t getMinFreeHeap(void);
+        uint32_t getMaxAllocHeap(void);
+    };
+
+extern EspClass ESP;
+
+extern unsigned long millis(void);
+extern unsigned long micros(void);
+extern void delay(uint32_t ms);
+extern void delayMicroseconds(uint32_t us);
+extern void pinMode(uint8_t pin, uint8_t mode);
+extern void digitalWrite(uint8_t pin, uint8_t value);
+extern uint32_t getCpuFrequencyMhz(void);
+
+// Hardware timers are accepted but never fire.  (The demo's pathological
+// interrupt only steals CPU time, and the sim doesn't model CPU time.)
+typedef struct SimHardwareTimer hw_timer_t;
+extern hw_timer_t* timerBegin(uint8_t number, uint16_t divider, bool countUp);
+extern void timerAttachInterrupt(hw_timer_t* timer, void (*function)(void), bool edge);
+extern void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoReload);
+extern void timerAlarmEnable(hw_timer_t* timer);
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+
+#endif /* _SIM_ARDUINO_H_ */
@@ -0,0 +1,197 @@
+#ifndef _SIM_FASTLED_H_
+#define _SIM_FASTLED_H_
+
+// Just enough of FastLED to build the firmware on the host, with the Esp32
+// RMT driver replaced by a model of it in simulated time (sim_rmt.h):
+// clockless controllers only start sending once every controller has called
+// showLeds(), then the last one blocks on gTX_sem until all are done.
+
+#include <Arduino.h>
+
+// Same meaning as in the (patched) FastLED RMT driver, see displayFastLedCommon.h.
+#ifndef FASTLED_RMT_MAX_TICKS_FOR_GTX_SEM
+# define FASTLED_RMT_MAX_TICKS_FOR_GTX_SEM  (portMAX_DELAY)
+#endif
+
+struct CRGB
+    {
+    union
+        {
+        struct
+            {
+            uint8_t r;
+            uint8_t g;
+            uint8_t b;
+            };
+        uint8_t raw[3];
+        };
+
+    CRGB() = default;
+    constexpr CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    constexpr CRGB(uint32_t colourCode) : r((colourCode >> 16) & 0xFF), g((colourCode >> 8) & 0xFF), b(colourCode & 0xFF) {}
+
+    uint8_t& operator[](uint8_t index) { return(raw[index]); }
+    const uint8_t& operator[](uint8_t index) const { return(raw[index]); }
+    CRGB& nscale8(uint8_t scale);
+
+    typedef enum : uint32_t
+        {
+        Black = 0x000000,
+        Blue = 0x0000FF,
+        Cyan = 0x00FFFF,
+        Green = 0x008000,
+        Orange = 0xFFA500,
+        Red = 0xFF0000,
+        White = 0xFFFFFF
+        } HTMLColorCode;
+    };
+
+inline bool operator==(const CRGB& a, const CRGB& b) { return(a.r == b.r && a.g == b.g && a.b == b.b); }
+inline bool operator!=(const CRGB& a, const CRGB& b) { return(!(a == b)); }
+
+#define TypicalLEDStrip     0xFFB0F0
+#define UncorrectedColor    0xFFFFFF
+#define DISABLE_DITHER      0x00
+#define BINARY_DITHER       0x01
+
+typedef enum
+    {
+    RGB = 0012,
+    RBG = 0021,
+    GRB = 0102,
+    GBR = 0120,
+    BRG = 0201,
+    BGR = 0210
+    } EOrder;
+
+class CLEDController
+    {
+    public:
+        CLEDController();
+        virtual ~CLEDController() {}
+
+        CLEDController& setLeds(CRGB* data, int count) { m_Data = data; m_nLeds = count; return(*this); }
+        CRGB* leds(void) { return(m_Data); }
+        int size(void) { return(m_nLeds); }
+        CLEDController& setCorrection(CRGB correction) { m_Correction = correction; return(*this); }
+        CRGB getCorrection(void) { return(m_Correction); }
+        CLEDController& setDither(uint8_t ditherMode) { m_DitherMode = ditherMode; return(*this); }
+        void showLeds(uint8_t brightness = 255) { show(m_Data, m_nLeds, brightness); }
+        CLEDController* next(void) { return(m_pNext); }
+        static CLEDController* head(void) { return(m_pHead); }
+
+    protected:
+        virtual void show(const CRGB* data, int count, uint8_t brightness) = 0;
+
+        CRGB* m_Data;
+        int m_nLeds;
+        CRGB m_Correction;
+        uint8_t m_DitherMode;
+        CLEDController* m_pNext;
+        static CLEDController* m_pHead;
+        static CLEDController* m_pTail;
+    };
+
+/// @brief A clockless (RMT) controller on one pin, sent by the simulated RMT driver.
+class SimClocklessController : public CLEDController
+    {
+    public:
+        SimClocklessController(uint8_t pin, uint16_t bitNs, uint16_t resetUs);
+
+    protected:
+        void show(const CRGB* data, int count, uint8_t brightness) override;
+
+        uint8_t m_Pin;
+        uint16_t m_BitNs;
+        uint16_t m_ResetUs;
+        uint8_t m_Channel;
+    };
+
+template<uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812B : public SimClocklessController
+    {
+    public:
+        WS2812B() : SimClocklessController(DATA_PIN, 1250, 50) {}
+    };
+
+template<uint8_t DATA_PIN, EOrder RGB_ORDER> class WS2812 : public SimClocklessController
+    {
+    public:
+        WS2812() : SimClocklessController(DATA_PIN, 1250, 50) {}
+    };
+
+extern void simRmtSetMaxTicksForTxSem(TickType_t ticks);
+
+class CFastLED
+    {
+    public:
+        /// As FastLED: one controller per chipset and pin, so adding a pin twice gets the same one.
+        template<template<uint8_t DATA_PIN, EOrder RGB_ORDER> class CHIPSET, uint8_t DATA_PIN, EOrder RGB_ORDER>
+        CLEDController& addLeds(CRGB* data, int count)
+            {
+            static CHIPSET<DATA_PIN, RGB_ORDER> controller;
+            simRmtSetMaxTicksForTxSem(FASTLED_RMT_MAX_TICKS_FOR_GTX_SEM);
+            return(controller.setLeds(data, count));
+            }
+
+        void show(uint8_t brightness);
+        void show(void) { show(m_Brightness); }
+        void setBrightness(uint8_t brightness) { m_Brightness = brightness; }
+        uint8_t getBrightness(void) { return(m_Brightness); }
+        void setMaxPowerInVoltsAndMilliamps(uint8_t volts, uint32_t milliamps) { m_MaxPowerMw = volts * milliamps; }
+        void setMaxPowerInMilliWatts(uint32_t milliwatts) { m_MaxPowerMw = milliwatts; }
+        void setMaxRefreshRate(uint16_t refresh, bool constrain = false) {}
+        int count(void);
+        int size(void) { return((CLEDController::head() != NULL) ? CLEDController::head()->size() : 0); }
+
+    private:
+        uint8_t m_Brightness = 255;
+        uint32_t m_MaxPowerMw = 0xFFFFFFFF;
+    };
+
+extern CFastLED FastLED;
+
+extern uint8_t random8(void);
+extern uint8_t random8(uint8_t limit);
+extern uint16_t random16(void);
+extern void random16_set_seed(uint16_t seed);
+extern uint8_t scale8(uint8_t value, uint8_t scale);
+extern void fill_solid(struct CRGB* leds, int count, const struct CRGB& colour);
+extern void nscale8(CRGB* leds, uint16_t count, uint8_t scale);
+extern uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB);
+extern CRGB blend(const CRGB& p1, const CRGB& p2, uint8_t amountOfP2);
+extern CRGB* blend(const CRGB* src1, const CRGB* src2, CRGB* dest, uint16_t count, uint8_t amountOfSrc2);
+extern uint32_t calculate_unscaled_power_mW(const CRGB* leds, uint16_t count);
+extern uint8_t calculate_max_brightness_for_power_mW(uint8_t targetBrightness, uint32_t maxPowerMw);
+
+// From the patched clockless_rmt_esp32.cpp: gives gTX_sem to un-jam a show.
+extern void GiveGTX_sem(void);
+// And the RMT driver reset a warm restart needs (see displayFastLedCommon.h).
+extern void ResetRMT(int pin);
+
+class CEveryNMillis
+    {
+    public:
+        CEveryNMillis(uint32_t periodMs) : m_PeriodMs(periodMs), m_PreviousMs(millis()) {}
+        bool ready(void)
+            {
+            uint32_t nowMs = millis();
+            if (nowMs - m_PreviousMs < m_PeriodMs)
+                {
+                return(false);
+                }
+            m_PreviousMs = nowMs;
+            return(true);
+            }
+
+    private:
+        uint32_t m_PeriodMs;
+        uint32_t m_PreviousMs;
+    };
+
+#define SIM_EVERY_CONCAT(a, b)      a##b
+#define SIM_EVERY_NAME(line)        SIM_EVERY_CONCAT(everyNTimer, line)
+#define EVERY_N_MILLISECONDS(n)     static CEveryNMillis SIM_EVERY_NAME(__LINE__)(n); if (SIM_EVERY_NAME(__LINE__).ready())
+#define EVERY_N_SECONDS(n)          EVERY_N_MILLISECONDS((n) * 1000UL)
+#define EVERY_N_MINUTES(n)          EVERY_N_MILLISECONDS((n) * 60000UL)
+
+#endif /* _SIM_FASTLED_H_ */
@@ -0,0 +1,18 @@
+#ifndef _SIM_DEBUGGERY_H_
+#define _SIM_DEBUGGERY_H_
+
+// Stand-in for the debuggery library's macros on the host.
+// A failed DEBUG_ASSERT stops the simulation (the run fails) rather than
+// just printing, so it can be used to check things in CI.
+
+#include <Arduino.h>
+#include "sim_kernel.h"
+
+#define DEBUG_INITIALISE(wait, baud, config)    Serial.begin(baud, config)
+#define DEBUG_PRINT(...)                        Serial.print(__VA_ARGS__)
+#define DEBUG_PRINTLN(...)                      Serial.println(__VA_ARGS__)
+#define DEBUG_RESETCOLOUR()                     ((void) 0)
+#define DEBUG_PROGANNOUNCE(name, detail)        do { Serial.print(name); Serial.print(" "); Serial.println(detail); } while (0)
+#define DEBUG_ASSERT(condition)                 do { if (!(condition)) simAssertFailed(#condition, __FILE__, __LINE__); } while (0)
+
+#endif /* _SIM_DEBUGGERY_H_ */
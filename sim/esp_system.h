@@ -0,0 +1,25 @@
+#ifndef _SIM_ESP_SYSTEM_H_
+#define _SIM_ESP_SYSTEM_H_
+
+// Simulated esp_reset_reason(): a power on, unless sim_main was given an
+// RTC memory file from an earlier run (--rtc), when it's a software reset.
+
+typedef enum
+    {
+    ESP_RST_UNKNOWN = 0,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO
+    } esp_reset_reason_t;
+
+extern esp_reset_reason_t esp_reset_reason(void);
+extern void simSetResetReason(esp_reset_reason_t reason);
+
+#endif /* _SIM_ESP_SYSTEM_H_ */
@@ -0,0 +1,36 @@
+#ifndef _SIM_ESP_TIMER_H_
+#define _SIM_ESP_TIMER_H_
+
+// Simulated esp_timer: callbacks run at their simulated time (see sim_kernel.h).
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK                  0
+#define ESP_ERR_INVALID_STATE   0x103
+
+typedef struct SimEspTimer* esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum
+    {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR
+    } esp_timer_dispatch_t;
+
+typedef struct
+    {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+    } esp_timer_create_args_t;
+
+extern int64_t esp_timer_get_time(void);
+extern esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle);
+extern esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+extern esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+extern esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+#endif /* _SIM_ESP_TIMER_H_ */
@@ -0,0 +1,44 @@
+#ifndef _SIM_FREERTOS_H_
+#define _SIM_FREERTOS_H_
+
+// Simulated FreeRTOS (see sim_kernel.h), just the parts the firmware uses.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define portTICK_PERIOD_MS          1
+#define portMAX_DELAY               ((TickType_t) 0xffffffffUL)
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define pdPASS                      1
+#define pdFAIL                      0
+#define pdMS_TO_TICKS(ms)           ((TickType_t) (ms) / portTICK_PERIOD_MS)
+#define configMINIMAL_STACK_SIZE    768
+#define configMAX_PRIORITIES        25
+#define tskIDLE_PRIORITY            0
+#define tskNO_AFFINITY              0x7FFFFFFF
+
+// Only one simulated task runs at a time and never gets preempted, so
+// critical sections have nothing to do.
+typedef struct
+    {
+    uint32_t owner;
+    uint32_t count;
+    } portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED    { 0, 0 }
+#define portENTER_CRITICAL(mux)         ((void) (mux))
+#define portEXIT_CRITICAL(mux)          ((void) (mux))
+#define portENTER_CRITICAL_ISR(mux)     ((void) (mux))
+#define portEXIT_CRITICAL_ISR(mux)      ((void) (mux))
+
+extern BaseType_t xPortGetCoreID(void);
+
+#include "freertos/portmacro.h"
+
+#endif /* _SIM_FREERTOS_H_ */
@@ -0,0 +1,6 @@
+#ifndef _SIM_PORTMACRO_H_
+#define _SIM_PORTMACRO_H_
+
+// Everything lives in FreeRTOS.h in the sim.
+
+#endif /* _SIM_PORTMACRO_H_ */
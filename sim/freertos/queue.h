@@ -0,0 +1,7 @@
+#ifndef _SIM_QUEUE_H_
+#define _SIM_QUEUE_H_
+
+// No queues are used by the firmware (yet).
+#include "freertos/FreeRTOS.h"
+
+#endif /* _SIM_QUEUE_H_ */
@@ -0,0 +1,19 @@
+#ifndef _SIM_SEMPHR_H_
+#define _SIM_SEMPHR_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimSemaphore* SemaphoreHandle_t;
+
+typedef struct
+    {
+    uint8_t opaque[64];
+    } StaticSemaphore_t;
+
+extern SemaphoreHandle_t xSemaphoreCreateBinary(void);
+extern SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer);
+extern BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+extern BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+extern BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken);
+
+#endif /* _SIM_SEMPHR_H_ */
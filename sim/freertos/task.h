@@ -0,0 +1,32 @@
+#ifndef _SIM_TASK_H_
+#define _SIM_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct SimTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* param);
+
+typedef struct
+    {
+    uint8_t opaque[64];
+    } StaticTask_t;
+
+extern BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, 
+                                          void* param, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+extern TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth, 
+                                                  void* param, UBaseType_t priority, StackType_t* stack, 
+                                                  StaticTask_t* taskBuffer, BaseType_t core);
+extern void vTaskDelete(TaskHandle_t task);
+extern void vTaskDelay(TickType_t ticks);
+extern void vTaskDelayUntil(TickType_t* previousWakeTicks, TickType_t incrementTicks);
+extern TickType_t xTaskGetTickCount(void);
+extern TaskHandle_t xTaskGetCurrentTaskHandle(void);
+extern uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+extern BaseType_t xTaskNotifyGive(TaskHandle_t task);
+extern void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken);
+extern UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+extern void yield(void);
+#define taskYIELD() yield()
+
+#endif /* _SIM_TASK_H_ */
@@ -0,0 +1,13 @@
+#ifndef _SIM_NOT_DEBUGGERY_H_
+#define _SIM_NOT_DEBUGGERY_H_
+
+// Stand-in for the debuggery library's do-nothing macros on the host.
+
+#define DEBUG_INITIALISE(wait, baud, config)    ((void) 0)
+#define DEBUG_PRINT(...)                        ((void) 0)
+#define DEBUG_PRINTLN(...)                      ((void) 0)
+#define DEBUG_RESETCOLOUR()                     ((void) 0)
+#define DEBUG_PROGANNOUNCE(name, detail)        ((void) 0)
+#define DEBUG_ASSERT(condition)                 ((void) 0)
+
+#endif /* _SIM_NOT_DEBUGGERY_H_ */
@@ -0,0 +1,239 @@
+#include <Arduino.h>
+#include "sim_kernel.h"
+#include <esp_system.h>
+
+#include <deque>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static std::deque<uint8_t> serialInput;
+static bool serialEcho = true;
+static bool serialAtLineStart = true;
+static esp_reset_reason_t resetReason = ESP_RST_POWERON;
+
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+    {
+    size_t written = 0;
+    while (size-- > 0)
+        {
+        written += write(*buffer++);
+        }
+    return(written);
+    }
+
+size_t Print::print(long value, int base)
+    {
+    if (value < 0 && base == DEC)
+        {
+        return(print('-') + print((unsigned long long) -(long long) value, base));
+        }
+    return(print((unsigned long long) (unsigned long) value, base));
+    }
+
+size_t Print::print(unsigned long value, int base)
+    {
+    return(print((unsigned long long) value, base));
+    }
+
+size_t Print::print(long long value, int base)
+    {
+    if (value < 0 && base == DEC)
+        {
+        return(print('-') + print((unsigned long long) -value, base));
+        }
+    return(print((unsigned long long) value, base));
+    }
+
+size_t Print::print(unsigned long long value, int base)
+    {
+    char digits[65];
+    char* digit = &digits[sizeof(digits) - 1];
+    *digit = '\0';
+    if (base < 2)
+        {
+        base = DEC;
+        }
+    do
+        {
+        unsigned remainder = (unsigned) (value % base);
+        *--digit = (char) (remainder < 10 ? '0' + remainder : 'A' + remainder - 10);
+        value /= base;
+        }
+    while (value > 0);
+    return(write(digit));
+    }
+
+size_t Print::print(double value, int digits)
+    {
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", digits, value);
+    return(write(text));
+    }
+
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config)
+    {
+    }
+
+int HardwareSerial::available(void)
+    {
+    return((int) serialInput.size());
+    }
+
+int HardwareSerial::read(void)
+    {
+    if (serialInput.empty())
+        {
+        return(-1);
+        }
+    uint8_t c = serialInput.front();
+    serialInput.pop_front();
+    return(c);
+    }
+
+int HardwareSerial::availableForWrite(void)
+    {
+    return(128);
+    }
+
+void HardwareSerial::flush(void)
+    {
+    fflush(stdout);
+    }
+
+/// @brief Goes to stdout, each line starting with the simulated time in the
+/// same format as the PlatformIO monitor's "time" filter, so a capture
+/// looks like the ones in logs/ (and tools/telemetry_decode can read it).
+size_t HardwareSerial::write(uint8_t c)
+    {
+    if (!serialEcho)
+        {
+        return(1);
+        }
+    if (serialAtLineStart)
+        {
+        uint64_t ms = simNowUs() / 1000;
+        printf("%02u:%02u:%02u.%03u > ", (unsigned) (ms / 3600000), (unsigned) (ms / 60000 % 60),
+               (unsigned) (ms / 1000 % 60), (unsigned) (ms % 1000));
+        serialAtLineStart = false;
+        }
+    putchar(c);
+    if (c == '\n')
+        {
+        serialAtLineStart = true;
+        }
+    return(1);
+    }
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+    {
+    return(Print::write(buffer, size));
+    }
+
+void simSerialInject(const char* text)
+    {
+    while (*text != '\0')
+        {
+        serialInput.push_back((uint8_t) *text++);
+        }
+    }
+
+void simSerialSetEcho(bool echo)
+    {
+    serialEcho = echo;
+    }
+
+
+esp_reset_reason_t esp_reset_reason(void)
+    {
+    return(resetReason);
+    }
+
+void simSetResetReason(esp_reset_reason_t reason)
+    {
+    resetReason = reason;
+    }
+
+
+void EspClass::restart(void)
+    {
+    simStop(SIM_EXIT_RESTART, "ESP.restart()");
+    }
+
+/// @brief Code takes no simulated time, so this only counts simulated time (at 240 MHz).
+uint32_t EspClass::getCycleCount(void)
+    {
+    return((uint32_t) (simNowUs() * 240));
+    }
+
+// There is no Esp32 heap here, so it is always one free block of a typical size.
+uint32_t EspClass::getFreeHeap(void)
+    {
+    return(200000);
+    }
+
+uint32_t EspClass::getMinFreeHeap(void)
+    {
+    return(200000);
+    }
+
+uint32_t EspClass::getMaxAllocHeap(void)
+    {
+    return(200000);
+    }
+
+
+unsigned long millis(void)
+    {
+    return((unsigned long) (simNowUs() / 1000));
+    }
+
+unsigned long micros(void)
+    {
+    return((unsigned long) simNowUs());
+    }
+
+void delay(uint32_t ms)
+    {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+
+void pinMode(uint8_t pin, uint8_t mode)
+    {
+    }
+
+void digitalWrite(uint8_t pin, uint8_t value)
+    {
+    }
+
+uint32_t getCpuFrequencyMhz(void)
+    {
+    return(240);
+    }
+
+
+struct SimHardwareTimer
+    {
+    uint8_t number;
+    };
+
+hw_timer_t* timerBegin(uint8_t number, uint16_t divider, bool countUp)
+    {
+    hw_timer_t* timer = new hw_timer_t();
+    timer->number = number;
+    return(timer);
+    }
+
+void timerAttachInterrupt(hw_timer_t* timer, void (*function)(void), bool edge)
+    {
+    }
+
+void timerAlarmWrite(hw_timer_t* timer, uint64_t alarmValue, bool autoReload)
+    {
+    }
+
+void timerAlarmEnable(hw_timer_t* timer)
+    {
+    }
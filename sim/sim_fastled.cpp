@@ -0,0 +1,444 @@
+#include <FastLED.h>
+#include "sim_kernel.h"
+#include "sim_rmt.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+CFastLED FastLED;
+CLEDController* CLEDController::m_pHead = NULL;
+CLEDController* CLEDController::m_pTail = NULL;
+
+
+CLEDController::CLEDController() : m_Data(NULL), m_nLeds(0), m_Correction(UncorrectedColor), m_DitherMode(BINARY_DITHER), m_pNext(NULL)
+    {
+    if (m_pHead == NULL)
+        {
+        m_pHead = this;
+        }
+    if (m_pTail != NULL)
+        {
+        m_pTail->m_pNext = this;
+        }
+    m_pTail = this;
+    }
+
+CRGB& CRGB::nscale8(uint8_t scale)
+    {
+    r = scale8(r, scale);
+    g = scale8(g, scale);
+    b = scale8(b, scale);
+    return(*this);
+    }
+
+int CFastLED::count(void)
+    {
+    int controllers = 0;
+    for (CLEDController* controller = CLEDController::head(); controller != NULL; controller = controller->next())
+        {
+        controllers++;
+        }
+    return(controllers);
+    }
+
+void CFastLED::show(uint8_t brightness)
+    {
+    uint8_t scale = calculate_max_brightness_for_power_mW(brightness, m_MaxPowerMw);
+    for (CLEDController* controller = CLEDController::head(); controller != NULL; controller = controller->next())
+        {
+        controller->showLeds(scale);
+        }
+    }
+
+
+// The RMT driver model.  Mirrors showPixels() in clockless_rmt_esp32.cpp:
+// the first controller of a batch takes gTX_sem, the last one starts every
+// channel and then waits on gTX_sem, which the "all done" interrupt gives.
+
+typedef struct
+    {
+    uint16_t leds;              // Queued for this batch.
+    uint16_t bitNs;
+    uint16_t resetUs;
+    } SimRmtPending;
+
+static SemaphoreHandle_t gTX_sem = NULL;
+static TickType_t maxTicksForTxSem = portMAX_DELAY;
+static uint8_t numChannels = 0;
+static uint8_t numStarted = 0;
+static SimRmtPending pending[SIM_RMT_MAX_CHANNELS];
+static SimRmtChannelStats channelStats[SIM_RMT_MAX_CHANNELS];
+static SimRmtStats rmtStats;
+
+static std::vector<uint32_t> dropBatches;
+static double dropProbability = 0;
+static uint32_t dropRandom = 1;
+static bool dropStuck = false;
+static bool dropSurvivesReset = false;
+static size_t faultsBeforeReset = 0;    // A stuck peripheral is only stuck since the last ResetRMT().
+static uint32_t resetAfterBatch = 0;    // Done interrupts of batches up to here never come.
+static std::vector<SimRmtFault> faults;
+static bool faultOpen = false;       // The last fault hasn't recovered yet.
+
+
+SimClocklessController::SimClocklessController(uint8_t pin, uint16_t bitNs, uint16_t resetUs) :
+    m_Pin(pin), m_BitNs(bitNs), m_ResetUs(resetUs)
+    {
+    if (numChannels >= SIM_RMT_MAX_CHANNELS)
+        {
+        simStop(SIM_EXIT_ASSERT, "more clockless controllers than RMT channels");
+        }
+    m_Channel = numChannels++;
+    channelStats[m_Channel].pin = pin;
+    channelStats[m_Channel].wireHash = 2166136261UL;   // FNV offset basis.
+    if (gTX_sem == NULL)
+        {
+        gTX_sem = xSemaphoreCreateBinary();
+        xSemaphoreGive(gTX_sem);
+        }
+    }
+
+void simRmtSetMaxTicksForTxSem(TickType_t ticks)
+    {
+    maxTicksForTxSem = ticks;
+    }
+
+/// @brief Whether to lose this batch's done interrupt.
+static bool simRmtDropDone(uint32_t batch)
+    {
+    if (dropStuck && faults.size() > faultsBeforeReset)
+        {
+        return(true);
+        }
+    if (std::find(dropBatches.begin(), dropBatches.end(), batch) != dropBatches.end())
+        {
+        return(true);
+        }
+    if (dropProbability > 0)
+        {
+        dropRandom ^= dropRandom << 13;
+        dropRandom ^= dropRandom >> 17;
+        dropRandom ^= dropRandom << 5;
+        return(dropRandom < dropProbability * 4294967296.0);
+        }
+    return(false);
+    }
+
+/// @brief Notes how the open fault (if any) is being recovered from.
+static void simRmtFaultRecovery(SimRecovery how)
+    {
+    if (faultOpen && faults.back().how == SIM_RECOVERY_NONE)
+        {
+        faults.back().how = how;
+        }
+    }
+
+/// @brief The "all channels done" interrupt (unless the fault injector loses it).
+static void simRmtTransmitComplete(uint32_t batch)
+    {
+    if (batch <= resetAfterBatch)
+        {
+        return;
+        }
+    if (simRmtDropDone(batch))
+        {
+        SimRmtFault fault;
+        fault.batch = batch;
+        fault.droppedUs = simNowUs();
+        fault.recoveredUs = 0;
+        fault.how = SIM_RECOVERY_NONE;
+        faults.push_back(fault);
+        faultOpen = true;
+        return;
+        }
+    xSemaphoreGiveFromISR(gTX_sem, NULL);
+    }
+
+/// @brief Starts every channel in the batch at once and schedules the
+/// done interrupt for when the longest one finishes.
+static void simRmtStartBatch(void)
+    {
+    uint64_t startUs = simNowUs();
+    uint64_t longestUs = 0;
+    if (faultOpen)
+        {
+        faults.back().recoveredUs = startUs;
+        faultOpen = false;
+        }
+    for (uint8_t channel = 0; channel < numChannels; channel++)
+        {
+        SimRmtChannelStats* stats = &channelStats[channel];
+        if (pending[channel].leds == 0)
+            {
+            stats->parked++;
+            continue;
+            }
+        uint64_t wireUs = ((uint64_t) pending[channel].leds * 24 * pending[channel].bitNs + 999) / 1000;
+        if (stats->frames > 0 && startUs < stats->lastEndUs + pending[channel].resetUs)
+            {
+            stats->latchViolations++;
+            }
+        if (stats->frames == 0)
+            {
+            stats->firstStartUs = startUs;
+            }
+        stats->frames++;
+        stats->ledsSent += pending[channel].leds;
+        stats->busyUs += wireUs;
+        stats->lastEndUs = startUs + wireUs;
+        if (wireUs > longestUs)
+            {
+            longestUs = wireUs;
+            }
+        }
+    uint32_t batch = ++rmtStats.batches;
+    if (longestUs > rmtStats.longestBatchUs)
+        {
+        rmtStats.longestBatchUs = longestUs;
+        }
+    simScheduleAt(startUs + longestUs, [batch] { simRmtTransmitComplete(batch); });
+    }
+
+void SimClocklessController::show(const CRGB* data, int count, uint8_t brightness)
+    {
+    if (numStarted == 0)
+        {
+        if (xSemaphoreTake(gTX_sem, maxTicksForTxSem) != pdTRUE)
+            {
+            rmtStats.txSemTimeouts++;
+            simRmtFaultRecovery(SIM_RECOVERY_TX_SEM_TIMEOUT);
+            }
+        }
+    // The bytes FastLED would put on the wire: as CLEDController::computeAdjustment()
+    // (no colour temperature) and then scale8() per byte, no dither.
+    uint8_t adjustment[3];
+    for (uint8_t colour = 0; colour < 3; colour++)
+        {
+        adjustment[colour] = (brightness > 0 && m_Correction[colour] > 0) ?
+                             (uint8_t) ((((uint32_t) m_Correction[colour] + 1) * brightness) >> 8) : 0;
+        }
+    uint32_t hash = channelStats[m_Channel].wireHash;
+    for (int i = 0; i < count; i++)
+        {
+        for (uint8_t colour = 0; colour < 3; colour++)
+            {
+            hash = (hash ^ scale8(data[i][colour], adjustment[colour])) * 16777619UL;
+            }
+        }
+    channelStats[m_Channel].wireHash = hash;
+    pending[m_Channel].leds = (uint16_t) count;
+    pending[m_Channel].bitNs = m_BitNs;
+    pending[m_Channel].resetUs = m_ResetUs;
+    numStarted++;
+    if (numStarted == numChannels)
+        {
+        simRmtStartBatch();
+        // Wait here while the data is sent, as the real driver does.
+        if (xSemaphoreTake(gTX_sem, maxTicksForTxSem) != pdTRUE)
+            {
+            rmtStats.txSemTimeouts++;
+            simRmtFaultRecovery(SIM_RECOVERY_TX_SEM_TIMEOUT);
+            }
+        xSemaphoreGive(gTX_sem);
+        numStarted = 0;
+        }
+    }
+
+void GiveGTX_sem(void)
+    {
+    if (gTX_sem != NULL)
+        {
+        simRmtFaultRecovery(SIM_RECOVERY_GIVE_GTX_SEM);
+        xSemaphoreGive(gTX_sem);
+        }
+    }
+
+/// @brief As ResetRMT() in the patched clockless_rmt_esp32.cpp (see
+/// displayFastLedCommon.h): forgets the batch being started and any done
+/// interrupt still to come, and gives a fresh gTX_sem (the old one is left,
+/// the only task waiting on it has been deleted).  A stuck peripheral is
+/// cleared by the reset, unless simRmtSetDropSurvivesReset().
+void ResetRMT(int pin)
+    {
+    (void) pin;
+    if (faultOpen)
+        {
+        faults.back().how = SIM_RECOVERY_RMT_RESET;     // Whatever was tried before didn't do it.
+        }
+    numStarted = 0;
+    memset(pending, 0, sizeof(pending));
+    resetAfterBatch = rmtStats.batches;
+    rmtStats.resets++;
+    if (!dropSurvivesReset)
+        {
+        faultsBeforeReset = faults.size();
+        }
+    gTX_sem = xSemaphoreCreateBinary();
+    xSemaphoreGive(gTX_sem);
+    }
+
+void simRmtDropDoneAtBatch(uint32_t batch)
+    {
+    dropBatches.push_back(batch);
+    }
+
+void simRmtSetDropRate(double probability, uint32_t seed)
+    {
+    dropProbability = probability;
+    dropRandom = (seed != 0) ? seed : 1;
+    }
+
+void simRmtSetDropStuck(bool stuck)
+    {
+    dropStuck = stuck;
+    }
+
+void simRmtSetDropSurvivesReset(bool survives)
+    {
+    dropSurvivesReset = survives;
+    }
+
+uint32_t simRmtFaultCount(void)
+    {
+    return((uint32_t) faults.size());
+    }
+
+const SimRmtFault* simRmtGetFault(uint32_t index)
+    {
+    return((index < faults.size()) ? &faults[index] : NULL);
+    }
+
+/// @brief The run ended in ESP.restart(), which is the recovery for an open fault.
+void simRmtRecoveredByRestart(void)
+    {
+    if (faultOpen)
+        {
+        faults.back().how = SIM_RECOVERY_RESTART;
+        faults.back().recoveredUs = simNowUs();
+        faultOpen = false;
+        }
+    }
+
+uint8_t simRmtChannelCount(void)
+    {
+    return(numChannels);
+    }
+
+void simRmtGetChannelStats(uint8_t channel, SimRmtChannelStats* stats)
+    {
+    *stats = channelStats[channel];
+    }
+
+void simRmtGetStats(SimRmtStats* stats)
+    {
+    *stats = rmtStats;
+    }
+
+
+// lib8tion and colour utilities, same arithmetic as FastLED.
+
+static uint16_t rand16seed = 1337;
+
+uint8_t random8(void)
+    {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return((uint8_t) (((uint8_t) (rand16seed & 0xFF)) + ((uint8_t) (rand16seed >> 8))));
+    }
+
+uint8_t random8(uint8_t limit)
+    {
+    return((uint8_t) ((random8() * limit) >> 8));
+    }
+
+uint16_t random16(void)
+    {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return(rand16seed);
+    }
+
+void random16_set_seed(uint16_t seed)
+    {
+    rand16seed = seed;
+    }
+
+uint8_t scale8(uint8_t value, uint8_t scale)
+    {
+    return((uint8_t) (((uint16_t) value * (1 + (uint16_t) scale)) >> 8));
+    }
+
+void fill_solid(struct CRGB* leds, int count, const struct CRGB& colour)
+    {
+    for (int i = 0; i < count; i++)
+        {
+        leds[i] = colour;
+        }
+    }
+
+void nscale8(CRGB* leds, uint16_t count, uint8_t scale)
+    {
+    for (uint16_t i = 0; i < count; i++)
+        {
+        leds[i].nscale8(scale);
+        }
+    }
+
+// As FastLED's blend8() (lib8tion, FASTLED_BLEND_FIXED).
+uint8_t blend8(uint8_t a, uint8_t b, uint8_t amountOfB)
+    {
+    uint16_t partial = (uint16_t) ((a << 8) | b);
+    partial += (uint16_t) (b * amountOfB);
+    partial -= (uint16_t) (a * amountOfB);
+    return((uint8_t) (partial >> 8));
+    }
+
+CRGB blend(const CRGB& p1, const CRGB& p2, uint8_t amountOfP2)
+    {
+    return(CRGB(blend8(p1.r, p2.r, amountOfP2), blend8(p1.g, p2.g, amountOfP2), blend8(p1.b, p2.b, amountOfP2)));
+    }
+
+CRGB* blend(const CRGB* src1, const CRGB* src2, CRGB* dest, uint16_t count, uint8_t amountOfSrc2)
+    {
+    for (uint16_t i = 0; i < count; i++)
+        {
+        dest[i] = blend(src1[i], src2[i], amountOfSrc2);
+        }
+    return(dest);
+    }
+
+// Power model from FastLED's power_mgt.cpp (milliwatts at 5V).
+#define SIM_RED_MW      (16 * 5)
+#define SIM_GREEN_MW    (11 * 5)
+#define SIM_BLUE_MW     (15 * 5)
+#define SIM_DARK_MW     (1 * 5)
+#define SIM_MCU_MW      (25 * 5)
+
+uint32_t calculate_unscaled_power_mW(const CRGB* leds, uint16_t count)
+    {
+    uint32_t red = 0;
+    uint32_t green = 0;
+    uint32_t blue = 0;
+    for (uint16_t i = 0; i < count; i++)
+        {
+        red += leds[i].r;
+        green += leds[i].g;
+        blue += leds[i].b;
+        }
+    return(((red * SIM_RED_MW) >> 8) + ((green * SIM_GREEN_MW) >> 8) + ((blue * SIM_BLUE_MW) >> 8) + count * SIM_DARK_MW);
+    }
+
+uint8_t calculate_max_brightness_for_power_mW(uint8_t targetBrightness, uint32_t maxPowerMw)
+    {
+    uint32_t totalMw = SIM_MCU_MW;
+    for (CLEDController* controller = CLEDController::head(); controller != NULL; controller = controller->next())
+        {
+        totalMw += calculate_unscaled_power_mW(controller->leds(), (uint16_t) controller->size());
+        }
+    uint32_t requestedMw = (totalMw * targetBrightness) / 256;
+    if (requestedMw <= maxPowerMw)
+        {
+        return(targetBrightness);
+        }
+    return((uint8_t) (((uint32_t) targetBrightness * maxPowerMw) / requestedMw));
+    }
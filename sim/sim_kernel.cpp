@@ -0,0 +1,575 @@
+#include <Arduino.h>
+#include "sim_kernel.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <vector>
+#include <algorithm>
+
+// Each task's thread runs on a stack of this size that we allocate and fill
+// with SIM_STACK_FILL, so uxTaskGetStackHighWaterMark() can see how deep it
+// has ever been.  Far more than any task asks for, so an ESP32 sized
+// overflow shows up as a peak over the size rather than a crash.
+#define SIM_HOST_STACK_BYTES    (1024 * 1024)
+#define SIM_STACK_FILL          0xA5
+
+struct SimTask
+    {
+    const char* name;
+    TaskFunction_t function;
+    void* param;
+    UBaseType_t priority;
+    BaseType_t core;
+    uint32_t stackDepth;
+    pthread_t thread;
+    uint8_t* stack;             // SIM_HOST_STACK_BYTES, lowest address first (it grows down).
+    std::condition_variable wake;
+    std::unique_lock<std::mutex>* lock;
+    uint32_t notifyCount;
+    bool waitingForNotify;
+    struct SimSemaphore* waitingOn;
+    uint32_t waitGeneration;    // Bumped whenever a wait ends, which cancels its timeout.
+    bool timedOut;
+    bool deleted;
+    };
+
+struct SimSemaphore
+    {
+    uint32_t count;
+    uint32_t maxCount;
+    std::deque<SimTask*> waiters;
+    };
+
+struct SimEspTimer
+    {
+    esp_timer_cb_t callback;
+    void* arg;
+    const char* name;
+    uint32_t generation;        // Bumped by esp_timer_stop(), cancelling the pending event.
+    bool armed;
+    };
+
+typedef struct
+    {
+    uint64_t atUs;
+    uint64_t sequence;          // Events at the same time run in the order they were scheduled.
+    std::function<void(void)> function;
+    } SimEvent;
+
+struct SimEventLater
+    {
+    bool operator()(const SimEvent& a, const SimEvent& b) const
+        {
+        return((a.atUs != b.atUs) ? (a.atUs > b.atUs) : (a.sequence > b.sequence));
+        }
+    };
+
+static std::mutex simMutex;
+static std::condition_variable kernelWake;
+static SimTask* running = NULL;
+static std::deque<SimTask*> readyTasks;
+static std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> events;
+static uint64_t nowUs = 0;
+static uint64_t eventSequence = 0;
+static uint64_t taskSwitches = 0;
+static bool stopped = false;
+static int stopExitCode = SIM_EXIT_OK;
+static thread_local SimTask* self = NULL;
+
+
+uint64_t simNowUs(void)
+    {
+    return(nowUs);
+    }
+
+bool simInTask(void)
+    {
+    return(self != NULL);
+    }
+
+bool simStopped(void)
+    {
+    return(stopped);
+    }
+
+uint64_t simTaskSwitches(void)
+    {
+    return(taskSwitches);
+    }
+
+void simScheduleAt(uint64_t atUs, std::function<void(void)> event)
+    {
+    SimEvent simEvent;
+    simEvent.atUs = (atUs > nowUs) ? atUs : nowUs;
+    simEvent.sequence = eventSequence++;
+    simEvent.function = event;
+    events.push(simEvent);
+    }
+
+
+static void simMakeReady(SimTask* task)
+    {
+    if (!task->deleted)
+        {
+        readyTasks.push_back(task);
+        }
+    }
+
+/// @brief The running task hands the CPU back to the kernel and waits until
+/// the kernel picks it again.  Called from inside the task, holding simMutex.
+static void simBlock(void)
+    {
+    SimTask* task = self;
+    running = NULL;
+    kernelWake.notify_one();
+    task->wake.wait(*task->lock, [task] { return(running == task); });
+    }
+
+/// @brief Ends a task's wait early (what it was waiting for happened).
+static void simEndWait(SimTask* task)
+    {
+    task->waitGeneration++;
+    task->timedOut = false;
+    simMakeReady(task);
+    }
+
+/// @brief Wakes the running task after ticks unless its wait ends first.
+static void simScheduleTimeout(SimTask* task, TickType_t ticks)
+    {
+    if (ticks == portMAX_DELAY)
+        {
+        return;
+        }
+    uint32_t generation = task->waitGeneration;
+    simScheduleAt(nowUs + (uint64_t) ticks * portTICK_PERIOD_MS * 1000, [task, generation]
+        {
+        if (task->waitGeneration == generation && !task->deleted)
+            {
+            if (task->waitingOn != NULL)
+                {
+                std::deque<SimTask*>& waiters = task->waitingOn->waiters;
+                waiters.erase(std::remove(waiters.begin(), waiters.end(), task), waiters.end());
+                }
+            task->waitGeneration++;
+            task->timedOut = true;
+            simMakeReady(task);
+            }
+        });
+    }
+
+static void simTaskEntry(SimTask* task)
+    {
+    std::unique_lock<std::mutex> lock(simMutex);
+    task->lock = &lock;
+    task->wake.wait(lock, [task] { return(running == task); });
+    self = task;
+    task->function(task->param);
+    simStop(SIM_EXIT_ASSERT, "a task returned from its task function");
+    }
+
+static void* simTaskThread(void* arg)
+    {
+    simTaskEntry((SimTask*) arg);
+    return(NULL);
+    }
+
+
+/// @brief Runs tasks and events until untilUs, or until something stops the run.
+/// @return One of SIM_EXIT_*.
+int simKernelRun(uint64_t untilUs)
+    {
+    std::unique_lock<std::mutex> lock(simMutex);
+    uint32_t switchesThisInstant = 0;
+    while (!stopped)
+        {
+        if (!readyTasks.empty())
+            {
+            SimTask* task = readyTasks.front();
+            readyTasks.pop_front();
+            if (task->deleted)
+                {
+                continue;
+                }
+            if (++switchesThisInstant > SIM_MAX_SWITCHES_PER_INSTANT)
+                {
+                simStop(SIM_EXIT_LIVELOCK, "tasks keep running without time moving on");
+                break;
+                }
+            taskSwitches++;
+            running = task;
+            task->wake.notify_one();
+            kernelWake.wait(lock, [] { return(running == NULL); });
+            continue;
+            }
+        if (events.empty())
+            {
+            simStop(SIM_EXIT_DEADLOCK, "every task is blocked and nothing is scheduled");
+            break;
+            }
+        if (events.top().atUs > untilUs)
+            {
+            nowUs = untilUs;
+            break;
+            }
+        SimEvent event = events.top();
+        events.pop();
+        if (event.atUs > nowUs)
+            {
+            nowUs = event.atUs;
+            switchesThisInstant = 0;
+            }
+        event.function();
+        }
+    return(stopExitCode);
+    }
+
+/// @brief Ends the run.  From a task, that task never runs again.
+void simStop(int exitCode, const char* reason)
+    {
+    if (!stopped)
+        {
+        stopped = true;
+        stopExitCode = exitCode;
+        Serial.flush();
+        fprintf(stderr, "sim: stopped at %.6f s: %s\n", nowUs / 1000000.0, reason);
+        }
+    if (self != NULL)
+        {
+        while (true)
+            {
+            simBlock();
+            }
+        }
+    }
+
+void simAssertFailed(const char* condition, const char* file, int line)
+    {
+    char reason[256];
+    snprintf(reason, sizeof(reason), "DEBUG_ASSERT(%s) failed at %s:%d", condition, file, line);
+    simStop(SIM_EXIT_ASSERT, reason);
+    }
+
+
+// FreeRTOS tasks.
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core)
+    {
+    SimTask* task = new SimTask();
+    task->name = name;
+    task->function = function;
+    task->param = param;
+    task->priority = priority;
+    task->core = core;
+    task->stackDepth = stackDepth;
+    task->lock = NULL;
+    task->notifyCount = 0;
+    task->waitingForNotify = false;
+    task->waitingOn = NULL;
+    task->waitGeneration = 0;
+    task->timedOut = false;
+    task->deleted = false;
+    if (posix_memalign((void**) &task->stack, 64, SIM_HOST_STACK_BYTES) != 0)
+        {
+        simStop(SIM_EXIT_ASSERT, "no memory for a task stack");
+        }
+    memset(task->stack, SIM_STACK_FILL, SIM_HOST_STACK_BYTES);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, SIM_HOST_STACK_BYTES);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_create(&task->thread, &attr, simTaskThread, task);
+    pthread_attr_destroy(&attr);
+    if (handle != NULL)
+        {
+        *handle = task;
+        }
+    simMakeReady(task);
+    return(pdPASS);
+    }
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                           void* param, UBaseType_t priority, StackType_t* stack,
+                                           StaticTask_t* taskBuffer, BaseType_t core)
+    {
+    TaskHandle_t handle = NULL;
+    xTaskCreatePinnedToCore(function, name, stackDepth, param, priority, &handle, core);
+    return(handle);
+    }
+
+/// @brief The task's thread is parked for good rather than destroyed.
+void vTaskDelete(TaskHandle_t task)
+    {
+    if (task == NULL)
+        {
+        task = self;
+        }
+    task->deleted = true;
+    task->waitGeneration++;
+    readyTasks.erase(std::remove(readyTasks.begin(), readyTasks.end(), task), readyTasks.end());
+    if (task->waitingOn != NULL)
+        {
+        std::deque<SimTask*>& waiters = task->waitingOn->waiters;
+        waiters.erase(std::remove(waiters.begin(), waiters.end(), task), waiters.end());
+        }
+    if (task == self)
+        {
+        while (true)
+            {
+            simBlock();
+            }
+        }
+    }
+
+void vTaskDelay(TickType_t ticks)
+    {
+    if (self == NULL)
+        {
+        return;
+        }
+    if (ticks == 0)
+        {
+        yield();
+        return;
+        }
+    simScheduleTimeout(self, ticks);
+    simBlock();
+    }
+
+void yield(void)
+    {
+    if (self != NULL)
+        {
+        simMakeReady(self);
+        simBlock();
+        }
+    }
+
+/// @brief A busy wait on the Esp32.  Here the task gives up the CPU until
+/// then, as nothing else runs on the show task's core anyway.
+void delayMicroseconds(uint32_t us)
+    {
+    if (self == NULL || us == 0)
+        {
+        return;
+        }
+    SimTask* task = self;
+    uint32_t generation = task->waitGeneration;
+    simScheduleAt(nowUs + us, [task, generation]
+        {
+        if (task->waitGeneration == generation && !task->deleted)
+            {
+            task->waitGeneration++;
+            simMakeReady(task);
+            }
+        });
+    simBlock();
+    }
+
+/// @brief As FreeRTOS: wakes at previous + increment (at once if that has
+/// gone), which becomes the next previous, so a period doesn't drift.
+void vTaskDelayUntil(TickType_t* previousWakeTicks, TickType_t incrementTicks)
+    {
+    TickType_t wakeTicks = *previousWakeTicks + incrementTicks;
+    TickType_t nowTicks = xTaskGetTickCount();
+    *previousWakeTicks = wakeTicks;
+    if ((TickType_t) (wakeTicks - nowTicks) - 1 < incrementTicks)
+        {
+        vTaskDelay(wakeTicks - nowTicks);
+        }
+    }
+
+TickType_t xTaskGetTickCount(void)
+    {
+    return((TickType_t) (nowUs / (1000 * portTICK_PERIOD_MS)));
+    }
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+    {
+    return(self);
+    }
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+    {
+    SimTask* task = self;
+    if (task->notifyCount == 0 && ticksToWait != 0)
+        {
+        task->waitingForNotify = true;
+        simScheduleTimeout(task, ticksToWait);
+        simBlock();
+        task->waitingForNotify = false;
+        }
+    uint32_t value = task->notifyCount;
+    if (value > 0)
+        {
+        task->notifyCount = clearCountOnExit ? 0 : value - 1;
+        }
+    return(value);
+    }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+    {
+    task->notifyCount++;
+    if (task->waitingForNotify)
+        {
+        task->waitingForNotify = false;
+        simEndWait(task);
+        }
+    return(pdPASS);
+    }
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken)
+    {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken != NULL)
+        {
+        *higherPriorityTaskWoken = pdFALSE;
+        }
+    }
+
+/// @brief How much of the size asked for the task has never used, from how
+/// much of its host stack is still SIM_STACK_FILL (0 if it has used more).
+/// The host's stack frames aren't the ESP32's, and the stand-ins (Serial's
+/// stdio, say) aren't the real thing, so it is a guide rather than the figure.
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+    {
+    SimTask* simTask = (task != NULL) ? task : self;
+    uint32_t untouched = 0;
+    while (untouched < SIM_HOST_STACK_BYTES && simTask->stack[untouched] == SIM_STACK_FILL)
+        {
+        untouched++;
+        }
+    uint32_t used = SIM_HOST_STACK_BYTES - untouched;
+    return((used < simTask->stackDepth) ? simTask->stackDepth - used : 0);
+    }
+
+BaseType_t xPortGetCoreID(void)
+    {
+    return((self != NULL && self->core != tskNO_AFFINITY) ? self->core : 0);
+    }
+
+
+// FreeRTOS semaphores.
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+    {
+    SimSemaphore* semaphore = new SimSemaphore();
+    semaphore->count = 0;
+    semaphore->maxCount = 1;
+    return(semaphore);
+    }
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer)
+    {
+    return(xSemaphoreCreateBinary());
+    }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+    {
+    if (semaphore->count > 0)
+        {
+        semaphore->count--;
+        return(pdTRUE);
+        }
+    if (ticksToWait == 0 || self == NULL)
+        {
+        return(pdFALSE);
+        }
+    SimTask* task = self;
+    semaphore->waiters.push_back(task);
+    task->waitingOn = semaphore;
+    simScheduleTimeout(task, ticksToWait);
+    simBlock();
+    task->waitingOn = NULL;
+    return(task->timedOut ? pdFALSE : pdTRUE);
+    }
+
+/// @brief Hands the semaphore straight to the first waiter, if there is one.
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+    {
+    if (!semaphore->waiters.empty())
+        {
+        SimTask* task = semaphore->waiters.front();
+        semaphore->waiters.pop_front();
+        simEndWait(task);
+        return(pdTRUE);
+        }
+    if (semaphore->count < semaphore->maxCount)
+        {
+        semaphore->count++;
+        return(pdTRUE);
+        }
+    return(pdFALSE);
+    }
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken)
+    {
+    if (higherPriorityTaskWoken != NULL)
+        {
+        *higherPriorityTaskWoken = pdFALSE;
+        }
+    return(xSemaphoreGive(semaphore));
+    }
+
+
+// esp_timer.
+
+int64_t esp_timer_get_time(void)
+    {
+    return((int64_t) nowUs);
+    }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle)
+    {
+    SimEspTimer* timer = new SimEspTimer();
+    timer->callback = args->callback;
+    timer->arg = args->arg;
+    timer->name = args->name;
+    timer->generation = 0;
+    timer->armed = false;
+    *handle = timer;
+    return(ESP_OK);
+    }
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+    {
+    if (timer->armed)
+        {
+        return(ESP_ERR_INVALID_STATE);
+        }
+    timer->armed = true;
+    uint32_t generation = timer->generation;
+    simScheduleAt(nowUs + timeoutUs, [timer, generation]
+        {
+        if (timer->generation == generation)
+            {
+            timer->armed = false;
+            timer->callback(timer->arg);
+            }
+        });
+    return(ESP_OK);
+    }
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+    {
+    if (!timer->armed)
+        {
+        return(ESP_ERR_INVALID_STATE);
+        }
+    timer->generation++;
+    timer->armed = false;
+    return(ESP_OK);
+    }
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+    {
+    timer->generation++;
+    timer->armed = false;
+    return(ESP_OK);
+    }
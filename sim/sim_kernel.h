@@ -0,0 +1,45 @@
+#ifndef _SIM_KERNEL_H_
+#define _SIM_KERNEL_H_
+
+// Discrete event simulation kernel behind the simulated FreeRTOS, esp_timer
+// and FastLED RMT driver.
+//
+// Every FreeRTOS task is a host thread, but only one of them ever runs at a
+// time and it runs until it blocks (vTaskDelay, ulTaskNotifyTake, a
+// semaphore, yield).  Code takes no simulated time at all: time only moves
+// when every task is blocked, and then it jumps straight to the next event
+// (a delay or timeout ending, an esp_timer firing, an RMT transmission
+// finishing).  So a run is deterministic, an hour of wire time takes seconds,
+// and two cores look like two infinitely fast ones.
+// Priorities and core pinning are recorded but not used: ready tasks run in
+// the order they became ready.
+//
+// Events and esp_timer callbacks run on the kernel's own thread, as if from
+// an ISR or the esp_timer task, so they can give and notify but not block.
+
+#include <stdint.h>
+#include <functional>
+
+#define SIM_EXIT_OK             0
+#define SIM_EXIT_ASSERT         2
+#define SIM_EXIT_RESTART        3   // ESP.restart() was called.
+#define SIM_EXIT_DEADLOCK       4   // Nothing left to run and nothing scheduled.
+#define SIM_EXIT_LIVELOCK       5   // Tasks kept running without time moving on.
+
+// Task switches allowed at one instant before the run is declared a livelock.
+#define SIM_MAX_SWITCHES_PER_INSTANT    100000
+
+extern uint64_t simNowUs(void);
+extern void simScheduleAt(uint64_t atUs, std::function<void(void)> event);
+extern int simKernelRun(uint64_t untilUs);
+extern void simStop(int exitCode, const char* reason);
+extern bool simStopped(void);
+extern bool simInTask(void);
+extern uint64_t simTaskSwitches(void);
+extern void simAssertFailed(const char* condition, const char* file, int line);
+
+// Serial input, as if typed into the monitor.
+extern void simSerialInject(const char* text);
+extern void simSerialSetEcho(bool echo);
+
+#endif /* _SIM_KERNEL_H_ */
@@ -0,0 +1,251 @@
+// Runs the firmware's setup() and loop() on the host against the simulated
+// FastLED, FreeRTOS, esp_timer and RMT driver (see sim_kernel.h).
+//
+//      fastled_sim [--seconds N] [--key SECONDS:TEXT]... [--quiet]
+//                  [--drop-at BATCH]... [--drop-rate P] [--seed S] [--drop-stuck [--reset-fails]]
+//                  [--faults-csv FILE] [--rtc FILE]
+//
+// --seconds    How much simulated time to run for (default 60).
+// --key        Types TEXT into the serial monitor at SECONDS, e.g. --key 30:s
+//              dumps the frame statistics half a minute in.
+// --quiet      Don't print the serial output, just the summary.
+// --drop-at    Lose the RMT done interrupt of that batch (1 is the first show).
+// --drop-rate  Lose each done interrupt with probability P, from a generator
+//              seeded with --seed (default 1), so runs repeat exactly.
+// --drop-stuck Once one is lost, lose every one after it too, until a warm
+//              restart resets the RMT peripheral (ResetRMT()).
+// --reset-fails With --drop-stuck, the reset doesn't help either.
+// --faults-csv Write each fault (batch, when, recovery time, how) to FILE.
+// --rtc        Keep RTC_NOINIT_ATTR memory in FILE: loaded at the start (as
+//              a software reset) if it exists, saved at the end, so runs
+//              chained with it look like one device rebooting.
+//
+// The serial output goes to stdout with monitor style timestamps, then a
+// summary of what the simulated RMT driver sent and, if faults were
+// injected, how long the firmware took to get output going again after each
+// (the distribution, and what did it: GiveGTX_sem(), a gTX_sem timeout, a
+// warm restart's ResetRMT() or ESP.restart()).  The exit code is one of SIM_EXIT_* (0 if the run got to
+// the end).
+
+#include <Arduino.h>
+#include "sim_kernel.h"
+#include "sim_rmt.h"
+#include <esp_system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+extern void setup(void);
+extern void loop(void);
+
+// The linker's bounds of the RTC_NOINIT_ATTR section (weak, in case nothing is in it).
+extern char __start_sim_rtc_noinit[] __attribute__((weak));
+extern char __stop_sim_rtc_noinit[] __attribute__((weak));
+
+/// @brief As Arduino-ESP32's loopTask.
+static void simLoopTask(void* param)
+    {
+    setup();
+    while (true)
+        {
+        loop();
+        }
+    }
+
+static void simPrintSummary(uint64_t simUs, double hostSeconds)
+    {
+    SimRmtStats rmtStats;
+    simRmtGetStats(&rmtStats);
+    printf("sim: %.3f s simulated in %.3f s (%.0fx), %llu task switches\n", simUs / 1000000.0, hostSeconds,
+           (hostSeconds > 0) ? simUs / 1000000.0 / hostSeconds : 0.0, (unsigned long long) simTaskSwitches());
+    printf("sim: %u RMT batches, longest %llu us, %u gTX_sem timeouts, %u RMT resets\n", rmtStats.batches,
+           (unsigned long long) rmtStats.longestBatchUs, rmtStats.txSemTimeouts, rmtStats.resets);
+    for (uint8_t channel = 0; channel < simRmtChannelCount(); channel++)
+        {
+        SimRmtChannelStats stats;
+        simRmtGetChannelStats(channel, &stats);
+        // The rate is from the first frame on, so it isn't diluted by the boot.
+        uint64_t sendingUs = (stats.frames > 0) ? simUs - stats.firstStartUs : 0;
+        printf("sim: channel %u pin %u: %u frames (%.2f/s), %u parked, %llu LEDs, busy %.1f%%, %u latch violations, wire hash %08x\n",
+               channel, stats.pin, stats.frames, (sendingUs > 0) ? stats.frames * 1000000.0 / sendingUs : 0.0, stats.parked,
+               (unsigned long long) stats.ledsSent, (simUs > 0) ? stats.busyUs * 100.0 / simUs : 0.0, stats.latchViolations,
+               stats.wireHash);
+        }
+    }
+
+static const char* simRecoveryNames[] = { "not recovered", "GiveGTX_sem", "gTX_sem timeout", "RMT reset", "restart" };
+
+/// @brief Nearest rank percentile of sorted times, in ms: the smallest one
+/// with at least percentile % of them at or below it.
+static double simPercentileMs(const std::vector<uint64_t>& sortedUs, uint32_t percentile)
+    {
+    size_t rank = (size_t) ceil(percentile * sortedUs.size() / 100.0);
+    return(sortedUs[(rank > 0) ? rank - 1 : 0] / 1000.0);
+    }
+
+/// @brief Recovery time percentiles (over the recovered faults) and what did the recovering.
+static void simPrintFaults(const char* csvFile)
+    {
+    uint32_t faultCount = simRmtFaultCount();
+    FILE* csv = NULL;
+    if (csvFile != NULL)
+        {
+        csv = fopen(csvFile, "w");
+        if (csv != NULL)
+            {
+            fprintf(csv, "batch,dropped_us,recovered_us,recovery_us,how\n");
+            }
+        }
+    std::vector<uint64_t> recoveryUs;
+    uint32_t byHow[SIM_RECOVERY_RESTART + 1] = { 0 };
+    for (uint32_t i = 0; i < faultCount; i++)
+        {
+        const SimRmtFault* fault = simRmtGetFault(i);
+        byHow[fault->how]++;
+        uint64_t us = (fault->recoveredUs > 0) ? fault->recoveredUs - fault->droppedUs : 0;
+        if (fault->recoveredUs > 0)
+            {
+            recoveryUs.push_back(us);
+            }
+        if (csv != NULL)
+            {
+            fprintf(csv, "%u,%llu,%llu,%llu,%s\n", fault->batch, (unsigned long long) fault->droppedUs,
+                    (unsigned long long) fault->recoveredUs, (unsigned long long) us, simRecoveryNames[fault->how]);
+            }
+        }
+    if (csv != NULL)
+        {
+        fclose(csv);
+        }
+    printf("sim: %u faults injected:", faultCount);
+    for (int how = SIM_RECOVERY_GIVE_GTX_SEM; how <= SIM_RECOVERY_RESTART; how++)
+        {
+        printf(" %u by %s,", byHow[how], simRecoveryNames[how]);
+        }
+    printf(" %u not recovered\n", byHow[SIM_RECOVERY_NONE]);
+    if (!recoveryUs.empty())
+        {
+        std::sort(recoveryUs.begin(), recoveryUs.end());
+        printf("sim: recovery ms min %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f\n",
+               recoveryUs.front() / 1000.0, simPercentileMs(recoveryUs, 50), simPercentileMs(recoveryUs, 90),
+               simPercentileMs(recoveryUs, 99), recoveryUs.back() / 1000.0);
+        }
+    }
+
+/// @brief Loads (load true) or saves the RTC_NOINIT_ATTR section.
+/// @return false if there was nothing to load.
+static bool simRtcFile(const char* rtcFile, bool load)
+    {
+    size_t size = (size_t) (__stop_sim_rtc_noinit - __start_sim_rtc_noinit);
+    FILE* file = fopen(rtcFile, load ? "rb" : "wb");
+    if (file == NULL || __start_sim_rtc_noinit == NULL)
+        {
+        if (file != NULL)
+            {
+            fclose(file);
+            }
+        return(false);
+        }
+    bool bDone = load ? (fread(__start_sim_rtc_noinit, 1, size, file) == size)
+                      : (fwrite(__start_sim_rtc_noinit, 1, size, file) == size);
+    fclose(file);
+    return(bDone);
+    }
+
+int main(int argc, char** argv)
+    {
+    double seconds = 60;
+    double dropRate = 0;
+    uint32_t seed = 1;
+    const char* csvFile = NULL;
+    const char* rtcFile = NULL;
+    for (int i = 1; i < argc; i++)
+        {
+        std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc)
+            {
+            seconds = atof(argv[++i]);
+            }
+        else if (arg == "--key" && i + 1 < argc)
+            {
+            std::string key = argv[++i];
+            size_t colon = key.find(':');
+            if (colon == std::string::npos)
+                {
+                fprintf(stderr, "--key wants SECONDS:TEXT\n");
+                return(1);
+                }
+            uint64_t atUs = (uint64_t) (atof(key.substr(0, colon).c_str()) * 1000000);
+            std::string text = key.substr(colon + 1);
+            simScheduleAt(atUs, [text] { simSerialInject(text.c_str()); });
+            }
+        else if (arg == "--quiet")
+            {
+            simSerialSetEcho(false);
+            }
+        else if (arg == "--drop-at" && i + 1 < argc)
+            {
+            simRmtDropDoneAtBatch((uint32_t) strtoul(argv[++i], NULL, 10));
+            }
+        else if (arg == "--drop-rate" && i + 1 < argc)
+            {
+            dropRate = atof(argv[++i]);
+            }
+        else if (arg == "--seed" && i + 1 < argc)
+            {
+            seed = (uint32_t) strtoul(argv[++i], NULL, 10);
+            }
+        else if (arg == "--drop-stuck")
+            {
+            simRmtSetDropStuck(true);
+            }
+        else if (arg == "--reset-fails")
+            {
+            simRmtSetDropSurvivesReset(true);
+            }
+        else if (arg == "--faults-csv" && i + 1 < argc)
+            {
+            csvFile = argv[++i];
+            }
+        else if (arg == "--rtc" && i + 1 < argc)
+            {
+            rtcFile = argv[++i];
+            }
+        else
+            {
+            fprintf(stderr, "usage: %s [--seconds N] [--key SECONDS:TEXT]... [--quiet]\n"
+                            "          [--drop-at BATCH]... [--drop-rate P] [--seed S] [--drop-stuck [--reset-fails]]\n"
+                            "          [--faults-csv FILE] [--rtc FILE]\n", argv[0]);
+            return(1);
+            }
+        }
+    simRmtSetDropRate(dropRate, seed);
+    if (rtcFile != NULL && simRtcFile(rtcFile, true))
+        {
+        simSetResetReason(ESP_RST_SW);
+        }
+
+    xTaskCreatePinnedToCore(simLoopTask, "loopTask", 8192, NULL, 1, NULL, 1);
+    std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+    int exitCode = simKernelRun((uint64_t) (seconds * 1000000));
+    double hostSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - hostStart).count();
+    if (exitCode == SIM_EXIT_RESTART)
+        {
+        simRmtRecoveredByRestart();
+        }
+    simPrintSummary(simNowUs(), hostSeconds);
+    if (simRmtFaultCount() > 0 || csvFile != NULL)
+        {
+        simPrintFaults(csvFile);
+        }
+    if (rtcFile != NULL)
+        {
+        simRtcFile(rtcFile, false);
+        }
+    fflush(stdout);
+    // The task threads are parked, not finished, so don't wait for them.
+    _Exit(exitCode);
+    }
@@ -0,0 +1,74 @@
+#ifndef _SIM_RMT_H_
+#define _SIM_RMT_H_
+
+// The simulated FastLED Esp32 RMT driver (see FastLED.h), and what it saw.
+// A controller's wire time is its LEDs x 24 bits x the chipset bit time,
+// and its data is latched once the line has been low for the reset time,
+// so a channel that starts again sooner than that is a latch violation
+// (the LEDs would take the two frames as one).
+
+#include <stdint.h>
+
+#define SIM_RMT_MAX_CHANNELS    8
+
+typedef struct
+    {
+    uint8_t pin;
+    uint32_t frames;            // Batches this channel sent LEDs in.
+    uint32_t parked;            // Batches it took part in with no LEDs.
+    uint64_t firstStartUs;      // When its first frame went out.
+    uint64_t ledsSent;
+    uint64_t busyUs;            // Wire time.
+    uint32_t latchViolations;
+    uint64_t lastEndUs;
+    uint32_t wireHash;          // FNV-1a of every byte sent (after correction and brightness).
+    } SimRmtChannelStats;
+
+typedef struct
+    {
+    uint32_t batches;           // Shows that went out on the wire.
+    uint32_t txSemTimeouts;     // gTX_sem waits that gave up (FASTLED_RMT_MAX_TICKS_FOR_GTX_SEM).
+    uint32_t resets;            // ResetRMT() calls.
+    uint64_t longestBatchUs;
+    } SimRmtStats;
+
+// Fault injection: the "all channels done" interrupt that gives gTX_sem can
+// be dropped, as in the jams in logs/ (the data still goes out, but the last
+// showLeds() waits on gTX_sem for ever).  Either at chosen batches, or at
+// random with a seeded generator so a run can be repeated exactly.
+// A fault is recovered when the next batch goes out on the wire.
+// With simRmtSetDropStuck(true) every done interrupt after the first lost
+// one is lost too (the peripheral stays hung) until ResetRMT() resets it,
+// or for good with simRmtSetDropSurvivesReset(true), which is what it takes
+// to get as far as the ESP.restart() fallback.
+
+typedef enum
+    {
+    SIM_RECOVERY_NONE = 0,          // Not (yet) recovered.
+    SIM_RECOVERY_GIVE_GTX_SEM,      // GiveGTX_sem() un-jammed it.
+    SIM_RECOVERY_TX_SEM_TIMEOUT,    // The gTX_sem wait timed out.
+    SIM_RECOVERY_RMT_RESET,         // ResetRMT() (a warm restart).
+    SIM_RECOVERY_RESTART            // ESP.restart() (which ends the run).
+    } SimRecovery;
+
+typedef struct
+    {
+    uint32_t batch;
+    uint64_t droppedUs;             // When the interrupt should have come.
+    uint64_t recoveredUs;
+    SimRecovery how;
+    } SimRmtFault;
+
+extern void simRmtDropDoneAtBatch(uint32_t batch);
+extern void simRmtSetDropRate(double probability, uint32_t seed);
+extern void simRmtSetDropStuck(bool stuck);
+extern void simRmtSetDropSurvivesReset(bool survives);
+extern uint32_t simRmtFaultCount(void);
+extern const SimRmtFault* simRmtGetFault(uint32_t index);
+extern void simRmtRecoveredByRestart(void);
+
+extern uint8_t simRmtChannelCount(void);
+extern void simRmtGetChannelStats(uint8_t channel, SimRmtChannelStats* stats);
+extern void simRmtGetStats(SimRmtStats* stats);
+
+#endif /* _SIM_RMT_H_ */
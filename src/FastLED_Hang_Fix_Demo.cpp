@@ -1,6 +1,14 @@
 #include <Arduino.h>
 #include "debug_conditionals.h"
 #include "displayFastLedCommon.h"
+#include "fastLedShowScheduler.h"
+#include "telemetry.h"
+#include "fastLedStats.h"
+#include "telemetry_rtc.h"
+#include "boot_profile.h"
+#include "task_stats.h"
+#include "fastLedScrollText.h"
+#include "fastLedIngest.h"
 #include <freertos/portmacro.h>
 #include "FastLED_Hang_Fix_Demo.h"
 
@@ -8,8 +16,8 @@
 /// Just run it on an isolated Esp32.
 
 
-#ifndef ESP32
-# error "This code requires an ESP32"
+#if !defined(ESP32) && !defined(FASTLED_SIM)
+# error "This code requires an ESP32 (or the host simulation, see sim/)"
 #endif
 
 // This pathological timer interrupt borrowed (and then so heavily modified you wouldn't know it) from https://github.com/SensorsIot/ESP32-Interrupts-deepsleep/blob/master/Frequency_Counter_with_Timer_Interrupt/Frequency_Counter_with_Timer_Interrupt.ino
@@ -34,65 +42,166 @@ void IRAM_ATTR onTimer()
     }
 
 
-void setup(void)
+// The Arduino core makes the loop task, not us, but its stack is worth watching too.
+#ifndef CONFIG_ARDUINO_LOOP_STACK_SIZE
+# define CONFIG_ARDUINO_LOOP_STACK_SIZE 8192
+#endif
+
+#if FAST_BOOT
+# define BOOT_DELAY(y)  ((void)0)   // Nobody is watching the serial port yet.
+#else
+# define BOOT_DELAY(y)  DEBUG_DELAY(y)
+#endif
+
+
+/// @brief Who we are, and what the RTC telemetry says about the boots before.
+static void bootBanner(void)
     {
-    DEBUG_INITIALISE(false, 115200, SERIAL_8N1);
-    // WiFi.mode( WIFI_OFF );
-    // btStop();
-    DEBUG_INIT_SEMAPHORE;
-    vTaskDelay(xTickFullSec);
-    DEBUG_RESETCOLOUR();
-    DEBUG_DELAY(xTickFullSec);
     DEBUG_START_SEMAPHORE_BLOCK
         {
         DEBUG_PRINTLN("");
-        DEBUG_DELAY(xTickFullSec);
+        BOOT_DELAY(xTickFullSec);
         DEBUG_PRINTLN("");
-        DEBUG_DELAY(xTickFullSec);
+        BOOT_DELAY(xTickFullSec);
         DEBUG_PROGANNOUNCE("FastLED_Hang_Fix_Demo " VERSION_FASTLED_HANG_FIX_DEMO, "'" __FILE__ "'"  " Built: " __DATE__ " " __TIME__ ".");
+#if DEBUG_BINARY_TELEMETRY
+        uint32_t values[] = { getCpuFrequencyMhz(), (uint32_t) xPortGetCoreID() };
+        telemetryEmit(TELEMETRY_BOOT, values);
+#else
         DEBUG_PRINT("Starting comms ");
-        DEBUG_PRINT(esp_timer_get_time() / 1000000.0);
+        DEBUG_PRINT(bootProfileStageUs(BOOT_STAGE_SERIAL) / 1000000.0);
         DEBUG_PRINT(" seconds after boot");
         DEBUG_PRINTLN(".");
-        DEBUG_DELAY(xTickATinyBit);
+        BOOT_DELAY(xTickATinyBit);
         DEBUG_PRINT("Main App running on core ");
         DEBUG_PRINT(xPortGetCoreID());
         DEBUG_PRINT(" at ");
         DEBUG_PRINT(getCpuFrequencyMhz());
         DEBUG_PRINT(" MHz");
         DEBUG_PRINTLN(".");
-        DEBUG_DELAY(xTickATinyBit);
+#endif
+        BOOT_DELAY(xTickATinyBit);
         DEBUG_SEMAPHORE_RELEASE;
         }
-    DEBUG_DELAY(xTickATinyBit);
+    rtcTelemetryReport();
+    BOOT_DELAY(xTickATinyBit);
+    }
 
-    fastLedSetup();
+
+static void bootControllerReport(void)
+    {
     DEBUG_START_SEMAPHORE_BLOCK
         {
-        DEBUG_PRINT("FastLED controllers[0]->size() = ");
-        DEBUG_PRINT(controllers[0]->size());
-        DEBUG_PRINTLN(".");
-        DEBUG_PRINT("FastLED controllers[1]->size() = ");
-        DEBUG_PRINT(controllers[1]->size());
-        DEBUG_PRINTLN(".");
-        DEBUG_PRINT("FastLED controllers[2]->size() = ");
-        DEBUG_PRINT(controllers[2]->size());
-        DEBUG_PRINTLN(".");
-        DEBUG_PRINT("FastLED controllers[3]->size() = ");
-        DEBUG_PRINT(controllers[3]->size());
-        DEBUG_PRINTLN(".");
+        for (int i = 0; i < fastLedControllerCount(); i++)
+            {
+            DEBUG_PRINT("FastLED controllers[");
+            DEBUG_PRINT(i);
+            DEBUG_PRINT("]->size() = ");
+            DEBUG_PRINT(controllers[i]->size());
+            DEBUG_PRINT(" on pin ");
+            DEBUG_PRINT(fastLedGetOutput(i)->pin);
+            DEBUG_PRINTLN(".");
+            }
         DEBUG_PRINT("FastLED.count() = ");
         DEBUG_PRINT(FastLED.count());
         DEBUG_PRINTLN(".");
         DEBUG_SEMAPHORE_RELEASE;
         }
-    DEBUG_DELAY(xTickATinyBit);
+    BOOT_DELAY(xTickATinyBit);
     DEBUG_START_SEMAPHORE_BLOCK
         {
         DEBUG_ASSERT(controllers[0]->size() > 0);
-        DEBUG_ASSERT(FastLED.count() == 4);
+        DEBUG_ASSERT(FastLED.count() == fastLedControllerCount());
         DEBUG_SEMAPHORE_RELEASE;
         }
+    }
+
+
+static void bootCompleteReport(void)
+    {
+#if DEBUG_BINARY_TELEMETRY
+    uint32_t values[] = { uint32_t (bootProfileStageUs(BOOT_STAGE_SETUP_DONE) / 10000) };
+    telemetryEmit(TELEMETRY_INIT_COMPLETE, values);
+#else
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        DEBUG_PRINT("Initialisation Complete ");
+        DEBUG_PRINT(bootProfileStageUs(BOOT_STAGE_SETUP_DONE) / 1000000.0);
+        DEBUG_PRINT(" seconds after boot");
+        DEBUG_PRINTLN(".");
+        BOOT_DELAY(xTickATinyBit);
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+#endif
+    }
+
+
+// 'h' holds the strands (only the matrices are painted), so they don't change.
+// 'x' scrolls text across the matrices instead of painting them.
+static volatile bool bHoldStrands = false;
+static volatile bool bScrollText = false;
+
+#if !FASTLED_SPI_INGEST
+static FastLedScrollText scrollText[2];
+
+/// @brief Paints a frame of the stress load, timed.
+static void renderFrame(void)
+    {
+    uint64_t renderStartUs = esp_timer_get_time();
+    static bool bTextShown = false;
+    if (bScrollText && !bTextShown)
+        {
+        fastLedTextInit(&scrollText[0], FASTLED_MATRIX_LEFT, "FastLED Hang Fix Demo",
+                        CRGB::Orange, CRGB::Black, 1);
+        fastLedTextInit(&scrollText[1], FASTLED_MATRIX_RIGHT, "Version " VERSION_FASTLED_HANG_FIX_DEMO,
+                        CRGB::Cyan, CRGB::Black, 2);
+        }
+    bTextShown = bScrollText;
+    const uint8_t strands = (1 << FASTLED_STRAND_LEFT) | (1 << FASTLED_STRAND_RIGHT);
+    const uint8_t matrices = (1 << FASTLED_MATRIX_LEFT) | (1 << FASTLED_MATRIX_RIGHT);
+    uint8_t paintMask = (bHoldStrands ? 0 : strands) | (bTextShown ? 0 : matrices);
+    if (paintMask == (strands | matrices))
+        {
+        paint_random_leds(); // Add some random data to the LEDs
+        }
+    else
+        {
+        paint_random_segments(paintMask);
+        }
+    if (bTextShown)
+        {
+        fastLedTextRender(&scrollText[0]);
+        fastLedTextRender(&scrollText[1]);
+        }
+    fastLedStatsRecord(FASTLED_HIST_RENDER, (uint32_t) (esp_timer_get_time() - renderStartUs));
+    }
+#endif
+
+
+void setup(void)
+    {
+    bootProfileMark(BOOT_STAGE_SETUP);
+    rtcTelemetryBoot();     // Before anything can jam.
+    taskStatsRegister(xTaskGetCurrentTaskHandle(), "loopTask", CONFIG_ARDUINO_LOOP_STACK_SIZE, false);
+    DEBUG_INITIALISE(false, 115200, SERIAL_8N1);
+    // WiFi.mode( WIFI_OFF );
+    // btStop();
+    DEBUG_INIT_SEMAPHORE;
+#if !FAST_BOOT
+    vTaskDelay(xTickFullSec);
+#endif
+    DEBUG_RESETCOLOUR();
+    BOOT_DELAY(xTickFullSec);
+    bootProfileMark(BOOT_STAGE_SERIAL);
+#if !FAST_BOOT
+    bootBanner();
+#endif
+
+    fastLedSetup();
+    bootProfileMark(BOOT_STAGE_FASTLED_SETUP);
+#if !FAST_BOOT
+    bootControllerReport();
+#endif
 
 
 // Some pathological interrupt stuff to run in the background
@@ -107,22 +216,37 @@ void setup(void)
     clear_all_leds();
     vTaskDelay(pdMS_TO_TICKS(1));
     FastLEDshow();
-    DEBUG_DELAY(xTickATinyBit);
+#if FASTLED_SPI_INGEST
+    fastLedIngestStart();                   // Frames come from the host from now on.
+#elif FASTLED_RENDER_PIPELINE
+    fastLedStartRenderTask(renderFrame);    // Paints from now on, not the loop.
+#endif
+    bootProfileMark(BOOT_STAGE_SETUP_DONE);
+    BOOT_DELAY(xTickATinyBit);
 
-    DEBUG_START_SEMAPHORE_BLOCK
-        {
-        DEBUG_PRINT("Initialisation Complete ");
-        DEBUG_PRINT(esp_timer_get_time() / 1000000.0);
-        DEBUG_PRINT(" seconds after boot");
-        DEBUG_PRINTLN(".");
-        DEBUG_DELAY(xTickATinyBit);
-        DEBUG_SEMAPHORE_RELEASE;
-        }
+#if !FAST_BOOT
+    bootCompleteReport();
+#endif
     count = 0;
     frequency = count;
     }
 
 
+// Printed by loop() once the first frame is on the wire.  With FAST_BOOT
+// that's everything setup() would otherwise have printed as well.
+static void (* const bootReports[])(void) =
+    {
+#if FAST_BOOT
+    bootBanner,
+    bootControllerReport,
+    fastLedFrameRateReport,
+    bootCompleteReport,
+#endif
+    bootProfileReport,
+    taskStatsReport
+    };
+
+
 #define MINUTES_BETWEEN_REPORTS 1
 
 void loop(void)
@@ -133,14 +257,71 @@ void loop(void)
 #endif    
 
     vTaskDelay(xTickATinyBit);
-    paint_random_leds(); // Add some random data to the LEDs
+#if !FASTLED_RENDER_PIPELINE && !FASTLED_SPI_INGEST
+    renderFrame();
     vTaskDelay(pdMS_TO_TICKS(1));
     FastLEDshow(); // Now show the LEDs
+#endif
 
 #if DEBUG_ON    
+    // Frame timing on demand: 's' dumps the histograms, 'r' resets them,
+    // 'b' benchmarks paint_random_leds() (not with the render task, as it
+    // paints the back buffer), 't' shows the RTC telemetry,
+    // 'm' shows the task stacks and the heap, 'h' holds (or lets go of) the strands,
+    // 'x' starts (or stops) the scrolling text, 'i' shows the SPI ingest packet counts.
+    if (Serial.available() > 0)
+        {
+        switch (Serial.read())
+            {
+            case 's':
+                fastLedStatsDump();
+                break;
+            case 'r':
+                fastLedStatsReset();
+                break;
+#if !FASTLED_RENDER_PIPELINE && !FASTLED_SPI_INGEST
+            case 'b':
+                paint_random_leds_benchmark(100);
+                break;
+#endif
+            case 't':
+                rtcTelemetryReport();
+                break;
+            case 'm':
+                taskStatsReport();
+                break;
+            case 'h':
+                bHoldStrands = !bHoldStrands;
+                break;
+            case 'x':
+                bScrollText = !bScrollText;
+                break;
+#if FASTLED_SPI_INGEST
+            case 'i':
+                fastLedIngestReport();
+                break;
+#endif
+            }
+        }
     loopTime++;
+    static uint8_t bootReportsDone = 0;
+    if (bootReportsDone < NO_OF_ELEMS(bootReports) && bootProfileComplete())
+        {
+        bootReports[bootReportsDone++]();   // One a pass, so the debug log keeps up.
+        }
     if (bReport)
         {
+#if DEBUG_BINARY_TELEMETRY
+        FastLedShowSchedulerStats stats;
+        showSchedulerGetStats(&stats);
+        uint32_t values[] = { uint32_t (esp_timer_get_time() / 1000000),
+                              uint32_t (loopTime * 100 / (MINUTES_BETWEEN_REPORTS * 60)),
+                              uint32_t (frequency / (MINUTES_BETWEEN_REPORTS * 60)),
+                              stats.framesShown, stats.framesCoalesced, stats.framesDropped };
+        telemetryEmit(TELEMETRY_LOOP_REPORT, values);
+        loopTime = 0;
+        frequency = 0;
+#else
         DEBUG_START_SEMAPHORE_BLOCK
             {
             debugDisplaySeconds("Running continuously for ", 
@@ -150,11 +331,21 @@ void loop(void)
             DEBUG_PRINT(" loops per sec (int = ");
             DEBUG_PRINT(frequency/(MINUTES_BETWEEN_REPORTS * 60.0));
             DEBUG_PRINTLN("/sec).");
+            FastLedShowSchedulerStats stats;
+            showSchedulerGetStats(&stats);
+            DEBUG_PRINT("Frames shown ");
+            DEBUG_PRINT(stats.framesShown);
+            DEBUG_PRINT(", coalesced ");
+            DEBUG_PRINT(stats.framesCoalesced);
+            DEBUG_PRINT(", dropped ");
+            DEBUG_PRINT(stats.framesDropped);
+            DEBUG_PRINTLN(" since boot.");
             loopTime = 0;
             frequency = 0;
             DEBUG_DELAY(xTickATinyBit);
             DEBUG_SEMAPHORE_RELEASE;
             }
+#endif
         bReport = false;
         }
     EVERY_N_MINUTES(MINUTES_BETWEEN_REPORTS)
@@ -10,8 +10,14 @@
 #define VERSION_FASTLED_HANG_FIX_DEMO "1.1.3"
 #define NO_OF_ELEMS(x) (sizeof(x)/sizeof((x)[0]))
 
+// If true setup() doesn't wait for the serial monitor and the banner, RTC
+// telemetry, controller list and frame rates are printed by loop() once the
+// first frame is on the wire (along with the boot profile, which is printed
+// either way).  The LEDs get their first frame a second or so sooner.
+#define FAST_BOOT false
 
-#if defined(ESP32)
+
+#if defined(ESP32) || defined(FASTLED_SIM)
 
 // START OF PINS 
 // This is on DOIT ESP32 DEVKIT V1 (In this case a Lonely Binary clone... but I assume they are all the same, right?)
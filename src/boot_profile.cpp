@@ -0,0 +1,92 @@
+#include "debug_conditionals.h"
+#include "telemetry.h"
+#include "boot_profile.h"
+
+static uint64_t stageUs[BOOT_STAGE_COUNT] = { 0 };
+static bool bStageMarked[BOOT_STAGE_COUNT] = { false };
+
+static const char* const stageNames[BOOT_STAGE_COUNT] =
+    {
+    "setup()",
+    "serial",
+    "fastLedSetup()",
+    "show task",
+    "fastLedPostInit()",
+    "setup() done",
+    "first frame",
+    };
+
+
+/// @brief Notes the time a stage is first reached.  Cheap enough for the show task.
+void bootProfileMark(BootStage stage)
+    {
+    if (!bStageMarked[stage])
+        {
+        stageUs[stage] = esp_timer_get_time();
+        bStageMarked[stage] = true;
+        }
+    }
+
+
+uint64_t bootProfileStageUs(BootStage stage)
+    {
+    return(stageUs[stage]);
+    }
+
+
+/// @brief Whether the first frame has made it (so the profile is worth printing).
+bool bootProfileComplete(void)
+    {
+    return(bStageMarked[BOOT_STAGE_FIRST_FRAME]);
+    }
+
+
+/// @brief Prints each stage's time since boot and since the stage before.
+void bootProfileReport(void)
+    {
+#ifdef DEBUG_ON
+# if DEBUG_BINARY_TELEMETRY
+    uint32_t values[BOOT_STAGE_COUNT - 1];
+    for (int stage = BOOT_STAGE_SERIAL; stage < BOOT_STAGE_COUNT; stage++)
+        {
+        values[stage - 1] = (uint32_t) (stageUs[stage] / 10);
+        }
+    telemetryEmit(TELEMETRY_BOOT_PROFILE, values);
+# else
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        // In the order they happened (the show task runs alongside setup()).
+        uint8_t order[BOOT_STAGE_COUNT];
+        for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++)
+            {
+            uint8_t j = i;
+            for ( ; j > 0 && stageUs[order[j - 1]] > stageUs[i]; j--)
+                {
+                order[j] = order[j - 1];
+                }
+            order[j] = i;
+            }
+        DEBUG_PRINTLN("Boot profile (ms since boot, and since the stage before):");
+        uint64_t previousUs = 0;
+        for (uint8_t i = 0; i < BOOT_STAGE_COUNT; i++)
+            {
+            uint8_t stage = order[i];
+            DEBUG_PRINT("  ");
+            DEBUG_PRINT(stageNames[stage]);
+            if (!bStageMarked[stage])
+                {
+                DEBUG_PRINTLN(" not reached.");
+                continue;
+                }
+            DEBUG_PRINT(" ");
+            DEBUG_PRINT(stageUs[stage] / 1000.0, 1);
+            DEBUG_PRINT(" (+");
+            DEBUG_PRINT((stageUs[stage] - previousUs) / 1000.0, 1);
+            DEBUG_PRINTLN(")");
+            previousUs = stageUs[stage];
+            }
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+# endif
+#endif
+    }
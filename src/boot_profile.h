@@ -0,0 +1,29 @@
+#ifndef _BOOT_PROFILE_H_
+#define _BOOT_PROFILE_H_
+
+#include <Arduino.h>
+
+// Boot stage timestamps (esp_timer_get_time(), so microseconds since the app
+// started; the bootloader before that isn't counted).  Each stage is marked
+// the first time it is reached and later marks are ignored, so a warm
+// restart doesn't move the show task's.  The loop prints the profile (or
+// sends a boot_profile record) once the first frame is on the wire.
+
+typedef enum
+    {
+    BOOT_STAGE_SETUP = 0,       // setup() entered.
+    BOOT_STAGE_SERIAL,          // Serial port and debug output ready.
+    BOOT_STAGE_FASTLED_SETUP,   // Controllers added, show task created.
+    BOOT_STAGE_SHOW_TASK,       // Show task running (bFastLedReady).
+    BOOT_STAGE_POST_INIT,       // Frame periods worked out, governor running.
+    BOOT_STAGE_SETUP_DONE,      // setup() returned.
+    BOOT_STAGE_FIRST_FRAME,     // First show back from the wire.
+    BOOT_STAGE_COUNT
+    } BootStage;
+
+extern void bootProfileMark(BootStage stage);
+extern uint64_t bootProfileStageUs(BootStage stage);
+extern bool bootProfileComplete(void);
+extern void bootProfileReport(void);
+
+#endif /* _BOOT_PROFILE_H_ */
@@ -9,6 +9,7 @@ const unsigned long xTickFiveSecs = (5000 / portTICK_PERIOD_MS);
 
 #ifdef DEBUG_ON
 
+#if !DEBUG_ASYNC_LOG
 #ifdef ESP32
 StaticSemaphore_t xSemaphoreSerialPortBuffer;
 #endif
@@ -39,6 +40,7 @@ void giveSemaphore(void)
     vTaskDelay(xTickATinyBit); // Allow a little time for the serial port to do its print.
     xSemaphoreGive(xBinarySemaphoreSerialPort);
     }
+#endif
 
 void debugDisplaySeconds(const char* sMessage, uint32_t seconds_run_time)
     {
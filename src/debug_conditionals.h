@@ -43,16 +43,44 @@ extern  void debugDisplaySeconds(const char* sMessage, uint32_t seconds_run_time
 
 # define DEBUG_FASTLED_JAM true
 # define DEBUG_UPDATE_FREQUENCY false  // Show number of loops per second every minute.
+# define DEBUG_BINARY_TELEMETRY false  // Send the jam and per-minute reports as compact 
+                                       // records (see telemetry_format.h) rather than text.
+
+// If true DEBUG_PRINT, DEBUG_PRINTLN, DEBUG_PROGANNOUNCE, DEBUG_ASSERT and
+// DEBUG_RESETCOLOUR go into a lock-free RAM ring which a task on core 0 writes
+// to the serial port (see debug_log_ring.h), so printing never blocks. The
+// semaphore blocks and DEBUG_DELAY then do nothing.
+# define DEBUG_ASYNC_LOG true
 
 #  include <debuggery.h>
+#  if DEBUG_ASYNC_LOG
+#   include "debug_log_ring.h"
+#   undef DEBUG_PRINT
+#   undef DEBUG_PRINTLN
+#   undef DEBUG_PROGANNOUNCE
+#   undef DEBUG_RESETCOLOUR
+#   define DEBUG_PRINT(...)                 do { DebugLogLine debugLine; debugLine.print(__VA_ARGS__); debugLine.send(); } while (0)
+#   define DEBUG_PRINTLN(...)               do { DebugLogLine debugLine; debugLine.println(__VA_ARGS__); debugLine.send(); } while (0)
+#   define DEBUG_PROGANNOUNCE(name, detail) do { DebugLogLine debugLine; debugLine.print(name); debugLine.print(" "); debugLine.println(detail); debugLine.send(); } while (0)
+#   define DEBUG_RESETCOLOUR()              DEBUG_PRINT("\033[0m")
+#   ifndef FASTLED_SIM  // The simulation's stops the run.
+#    undef DEBUG_ASSERT
+#    define DEBUG_ASSERT(condition)         do { if (!(condition)) debugLogAssertFailed(#condition, __FILE__, __LINE__); } while (0)
+#   endif
+#   define DEBUG_INIT_SEMAPHORE             debugLogInit()
+#   define DEBUG_START_SEMAPHORE_BLOCK      if(true)
+#   define DEBUG_SEMAPHORE_RELEASE          ((void)0)
+#   define DEBUG_DELAY(y)                   ((void)0)
+#  else
 extern void initSemaphore(void);
 extern bool takeSemaphore(void);
 extern void giveSemaphore(void);
 
-#  define DEBUG_INIT_SEMAPHORE              initSemaphore()
-#  define DEBUG_START_SEMAPHORE_BLOCK       if(takeSemaphore())
-#  define DEBUG_SEMAPHORE_RELEASE           giveSemaphore()
-#  define DEBUG_DELAY(y)                    vTaskDelay(y)
+#   define DEBUG_INIT_SEMAPHORE             initSemaphore()
+#   define DEBUG_START_SEMAPHORE_BLOCK      if(takeSemaphore())
+#   define DEBUG_SEMAPHORE_RELEASE          giveSemaphore()
+#   define DEBUG_DELAY(y)                   vTaskDelay(y)
+#  endif
 # else
 # define FASTLED_RMT_SERIAL_DEBUG  0
 #  include <not_debuggery.h>
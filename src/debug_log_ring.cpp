@@ -0,0 +1,224 @@
+#include "debug_conditionals.h"
+
+#if DEBUG_ASYNC_LOG
+#include <atomic>
+#include "debug_log_ring.h"
+#include "task_stats.h"
+
+// A bounded multi-producer queue after Dmitry Vyukov's
+// (cf https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue)
+// Each slot carries a sequence number, which tells a producer whether the slot
+// is free for this lap of the ring, and tells the consumer whether it has been
+// filled in yet.  Producers only ever fight over enqueuePos (one compare and
+// swap for all the slots a print needs, so a print's text is always together
+// in the ring), and only the drain task moves dequeuePos.
+
+typedef struct
+    {
+    std::atomic<uint32_t> sequence;
+    uint8_t length;
+    char text[DEBUG_LOG_SLOT_BYTES];
+    } DebugLogSlot;
+
+static DebugLogSlot logSlots[DEBUG_LOG_SLOTS];
+static std::atomic<uint32_t> enqueuePos(0);
+static uint32_t dequeuePos = 0;
+static std::atomic<uint32_t> overflowCount(0);
+static bool bLogSlotsReady = false;
+
+static void debugLogDrainTask(void* param);
+
+
+static void debugLogInitSlots(void)
+    {
+    for (uint32_t i = 0; i < DEBUG_LOG_SLOTS; i++)
+        {
+        logSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    bLogSlotsReady = true;
+    }
+
+
+/// @brief Starts the drain task that owns the serial port.
+/// Anything printed before this is already sitting in the ring.
+void debugLogInit(void)
+    {
+    if (!bLogSlotsReady)
+        {
+        debugLogInitSlots();
+        }
+    static StackType_t drainTaskStack[DEBUG_LOG_DRAIN_STACK_BYTES];
+    static StaticTask_t drainTaskBuffer;
+    TaskHandle_t drainTask = xTaskCreateStaticPinnedToCore(
+        debugLogDrainTask,
+        "debugLogDrainTask",
+        DEBUG_LOG_DRAIN_STACK_BYTES,
+        NULL,
+        DEBUG_LOG_DRAIN_PRIORITY,
+        drainTaskStack,
+        &drainTaskBuffer,
+        DEBUG_LOG_DRAIN_CORE);
+    taskStatsRegister(drainTask, "debugLogDrainTask", DEBUG_LOG_DRAIN_STACK_BYTES, true);
+    }
+
+
+/// @brief Copies some text into the ring, in consecutive slots so nothing
+/// else printed at the same time can land in the middle of it.  Never blocks.
+/// @return false if there wasn't room for all of it (it is counted and lost).
+bool debugLogEnqueue(const uint8_t* buffer, size_t size)
+    {
+    if (!bLogSlotsReady)
+        {
+        debugLogInitSlots(); // Printing before DEBUG_INIT_SEMAPHORE.
+        }
+    if (size == 0)
+        {
+        return(true);
+        }
+    uint32_t slots = (size + DEBUG_LOG_SLOT_BYTES - 1) / DEBUG_LOG_SLOT_BYTES;
+    if (slots > DEBUG_LOG_SLOTS)
+        {
+        overflowCount.fetch_add(1, std::memory_order_relaxed);
+        return(false);
+        }
+    uint32_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+        {
+        // The drain task frees slots in order, so if the last one we want
+        // is free this lap then so are the ones before it.
+        DebugLogSlot* first = &logSlots[pos & (DEBUG_LOG_SLOTS - 1)];
+        DebugLogSlot* last = &logSlots[(pos + slots - 1) & (DEBUG_LOG_SLOTS - 1)];
+        int32_t dif = (int32_t) first->sequence.load(std::memory_order_acquire) - (int32_t) pos;
+        if (dif == 0)
+            {
+            if ((int32_t) last->sequence.load(std::memory_order_acquire) - (int32_t) (pos + slots - 1) < 0)
+                {
+                overflowCount.fetch_add(1, std::memory_order_relaxed);
+                return(false);
+                }
+            if (enqueuePos.compare_exchange_weak(pos, pos + slots, std::memory_order_relaxed))
+                {
+                break;
+                }
+            }
+        else if (dif < 0)
+            {
+            overflowCount.fetch_add(1, std::memory_order_relaxed);
+            return(false);
+            }
+        else
+            {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    for (uint32_t i = 0; i < slots; i++)
+        {
+        DebugLogSlot* slot = &logSlots[(pos + i) & (DEBUG_LOG_SLOTS - 1)];
+        uint8_t length = (size > DEBUG_LOG_SLOT_BYTES) ? DEBUG_LOG_SLOT_BYTES : (uint8_t) size;
+        memcpy(slot->text, buffer, length);
+        slot->length = length;
+        slot->sequence.store(pos + i + 1, std::memory_order_release);
+        buffer += length;
+        size -= length;
+        }
+    return(true);
+    }
+
+
+/// @brief Writes everything currently in the ring to out.
+/// Only the drain task should call this (there is only one consumer).
+/// @return Number of bytes written.
+size_t debugLogDrain(Print& out)
+    {
+    size_t written = 0;
+    while (true)
+        {
+        DebugLogSlot* slot = &logSlots[dequeuePos & (DEBUG_LOG_SLOTS - 1)];
+        if (slot->sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+            {
+            break; // Empty, or the producer hasn't finished copying yet.
+            }
+        written += out.write((const uint8_t*) slot->text, slot->length);
+        slot->sequence.store(dequeuePos + DEBUG_LOG_SLOTS, std::memory_order_release);
+        dequeuePos++;
+        }
+    return(written);
+    }
+
+
+uint32_t debugLogOverflowCount(void)
+    {
+    return(overflowCount.load(std::memory_order_relaxed));
+    }
+
+
+size_t DebugLogLine::write(uint8_t c)
+    {
+    return(write(&c, 1));
+    }
+
+
+size_t DebugLogLine::write(const uint8_t* buffer, size_t size)
+    {
+    size_t written = size;
+    while (size > 0)
+        {
+        if (length == sizeof(text))
+            {
+            send(); // Longer than a line, so it goes in pieces.
+            }
+        size_t part = sizeof(text) - length;
+        part = (size < part) ? size : part;
+        memcpy(text + length, buffer, part);
+        length += part;
+        buffer += part;
+        size -= part;
+        }
+    return(written);
+    }
+
+
+/// @brief Puts what has been printed into the ring, in one go.
+void DebugLogLine::send(void)
+    {
+    debugLogEnqueue(text, length);
+    length = 0;
+    }
+
+
+/// @brief Assert failed, said through the ring like everything else.
+void debugLogAssertFailed(const char* condition, const char* file, int line)
+    {
+    DebugLogLine message;
+    message.print("ASSERT failed: ");
+    message.print(condition);
+    message.print(", ");
+    message.print(file);
+    message.print(":");
+    message.println(line);
+    message.send();
+    }
+
+
+/// @brief Low priority task on core 0 that does all the (slow) serial writes.
+/// @param param unused.
+static void debugLogDrainTask(void* param)
+    {
+    (void) param;
+    uint32_t overflowsReported = 0;
+    while (true)
+        {
+        debugLogDrain(Serial);
+        uint32_t overflows = debugLogOverflowCount();
+        if (overflows != overflowsReported)
+            {
+            Serial.print("[debug log overflowed ");
+            Serial.print(overflows - overflowsReported);
+            Serial.println(" time(s)]");
+            overflowsReported = overflows;
+            }
+        vTaskDelay(pdMS_TO_TICKS(DEBUG_LOG_DRAIN_POLL_MS));
+        }
+    }
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef _DEBUG_LOG_RING_H_
+# define _DEBUG_LOG_RING_H_
+
+#include <Arduino.h>
+
+// Non-blocking replacement for printing straight to the serial port.
+// DEBUG_PRINT, DEBUG_PRINTLN and the rest of the debuggery macros (see
+// debug_conditionals.h) write into a lock-free ring of small fixed size
+// slots in RAM, and a low priority task on core 0 is the only thing that
+// ever touches the UART.
+// Any task (or ISR) can write.  If the ring is full the text is thrown away
+// and counted, rather than making the caller wait.
+// Each print is gathered in a DebugLogLine on the caller's stack (a println
+// with its CR LF) and takes all the slots it needs at once, so nothing can
+// land in the middle of it.  Output from two tasks printing at the same time
+// can still interleave between prints, so a line that matters (a telemetry
+// record, say) should be one DEBUG_PRINTLN.
+
+# define DEBUG_LOG_SLOTS            256 // Must be a power of 2.  Room for the biggest report, the
+                                        // 's' dump (about 1.9 KB), and whatever else comes in the same poll.
+# define DEBUG_LOG_SLOT_BYTES       27  // Text per slot, longer prints use more slots.
+# define DEBUG_LOG_LINE_BYTES       128 // A print longer than this goes in pieces.
+# define DEBUG_LOG_DRAIN_CORE       0
+# define DEBUG_LOG_DRAIN_PRIORITY   (tskIDLE_PRIORITY + 1)
+# define DEBUG_LOG_DRAIN_POLL_MS    10
+# define DEBUG_LOG_DRAIN_STACK_BYTES 8192    // The simulation's peak is about 7.8 KB, mostly stdio.
+
+static_assert((DEBUG_LOG_SLOTS & (DEBUG_LOG_SLOTS - 1)) == 0, "DEBUG_LOG_SLOTS must be a power of 2");
+
+// One print's text, enqueued by send().
+class DebugLogLine : public Print
+    {
+    public:
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t* buffer, size_t size) override;
+        using Print::write;
+        void send(void);
+
+    private:
+        uint8_t text[DEBUG_LOG_LINE_BYTES];
+        size_t length = 0;
+    };
+
+extern void debugLogInit(void);
+extern bool debugLogEnqueue(const uint8_t* buffer, size_t size);
+extern size_t debugLogDrain(Print& out);
+extern uint32_t debugLogOverflowCount(void);
+extern void debugLogAssertFailed(const char* condition, const char* file, int line);
+
+#endif /* _DEBUG_LOG_RING_H_ */
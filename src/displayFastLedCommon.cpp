@@ -1,35 +1,106 @@
 
-#ifndef ESP32
-#error "This code requires an ESP32"
+#if !defined(ESP32) && !defined(FASTLED_SIM)
+#error "This code requires an ESP32 (or the host simulation, see sim/)"
 #endif
 #include "FastLED_Hang_Fix_Demo.h"
 #include "debug_conditionals.h"
 
 
 #include "displayFastLedCommon.h" // here is where we call FastLED.h
+#include "fastLedShowScheduler.h"
+#include "telemetry.h"
+#include "fastLedStats.h"
+#include "fastLedFrameGovernor.h"
+#include "fastLedJamWatchdog.h"
+#include "telemetry_rtc.h"
+#include "fastLedOutputPlanner.h"
+#include "fastLedOutputStage.h"
+#include "fastLedPowerBudget.h"
+#include "fastLedMatrix.h"
+#include "boot_profile.h"
+#include "task_stats.h"
+#include "fastLedRandomFill.h"
 
 
 // FastLED controller stuff
 bool bFastLedReady = false;
 bool bFastLedInitialised = false;
 
-CLEDController* controllers[NUM_FASTLED_CONTROLLERS] = { NULL };
+CLEDController* controllers[FASTLED_MAX_CONTROLLERS] = { NULL };
 
+// The controller registry, filled in by fastLedAddOutput() during fastLedSetup().
+static FastLedOutput fastLedOutputs[FASTLED_MAX_CONTROLLERS];
+static uint8_t fastLedOutputCount = 0;
+
+// Pins fastLedAddOutput() can drive.  FastLED wants the pin as a template
+// parameter, so each pin here gets a controller instantiated for both chipsets.
+// The demo doesn't use DMX or the VSPI shift register, so those pins can
+// make up the other four RMT channels.
+#define FASTLED_OUTPUT_PINS(X) \
+    X(LEFT_OUT_LED_STRAND_PIN) \
+    X(RIGHT_OUT_LED_STRAND_PIN) \
+    X(LEFT_OUT_LED_MATRIX_PIN) \
+    X(RIGHT_OUT_LED_MATRIX_PIN) \
+    X(DMX_TX) \
+    X(DMX_RTS) \
+    X(GPIO_VPSI_MOSI) \
+    X(GPIO_VPSI_CLK)
 
-static volatile bool NotShowing = true;
 uint8_t FastLedCommonDitherMode = 0;
 
-// This is global to block updates when needed
-volatile bool bFastLEDShowWait = false;
 TaskHandle_t FastLedShowHandlerTaskSignal = NULL;
 float lowestFrameRateInUse = 400;
-uint16_t frameRateInMilliseconds = 400;
+uint32_t longestWireTimeUs = 0;
+
+// Each group's frame period, the wire time of its longest controller.
+static uint32_t groupPeriodsUs[NUM_FASTLED_GROUPS] = {};
+
+// What the jam watchdog does when a show goes past its deadline (wire time
+// plus the learned margin), one step per jam or per wait while it stays jammed.
+// Waits are in frame periods after the deadline (or the step before).
+static const FastLedJamStep jamLadder[] =
+    {
+    //  action                      wait
+        { FASTLED_JAM_GIVE_GTX_SEM, 0 },
+        { FASTLED_JAM_GIVE_GTX_SEM, 4 },
+#if FASTLED_RMT_RESET
+        { FASTLED_JAM_WARM_RESTART, 16 },
+#endif
+        { FASTLED_JAM_RESTART,      64 },   // About a second at 70 Hz.
+    };
+
+#if DEBUG_FASTLED_JAM
+static const char* const jamActionNames[FASTLED_JAM_ACTION_COUNT] = { "GiveGTX_sem", "restart", "warm restart" };
+#endif
+
+// How long a warm restart waits for the show task to come out of FastLED.show().
+#define FASTLED_WARM_RESTART_WAIT_MS    50
 
 void IRAM_ATTR fastLedShowHandlerTask(void* param);
+/// @brief How long a show of the controllers in controllerMask should take
+/// (they go out in parallel, so the longest one).
+static uint32_t fastLedMaskWireTimeUs(uint8_t controllerMask)
+    {
+    uint32_t wireTimeUs = 0;
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        if ((controllerMask & (1 << i)) && fastLedWireTimeUs(fastLedOutputs[i].size) > wireTimeUs)
+            {
+            wireTimeUs = fastLedWireTimeUs(fastLedOutputs[i].size);
+            }
+        }
+    return(wireTimeUs);
+    }
+
+
 void setupFastLedShowHandlerTask(void);
 
 #define WRITE_FASTLED_SHOW_PRIORITY 1
 #define WRITE_FASTLED_SHOW_CORE 1
+// In bytes (ESP-IDF counts stacks in bytes), about 10.5 KB, the size it
+// always had from the heap.  The simulation measures about 7.9 KB on the host,
+// which over-counts; only cut it from an 'm' report on an Esp32.
+#define WRITE_FASTLED_SHOW_STACK_BYTES (configMINIMAL_STACK_SIZE + 10000)
 // Note increasing WRITE_FASTLED_SHOW_PRIORITY beyond 1 seems to add stutter
 // to the system and reduce overall throughput.  0 seems to hang it!
 // And FastLED HAS to operate on Core 1.
@@ -37,68 +108,329 @@ void setupFastLedShowHandlerTask(void);
 // weird things (like flickering and partial writes) seem to happen, and running slow and hangs, so
 // it must be core 1 the same as the mainloop.
 
+// The render task (FASTLED_RENDER_PIPELINE) only paints into the arena, so
+// it can have core 0, below the output stage so that is never kept waiting.
+// Its stack covers the simulation's measured peak (about 7.5 KB on the host).
+#define FASTLED_RENDER_CORE         0
+#define FASTLED_RENDER_PRIORITY     (tskIDLE_PRIORITY + 1)
+#define FASTLED_RENDER_STACK_BYTES  8192
+
 
 
 #define STRAND_SIZE1 256
 #define STRAND_SIZE2 256
 #define STRAND_SIZE3 470
 #define STRAND_SIZE4 470
-
-struct CRGB ledStrand1[STRAND_SIZE1] = { 0 };
-struct CRGB ledStrand2[STRAND_SIZE2] = { 0 };
+static_assert(STRAND_SIZE3 == FASTLED_MATRIX_WIDTH * FASTLED_MATRIX_HEIGHT && STRAND_SIZE4 == STRAND_SIZE3,
+              "the matrices are FASTLED_MATRIX_WIDTH x FASTLED_MATRIX_HEIGHT (fastLedMatrix.h)");
 
 uint8_t uiBrightness = 255;
-// Mixing the variables up to show that the LED strands do not have to occupy contiguous memory.
 
-struct CRGB ledStrand3[STRAND_SIZE3] = { 0 };
-struct CRGB ledStrand4[STRAND_SIZE4] = { 0 };
+// All the LEDs live in one arena, and the segment table says which part of
+// it each controller sends (and how it is laid out).  Bulk operations are a
+// single pass over the arena, and adding a strand means adding a row here.
+static const FastLedSegment ledSegments[] =
+    {
+    //  offset                                       length        controller            layout
+        { 0,                                         STRAND_SIZE1, FASTLED_STRAND_LEFT,  FASTLED_OUTPUT_STRAND },
+        { STRAND_SIZE1,                              STRAND_SIZE2, FASTLED_STRAND_RIGHT, FASTLED_OUTPUT_STRAND },
+        { STRAND_SIZE1 + STRAND_SIZE2,               STRAND_SIZE3, FASTLED_MATRIX_LEFT,  FASTLED_OUTPUT_MATRIX },
+        { STRAND_SIZE1 + STRAND_SIZE2 + STRAND_SIZE3, STRAND_SIZE4, FASTLED_MATRIX_RIGHT, FASTLED_OUTPUT_MATRIX },
+    };
+#define FASTLED_ARENA_LEDS  (STRAND_SIZE1 + STRAND_SIZE2 + STRAND_SIZE3 + STRAND_SIZE4)
 
-void clear_all_leds(void)
+// Pin and frame rate group for each controller in the segment table.
+static const uint8_t controllerPins[] =
+    { LEFT_OUT_LED_STRAND_PIN, RIGHT_OUT_LED_STRAND_PIN, LEFT_OUT_LED_MATRIX_PIN, RIGHT_OUT_LED_MATRIX_PIN };
+static const uint8_t controllerGroups[] =
+    { FASTLED_GROUP_STRANDS, FASTLED_GROUP_STRANDS, FASTLED_GROUP_MATRICES, FASTLED_GROUP_MATRICES };
+
+// The arena has a slot per frame buffer (FASTLED_FRAME_SLOTS, three): one the
+// renderer paints into (the back buffer), and the others queued for the show,
+// on the wire or free.  FastLEDshow() hands
+// the back buffer to the show scheduler at the frame boundary and gets a free
+// slot back, so painting frame N+1 overlaps the RMT wire time of frame N and
+// we never write to LEDs that are being sent.
+// If FASTLED_DOUBLE_BUFFER_COPY_FORWARD is true the new back buffer starts
+// as a copy of the frame just handed over (i.e. it behaves like the single
+// buffer did for anything that only updates part of the display).
+#define FASTLED_DOUBLE_BUFFER_COPY_FORWARD  true
+
+// Each slot is rounded up to 16 LEDs (48 bytes) so every slot starts 16 byte
+// aligned and memset/memcpy can go a word at a time from the first LED.
+#define FASTLED_ARENA_STRIDE    ((FASTLED_ARENA_LEDS + 15) & ~15)
+static CRGB ledArena[FASTLED_FRAME_SLOTS][FASTLED_ARENA_STRIDE] __attribute__((aligned(16)));
+
+// Index of the back (paint) slot.  Only ever changed by fastLedSwapBuffers().
+static volatile uint8_t backBufferIndex = 0;
+
+// Running power totals for each slot (see fastLedPowerBudget.h), and the
+// power limited brightness of the frame in each (worked out as it is submitted).
+static FastLedPowerLedger powerLedgers[FASTLED_FRAME_SLOTS];
+static uint8_t slotScales[FASTLED_FRAME_SLOTS];
+
+// The slot the show task is sending.
+static volatile uint8_t showSlot = 0;
+
+#if FASTLED_SKIP_UNCHANGED
+// A generation for each segment in each slot: a new number whenever anything
+// (might have) written to the segment, and copied with the LEDs, so the same
+// generation means the same LEDs.  Only the renderer changes them, in the back slot.
+static uint32_t segmentGenerations[FASTLED_FRAME_SLOTS][NO_OF_ELEMS(ledSegments)];
+static uint32_t nextSegmentGeneration = 1;
+
+// What each controller last sent: its segments' generations, the brightness,
+// and when (0 if we don't know, so it is sent next time).  Show task only.
+static uint32_t sentGenerations[FASTLED_MAX_CONTROLLERS][NO_OF_ELEMS(ledSegments)];
+static uint8_t sentScales[FASTLED_MAX_CONTROLLERS];
+static uint64_t sentUs[FASTLED_MAX_CONTROLLERS];
+#endif
+
+/// @brief Something has written (or may have) to a segment of the back slot.
+static inline void fastLedSegmentWritten(uint8_t segment)
     {
-    for (int i = 0; i < STRAND_SIZE1;i++)
+#if FASTLED_SKIP_UNCHANGED
+    segmentGenerations[backBufferIndex][segment] = nextSegmentGeneration++;
+#else
+    (void) segment;
+#endif
+    }
+
+static inline void fastLedArenaWritten(void)
+    {
+    for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments); segment++)
         {
-        ledStrand1[i] = CRGB::Black;
+        fastLedSegmentWritten(segment);
         }
-    for (int i = 0; i < STRAND_SIZE2;i++)
+    }
+
+/// @brief Gives the renderer the slot to paint into next.  The show scheduler
+/// calls this when a frame is submitted, with a slot that nobody else is using.
+void fastLedSwapBuffers(uint8_t renderSlot)
+    {
+    backBufferIndex = renderSlot;
+    }
+
+#if FASTLED_OUTPUT_STAGE
+/// @brief Output stage task (core 0): the oldest queued frame through the
+/// tables into each controller's slice of a wire buffer (not the one on the
+/// wire).  The power limit was worked out from the power budget when it was submitted.
+static void fastLedStageFrame(uint8_t slot, uint8_t wireBuffer)
+    {
+    outputStageSetLevels(slotScales[slot], CRGB(FASTLED_CORRECTION));
+    for (int i = 0; i < fastLedOutputCount; i++)
         {
-        ledStrand2[i] = CRGB::Black;
+        outputStageApply(fastLedOutputs[i].buffers[slot], fastLedOutputs[i].wire[wireBuffer], fastLedOutputs[i].size);
         }
-    for (int i = 0; i < STRAND_SIZE3;i++)
+    }
+#endif
+
+/// @brief Start the new back buffer off as a copy of the frame just submitted
+/// (which is queued, so nothing writes to it).  Done outside the scheduler's
+/// critical section as it's a few KB of memcpy.
+static void fastLedCopyForward(uint8_t submittedSlot)
+    {
+#if FASTLED_DOUBLE_BUFFER_COPY_FORWARD
+    uint8_t back = backBufferIndex;
+    memcpy(ledArena[back], ledArena[submittedSlot], FASTLED_ARENA_LEDS * sizeof(CRGB));
+    powerLedgers[back] = powerLedgers[submittedSlot];
+# if FASTLED_SKIP_UNCHANGED
+    memcpy(segmentGenerations[back], segmentGenerations[submittedSlot], sizeof(segmentGenerations[back]));
+# endif
+#else
+    (void) submittedSlot;
+#endif
+    }
+
+
+/// @brief The power limited brightness for the frame in the back half,
+/// from the power budget (only dirty segments get summed again).
+static uint8_t fastLedBackFrameScale(void)
+    {
+    uint8_t back = backBufferIndex;
+    uint32_t frameMw = powerLedgerMw(&powerLedgers[back], ledArena[back]);
+    uint8_t scale = powerLimitScale(frameMw, uiBrightness, (uint32_t) LED_VOLTS * MAX_MILLIAMPS);
+    fastLedPowerStats.frameMw = frameMw;
+    fastLedPowerStats.scale = scale;
+    return(scale);
+    }
+
+
+/// @brief The back (paint) slot of the arena, FASTLED_ARENA_LEDS long.
+/// This moves at every FastLEDshow(), so don't hang on to it across one.
+/// The whole power budget is summed again at the next FastLEDshow(), and
+/// every controller counts as changed, as we can't tell what gets written,
+/// so use fastLedSetPixel() for a few LEDs.
+CRGB* fastLedArenaLeds(void)
+    {
+    powerLedgerMarkAllDirty(&powerLedgers[backBufferIndex]);
+    fastLedArenaWritten();
+    return(ledArena[backBufferIndex]);
+    }
+
+uint16_t fastLedArenaSize(void)
+    {
+    return(FASTLED_ARENA_LEDS);
+    }
+
+uint8_t fastLedSegmentCount(void)
+    {
+    return(NO_OF_ELEMS(ledSegments));
+    }
+
+const FastLedSegment* fastLedGetSegment(uint8_t index)
+    {
+    return((index < NO_OF_ELEMS(ledSegments)) ? &ledSegments[index] : NULL);
+    }
+
+/// @brief A segment's LEDs in the back (paint) slot of the arena.
+/// Its power total is summed again at the next FastLEDshow(), and it counts as changed.
+CRGB* fastLedSegmentLeds(uint8_t index)
+    {
+    powerLedgerMarkDirty(&powerLedgers[backBufferIndex], index);
+    fastLedSegmentWritten(index);
+    return(ledArena[backBufferIndex] + ledSegments[index].offset);
+    }
+
+/// @brief Sets one LED of a segment in the back slot, keeping the power budget
+/// up to date (and the segment unchanged, if the LED already was that colour).
+void fastLedSetPixel(uint8_t segment, uint16_t index, const CRGB& colour)
+    {
+    CRGB* led = &ledArena[backBufferIndex][ledSegments[segment].offset + index];
+    if (*led != colour)
+        {
+        fastLedSegmentWritten(segment);
+        }
+    powerLedgerSetPixel(&powerLedgers[backBufferIndex], segment, *led, colour);
+    *led = colour;
+    }
+
+void fastLedArenaFill(const CRGB& colour)
+    {
+    fill_solid(ledArena[backBufferIndex], FASTLED_ARENA_LEDS, colour);
+    fastLedArenaWritten();
+    for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments); segment++)
         {
-        ledStrand3[i] = CRGB::Black;
+        powerLedgerFill(&powerLedgers[backBufferIndex], segment, colour);
         }
-    for (int i = 0; i < STRAND_SIZE4;i++)
+    }
+
+void fastLedArenaScale(uint8_t scale)
+    {
+    nscale8(ledArena[backBufferIndex], FASTLED_ARENA_LEDS, scale);
+    fastLedArenaWritten();
+    powerLedgerMarkAllDirty(&powerLedgers[backBufferIndex]);    // Rounding is per LED.
+    }
+
+/// @brief Copies a whole frame (FASTLED_ARENA_LEDS long) into the back slot.
+void fastLedArenaCopy(const CRGB* source)
+    {
+    memcpy(ledArena[backBufferIndex], source, FASTLED_ARENA_LEDS * sizeof(CRGB));
+    powerLedgerMarkAllDirty(&powerLedgers[backBufferIndex]);
+    fastLedArenaWritten();
+    }
+
+void clear_all_leds(void)
+    {
+    memset(ledArena[backBufferIndex], 0, FASTLED_ARENA_LEDS * sizeof(CRGB));
+    fastLedArenaWritten();
+    for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments); segment++)
         {
-        ledStrand4[i] = CRGB::Black;
+        powerLedgerFill(&powerLedgers[backBufferIndex], segment, CRGB::Black);
         }
     }
 
+// The stress load's PRNG.  Same seed, same frames (see paint_random_leds_seed()).
+static FastLedRandom paintRandom = { FASTLED_RANDOM_DEFAULT_SEED };
+
 void paint_random_leds(void)
     {
-    for (int i = 0; i < STRAND_SIZE1;i++)
+    fastLedRandomFill(&paintRandom, (uint8_t*) ledArena[backBufferIndex], FASTLED_ARENA_LEDS * sizeof(CRGB));
+    powerLedgerMarkAllDirty(&powerLedgers[backBufferIndex]);
+    fastLedArenaWritten();
+    }
+
+/// @brief Paints only some segments (bit i is segment i), leaving the rest as they were.
+void paint_random_segments(uint8_t segmentMask)
+    {
+    for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments); segment++)
         {
-        ledStrand1[i].r = random8(255);
-        ledStrand1[i].g = random8(255);
-        ledStrand1[i].b = random8(255);
+        if (segmentMask & (1 << segment))
+            {
+            fastLedRandomFill(&paintRandom, (uint8_t*) fastLedSegmentLeds(segment), ledSegments[segment].length * sizeof(CRGB));
+            }
         }
-    for (int i = 0; i < STRAND_SIZE2;i++)
+    }
+
+void paint_random_leds_seed(uint32_t seed)
+    {
+    fastLedRandomSeed(&paintRandom, seed);
+    }
+
+#ifdef DEBUG_ON
+/// @brief What paint_random_leds() used to do, kept for the benchmark.
+static void paint_random_leds_random8(void)
+    {
+    CRGB* leds = ledArena[backBufferIndex];
+    for (int i = 0; i < FASTLED_ARENA_LEDS; i++)
         {
-        ledStrand2[i].r = random8(255);
-        ledStrand2[i].g = random8(255);
-        ledStrand2[i].b = random8(255);
+        leds[i].r = random8(255);
+        leds[i].g = random8(255);
+        leds[i].b = random8(255);
         }
-    for (int i = 0; i < STRAND_SIZE3;i++)
+    }
+#endif
+
+/// @brief Times paint_random_leds() against the old random8() per channel
+/// version over a number of frames and prints CPU cycles and us per frame.
+/// Only paints the back buffer, so it's safe to run from the loop.
+void paint_random_leds_benchmark(uint16_t frames)
+    {
+#ifdef DEBUG_ON
+    uint32_t cycles[2];
+    uint32_t us[2];
+    for (int pass = 0; pass < 2; pass++)
         {
-        ledStrand3[i].r = random8(255);
-        ledStrand3[i].g = random8(255);
-        ledStrand3[i].b = random8(255);
+        uint64_t startUs = esp_timer_get_time();
+        uint32_t startCycles = ESP.getCycleCount();
+        for (uint16_t frame = 0; frame < frames; frame++)
+            {
+            if (pass == 0)
+                {
+                paint_random_leds_random8();
+                }
+            else
+                {
+                paint_random_leds();
+                }
+            }
+        cycles[pass] = (ESP.getCycleCount() - startCycles) / frames;
+        us[pass] = (uint32_t) (esp_timer_get_time() - startUs) / frames;
         }
-    for (int i = 0; i < STRAND_SIZE4;i++)
+    DEBUG_START_SEMAPHORE_BLOCK
         {
-        ledStrand4[i].r = random8(255);
-        ledStrand4[i].g = random8(255);
-        ledStrand4[i].b = random8(255);
+        DEBUG_PRINT("paint_random_leds over ");
+        DEBUG_PRINT(FASTLED_ARENA_LEDS);
+        DEBUG_PRINT(" LEDs, ");
+        DEBUG_PRINT(frames);
+        DEBUG_PRINTLN(" frames:");
+        DEBUG_PRINT("  random8 per channel: ");
+        DEBUG_PRINT(cycles[0]);
+        DEBUG_PRINT(" cycles (");
+        DEBUG_PRINT(us[0]);
+        DEBUG_PRINTLN(" us) per frame.");
+        DEBUG_PRINT("  xorshift32 per word: ");
+        DEBUG_PRINT(cycles[1]);
+        DEBUG_PRINT(" cycles (");
+        DEBUG_PRINT(us[1]);
+        DEBUG_PRINT(" us) per frame, ");
+        DEBUG_PRINT((float) cycles[0] / (cycles[1] ? cycles[1] : 1), 1);
+        DEBUG_PRINTLN("x faster.");
+        DEBUG_SEMAPHORE_RELEASE;
         }
+#else
+    (void) frames;
+#endif
     }
 
 
@@ -109,75 +441,329 @@ void fastLedSetup(void)
     // Especially since our frame rate is limited.
     // We set this in the controller when we initialise the stands or matrix.
     FastLED.setBrightness(127);  // Half brightness to start.
-    FastLED.setMaxPowerInVoltsAndMilliamps(LED_VOLTS, MAX_MILLIAMPS);
-    // setMaxPowerInVoltsAndMilliamps is probably NOT going 
-    // to work well here since we won't have (temporal) dither.
-
-    // Add four clockless based CLEDController instances 2 for the stands 2 for the matrixes. 
-    controllers[FASTLED_STRAND_LEFT] = &FastLED.addLeds<LED_CHIPSET_STRAND, LEFT_OUT_LED_STRAND_PIN, COLOR_ORDER_STRAND>(ledStrand1, STRAND_SIZE1);
-    controllers[FASTLED_STRAND_RIGHT] = &FastLED.addLeds<LED_CHIPSET_STRAND, RIGHT_OUT_LED_STRAND_PIN, COLOR_ORDER_STRAND>(ledStrand2, STRAND_SIZE2);
-    controllers[FASTLED_MATRIX_LEFT] = &FastLED.addLeds<LED_CHIPSET_MATRIX, LEFT_OUT_LED_MATRIX_PIN, COLOR_ORDER_MATRIX>(ledStrand3, STRAND_SIZE3);
-    controllers[FASTLED_MATRIX_RIGHT] = &FastLED.addLeds<LED_CHIPSET_MATRIX, RIGHT_OUT_LED_MATRIX_PIN, COLOR_ORDER_MATRIX>(ledStrand4, STRAND_SIZE4);
-
-    controllers[FASTLED_STRAND_LEFT]->setCorrection(TypicalLEDStrip);
-    controllers[FASTLED_STRAND_RIGHT]->setCorrection(TypicalLEDStrip);
-    controllers[FASTLED_MATRIX_LEFT]->setCorrection(TypicalLEDStrip);
-    controllers[FASTLED_MATRIX_RIGHT]->setCorrection(TypicalLEDStrip);
-
-    controllers[FASTLED_STRAND_LEFT]->setDither(FastLedCommonDitherMode);
-    controllers[FASTLED_STRAND_RIGHT]->setDither(FastLedCommonDitherMode);
-    controllers[FASTLED_MATRIX_LEFT]->setDither(FastLedCommonDitherMode);
-    controllers[FASTLED_MATRIX_RIGHT]->setDither(FastLedCommonDitherMode);
+    // The power limit (LED_VOLTS, MAX_MILLIAMPS) is applied from the power
+    // budget (fastLedPowerBudget.h) rather than FastLED.setMaxPowerInVoltsAndMilliamps(),
+    // which would walk every LED at every show.  It is probably still NOT going 
+    // to work that well here since we won't have (temporal) dither.
+    uint16_t segmentOffsets[NO_OF_ELEMS(ledSegments)];
+    uint16_t segmentLengths[NO_OF_ELEMS(ledSegments)];
+    for (uint8_t i = 0; i < NO_OF_ELEMS(ledSegments); i++)
+        {
+        segmentOffsets[i] = ledSegments[i].offset;
+        segmentLengths[i] = ledSegments[i].length;
+        }
+    for (uint8_t slot = 0; slot < FASTLED_FRAME_SLOTS; slot++)
+        {
+        powerLedgerInit(&powerLedgers[slot], segmentOffsets, segmentLengths, NO_OF_ELEMS(ledSegments));
+        }
+
+    // Add a clockless based CLEDController per segment, 2 for the stands 2 for the matrixes.
+    // Up to four more can go on the spare RMT channels, see FASTLED_OUTPUT_PINS.
+    for (uint8_t i = 0; i < NO_OF_ELEMS(ledSegments); i++)
+        {
+        const FastLedSegment* segment = &ledSegments[i];
+        CRGB* buffers[FASTLED_FRAME_SLOTS];
+        for (uint8_t slot = 0; slot < FASTLED_FRAME_SLOTS; slot++)
+            {
+            buffers[slot] = ledArena[slot] + segment->offset;
+            }
+        int8_t index = fastLedAddOutput(controllerPins[segment->controller], segment->layout, buffers, 
+                                        segment->length, controllerGroups[segment->controller]);
+        DEBUG_ASSERT(index == segment->controller);
+        (void) index;
+        }
+#if FASTLED_OUTPUT_STAGE
+    showSchedulerSetStage(outputStageInit(fastLedStageFrame));
+#endif
     setupFastLedShowHandlerTask();
+    }
+
+
+/// @brief Makes the FastLED controller for a pin (and chipset) from FASTLED_OUTPUT_PINS.
+/// @return The controller, or NULL if it isn't one of those pins.
+static CLEDController* fastLedAddController(uint8_t pin, FastLedOutputType type, CRGB* leds, uint16_t size)
+    {
+    switch (pin)
+        {
+#define FASTLED_ADD_CONTROLLER_CASE(outputPin) \
+        case outputPin: \
+            if (type == FASTLED_OUTPUT_MATRIX) \
+                { \
+                return(&FastLED.addLeds<LED_CHIPSET_MATRIX, outputPin, COLOR_ORDER_MATRIX>(leds, size)); \
+                } \
+            return(&FastLED.addLeds<LED_CHIPSET_STRAND, outputPin, COLOR_ORDER_STRAND>(leds, size));
+        FASTLED_OUTPUT_PINS(FASTLED_ADD_CONTROLLER_CASE)
+#undef FASTLED_ADD_CONTROLLER_CASE
+        default:
+            return(NULL);
+        }
+    }
+
+
+/// @brief Which arena segments a run of LEDs overlaps.
+/// @param leds The run in the first slot (as a controller's buffers[0]).
+/// @return Bit mask of segments, 0 if the LEDs aren't in the arena.
+static uint8_t fastLedArenaSegments(const CRGB* leds, uint16_t size)
+    {
+    uint8_t segmentMask = 0;
+    if (leds >= ledArena[0] && leds + size <= ledArena[0] + FASTLED_ARENA_LEDS)
+        {
+        uint16_t offset = (uint16_t) (leds - ledArena[0]);
+        for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments); segment++)
+            {
+            if (offset < ledSegments[segment].offset + ledSegments[segment].length
+                && ledSegments[segment].offset < offset + size)
+                {
+                segmentMask |= (1 << segment);
+                }
+            }
+        }
+    return(segmentMask);
+    }
+
+
+/// @brief Adds a controller to the registry.  Only call this from fastLedSetup()
+/// (before the show task starts), and at most once per pin.
+/// @param pin One of FASTLED_OUTPUT_PINS.
+/// @param type Which chipset and colour order.
+/// @param buffers FASTLED_FRAME_SLOTS frame buffers of size LEDs each.  The
+/// controller is pointed at the one being sent at each show.
+/// @param size Number of LEDs.
+/// @param group Frame rate group it latches with (< NUM_FASTLED_GROUPS).
+/// @return The new controller's index, or -1 if the registry is full or the pin is no good.
+int8_t fastLedAddOutput(uint8_t pin, FastLedOutputType type, CRGB* const* buffers, uint16_t size, uint8_t group)
+    {
+    DEBUG_ASSERT(FastLedShowHandlerTaskSignal == NULL);
+    DEBUG_ASSERT(group < NUM_FASTLED_GROUPS);
+    if (fastLedOutputCount >= FASTLED_MAX_CONTROLLERS)
+        {
+        return(-1);
+        }
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        if (fastLedOutputs[i].pin == pin)
+            {
+            return(-1);     // FastLED would hand back the same controller.
+            }
+        }
+#if FASTLED_OUTPUT_STAGE
+    // The controller sends its slice of a wire buffer, already corrected and scaled.
+    CRGB* wire[FASTLED_OUTPUT_STAGE_BUFFERS];
+    if (!outputStageAllocate(size, wire))
+        {
+        return(-1);
+        }
+    CLEDController* controller = fastLedAddController(pin, type, wire[0], size);
+    if (controller == NULL)
+        {
+        return(-1);
+        }
+    controller->setCorrection(UncorrectedColor);
+#else
+    CRGB* wire[FASTLED_OUTPUT_STAGE_BUFFERS] = {};
+    CLEDController* controller = fastLedAddController(pin, type, buffers[FASTLED_FRAME_SLOTS - 1], size);
+    if (controller == NULL)
+        {
+        return(-1);
+        }
+    controller->setCorrection(FASTLED_CORRECTION);
+#endif
+    controller->setDither(FastLedCommonDitherMode);
+
+    uint8_t index = fastLedOutputCount;
+    fastLedOutputs[index].controller = controller;
+    memcpy(fastLedOutputs[index].buffers, buffers, sizeof(fastLedOutputs[index].buffers));
+    memcpy(fastLedOutputs[index].wire, wire, sizeof(fastLedOutputs[index].wire));
+    fastLedOutputs[index].type = type;
+    fastLedOutputs[index].size = size;
+    fastLedOutputs[index].pin = pin;
+    fastLedOutputs[index].group = group;
+    fastLedOutputs[index].segmentMask = fastLedArenaSegments(buffers[0], size);
+    controllers[index] = controller;
+    fastLedOutputCount++;
+    return(index);
+    }
+
+
+/// @brief Spreads one logical layout (e.g. a long run of matrix rows) across
+/// several pins with the output planner, so the longest pin, and so the
+/// wire time of a show, is as short as it can be.  Each controller points
+/// at its slice of the logical buffers, so there is no copying.
+/// @param segmentLengths LEDs in each segment that must stay on one pin, in layout order.
+/// @param segmentCount Number of segments.
+/// @param pins Pins to use (from FASTLED_OUTPUT_PINS).
+/// @param pinCount How many of them.
+/// @param type Which chipset and colour order.
+/// @param buffers The logical layout's FASTLED_FRAME_SLOTS frame buffers,
+/// each as long as all the segments together.
+/// @param group Frame rate group they all latch with.
+/// @return Number of controllers added (fewer than pinCount if the plan didn't need them all), 0 on failure.
+uint8_t fastLedAddPlannedOutputs(const uint16_t* segmentLengths, uint16_t segmentCount, 
+                                 const uint8_t* pins, uint8_t pinCount, FastLedOutputType type, 
+                                 CRGB* const* buffers, uint8_t group)
+    {
+    FastLedPinPlan plan[FASTLED_MAX_CONTROLLERS];
+    if (pinCount > FASTLED_MAX_CONTROLLERS - fastLedOutputCount)
+        {
+        pinCount = FASTLED_MAX_CONTROLLERS - fastLedOutputCount;
+        }
+    uint8_t pinsUsed = fastLedPlanOutputs(segmentLengths, segmentCount, pinCount, plan);
+    for (uint8_t i = 0; i < pinsUsed; i++)
+        {
+        CRGB* slices[FASTLED_FRAME_SLOTS];
+        for (uint8_t slot = 0; slot < FASTLED_FRAME_SLOTS; slot++)
+            {
+            slices[slot] = buffers[slot] + plan[i].ledOffset;
+            }
+        if (fastLedAddOutput(pins[i], type, slices, plan[i].ledCount, group) < 0)
+            {
+            return(i);
+            }
+        }
+    return(pinsUsed);
+    }
+
+
+uint8_t fastLedControllerCount(void)
+    {
+    return(fastLedOutputCount);
+    }
 
-    fastLedCalcFrameRate(STRAND_SIZE4); // pick the biggest
 
+/// @brief Controller mask with every registered controller in it.
+uint8_t fastLedAllControllers(void)
+    {
+    return((uint8_t) ((1U << fastLedOutputCount) - 1));
+    }
+
+
+const FastLedOutput* fastLedGetOutput(uint8_t index)
+    {
+    return((index < fastLedOutputCount) ? &fastLedOutputs[index] : NULL);
     }
 
 
 /// @brief Returns a maximum framerate given the number of LEDS and
-/// also stores a lowestFrameRateInUse to determine the maximum frequency
-/// that FastLED.Show should be called.
+/// also stores a lowestFrameRateInUse (and the matching longest wire time)
+/// to determine the maximum frequency that FastLED.Show should be called.
 /// @param numberOfLeds Number of LEDs on a single pin or controller.
 /// @return max frame Rate for the number of LEDs on that pin.
 float fastLedCalcFrameRate(uint16_t numberOfLeds)
     {
-  // assume WS2812 or WS2812B at 800 kilobits/sec 
-    float frameRate = (800000.0 / 24.0 / (float)numberOfLeds) - (50.0 / 1000000.0);
-    if (frameRate < lowestFrameRateInUse)
+    // The reset time adds to the period (it used to be taken off the rate).
+    uint32_t wireTimeUs = fastLedWireTimeUs(numberOfLeds);
+    float frameRate = 1000000.0 / (float) wireTimeUs;
+    if (wireTimeUs > longestWireTimeUs)
         {
+        longestWireTimeUs = wireTimeUs;
         lowestFrameRateInUse = frameRate;
         }
     return(frameRate);
     }
 
+/// @brief The frame period (in microseconds) the frame governor runs at.
+uint32_t fastLedFramePeriodUs(void)
+    {
+    return(longestWireTimeUs);
+    }
+
+#if FASTLED_RMT_RESET
+/// @brief Gets the LEDs going again without rebooting.  Deletes the show
+/// task (out of FastLED.show() if GiveGTX_sem() gets it out, otherwise where
+/// it is stuck, waiting on gTX_sem), resets the RMT driver and peripheral
+/// with ResetRMT(), adds every controller to the registry again (FastLED
+/// hands back the same ones, which get their buffers, correction and dither
+/// again) and starts a new show task.  The arena isn't touched, so the LEDs
+/// carry on from the frame they had (any frames still queued are dropped).
+/// Only call this from the renderer, the loop or the render task (it waits
+/// up to FASTLED_WARM_RESTART_WAIT_MS).
+void fastLedWarmRestart(void)
+    {
+    uint64_t startUs = esp_timer_get_time();
+    jamWatchdogStop();
+    showSchedulerHold();    // Or it would go straight into the next queued frame.
+#if DEBUG_USE_PORT_MAX_DELAY_FOR_GTX_SEM
+    GiveGTX_sem();
+#endif
+    for (int ms = 0; ms < FASTLED_WARM_RESTART_WAIT_MS && showSchedulerState() == SHOW_STATE_TRANSMITTING; ms++)
+        {
+        vTaskDelay(pdMS_TO_TICKS(1));
+        }
+
+    // Nothing is released to the old task from here on, and we don't block
+    // again before it is gone, so it can't start another show.  If it is
+    // still in FastLED.show() it is blocked on gTX_sem, which ResetRMT()
+    // replaces, so nothing is left waiting on the old one.
+    showSchedulerInit(NULL, fastLedSwapBuffers);
+    vTaskDelete(FastLedShowHandlerTaskSignal);
+    FastLedShowHandlerTaskSignal = NULL;
+    bFastLedReady = false;
+    ResetRMT(fastLedOutputs[0].pin);
+
+    FastLedOutput outputs[FASTLED_MAX_CONTROLLERS];
+    uint8_t outputCount = fastLedOutputCount;
+    memcpy(outputs, fastLedOutputs, sizeof(outputs));
+    fastLedOutputCount = 0;
+#if FASTLED_OUTPUT_STAGE
+    outputStageFreeAll();   // Added in the same order, so each gets the same slice.
+#endif
+    for (uint8_t i = 0; i < outputCount; i++)
+        {
+        int8_t index = fastLedAddOutput(outputs[i].pin, outputs[i].type, outputs[i].buffers, 
+                                        outputs[i].size, outputs[i].group);
+        DEBUG_ASSERT(index == i);
+        (void) index;
+        }
+#if FASTLED_SKIP_UNCHANGED
+    memset(sentUs, 0, sizeof(sentUs));  // Who knows what they have now.
+#endif
+    setupFastLedShowHandlerTask();
+    frameGovernorInit(groupPeriodsUs, NUM_FASTLED_GROUPS);
+
+#if DEBUG_FASTLED_JAM && !DEBUG_BINARY_TELEMETRY
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        DEBUG_PRINT("FastLED warm restart took ");
+        DEBUG_PRINT((uint32_t) (esp_timer_get_time() - startUs));
+        DEBUG_PRINTLN(" us.");
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+#else
+    (void) startUs;
+#endif
+    }
+#endif
+
+
 /// @brief Used after all FastLED controller have been initialised
 /// so we can calculate framerate frequency (and anything else we might need later).
 /// @param  
 void fastLedPostInit(void)
     {
-    frameRateInMilliseconds = (uint16_t)floor(1000.0 / lowestFrameRateInUse);
-    uint16_t uiLowestFrameRateInUse = floor(lowestFrameRateInUse);
-    FastLED.setMaxRefreshRate(uiLowestFrameRateInUse, true);
-    // This will force a delay in FastLED.show.
-    // Needs to be set after adding all the LEDs to the controllers.
-    //  see https://forum.makerforums.info/t/today-i-learned-fastled-show-will-automatically-wait-delay-if-you-have-set-a-refresh-rate/64631
-
-    DEBUG_START_SEMAPHORE_BLOCK
+    for (int i = 0; i < fastLedOutputCount; i++)
         {
-        DEBUG_PRINT("FastLED Lowest frame rate in use is ");
-        DEBUG_PRINT(uiLowestFrameRateInUse);
-        DEBUG_PRINT(" (");
-        DEBUG_PRINT(frameRateInMilliseconds);
-        DEBUG_PRINT(" ms per frame)");
-        DEBUG_PRINTLN(".");
-        DEBUG_DELAY(xTickATinyBit);
-        DEBUG_SEMAPHORE_RELEASE;
+        fastLedCalcFrameRate(controllers[i]->size());
+        uint32_t wireTimeUs = fastLedWireTimeUs(controllers[i]->size());
+        uint8_t group = fastLedOutputs[i].group;
+        if (wireTimeUs > groupPeriodsUs[group])
+            {
+            groupPeriodsUs[group] = wireTimeUs;
+            }
         }
+    // We no longer use FastLED.setMaxRefreshRate(uiLowestFrameRateInUse, true) 
+    // as well, which forced a second (millisecond) delay inside FastLED.show.
+    //  see https://forum.makerforums.info/t/today-i-learned-fastled-show-will-automatically-wait-delay-if-you-have-set-a-refresh-rate/64631
+    frameGovernorInit(groupPeriodsUs, NUM_FASTLED_GROUPS);
+    jamWatchdogInit(jamLadder, NO_OF_ELEMS(jamLadder), longestWireTimeUs);
+    bootProfileMark(BOOT_STAGE_POST_INIT);
+#if !FAST_BOOT
+    fastLedFrameRateReport();
+#endif
 
 // http://fastled.io/docs/class_c_fast_l_e_d.html#a1f39e8404db214bbd6a776f52a77d8b1
 // cf https://cdn-shop.adafruit.com/datasheets/WS2812B.pdf
 //     4 x channels  at  800 KHz / 24 bits / LED  - 50us reset time
+//     (period = LEDs x 30us + 50us, so 470 LEDs is 14150us or 70.67 Hz.)
 
     // Channel                     Pixels (LEDS)           Frame Rates
     // Matrix Left                 256                     130.2082833
@@ -191,120 +777,292 @@ void fastLedPostInit(void)
     }
 
 
+/// @brief Prints the frame rates fastLedPostInit() worked out.  From
+/// fastLedPostInit() itself, or after the first frame with FAST_BOOT.
+void fastLedFrameRateReport(void)
+    {
+#if DEBUG_BINARY_TELEMETRY
+    uint32_t values[] = { (uint32_t) (lowestFrameRateInUse * 100), longestWireTimeUs };
+    telemetryEmit(TELEMETRY_FRAME_PERIOD, values);
+#else
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        DEBUG_PRINT("FastLED Lowest frame rate in use is ");
+        DEBUG_PRINT(lowestFrameRateInUse, 2);
+        DEBUG_PRINT(" (");
+        DEBUG_PRINT(longestWireTimeUs);
+        DEBUG_PRINT(" us per frame)");
+        DEBUG_PRINTLN(".");
+        for (int group = 0; group < NUM_FASTLED_GROUPS; group++)
+            {
+            DEBUG_PRINT("FastLED group ");
+            DEBUG_PRINT(group);
+            DEBUG_PRINT(" wire time ");
+            DEBUG_PRINT(groupPeriodsUs[group]);
+            DEBUG_PRINT(" us");
+            DEBUG_PRINTLN(".");
+            }
+        DEBUG_DELAY(xTickATinyBit);
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+#endif
+    }
+
+
 /// @brief Used as a replacement for FastLED.Show() to minimise hangs and crashes
 // and to not call FastLED.Show() more often than it can do an update.
 void FastLEDshow(void)
     {
-    static uint32_t restartCount = 0;
-    static uint64_t restartNextUs = esp_timer_get_time() + 1000000;
     // This is an attempt to reduce contention issues with FastLED and
     // the rest of the code for the random rare hangs...  
 
-    if (NotShowing)
-        {
    // An attempt to resolve Esp32/FastLED timing issues
    // basically no point in calling this more than the frame rate
    // that the slowest FastLED channel can deliver.
    // I'm not entirely sure this actually has a noticeable effect, but 
    // my very subjective opinion is it slightly reduced some stuttering, that
    // I could only really see in scrolling text.
+   // So the frame governor holds each frame until its deadline, and anything
+   // we paint in the meantime replaces it.
 
+    // Never blocks: the frame is either queued (maybe in place of one
+    // that hasn't gone yet) or dropped because there's no slot to spare.
+    // Its power limit goes with it.
+    uint8_t submittedSlot = backBufferIndex;
+    slotScales[submittedSlot] = fastLedBackFrameScale();
+    FastLedSubmitResult result = showSchedulerSubmitFrame();
+    if (result == SHOW_SUBMIT_DROPPED)
+        {
+        fastLedStatsRecordDropped();
+        }
+    else
+        {
+        if (result == SHOW_SUBMIT_COALESCED)
+            {
+            fastLedStatsRecordDropped(); // The frame it replaced never made it.
+            }
+        else
+            {
 #if FASTLED_STUTTER_REDUCTION
-        EVERY_N_MILLISECONDS(frameRateInMilliseconds)
+            frameGovernorRequestRelease();
+#else
+            showSchedulerRelease();
 #endif
-            {
-            xTaskNotifyGive(FastLedShowHandlerTaskSignal);
             }
-        restartCount = 0;
+        fastLedCopyForward(submittedSlot);
         }
-    else
+
+    // The jam watchdog has already done whatever it can from its timer,
+    // so this is just reporting (and the restart, if it gets that far).
+    FastLedJamEscalation escalation;
+    while (jamWatchdogTakeEscalation(&escalation))
         {
-        if (esp_timer_get_time() > restartNextUs)
+# if DEBUG_FASTLED_JAM
+#  if DEBUG_BINARY_TELEMETRY
+        uint32_t values[] = { escalation.step, (uint32_t) escalation.action, escalation.overdueUs, escalation.marginUs };
+        telemetryEmit(TELEMETRY_JAM_ESCALATION, values);
+#  else
+        DEBUG_START_SEMAPHORE_BLOCK
             {
-            // We get here every second if we are blocked because FastLED.Show has jammed...
-            // First time is likely to be at 0 seconds as restartNextUs was (hopefully)
-            // some time ago.
-            restartNextUs = esp_timer_get_time() + 1000000;
-            if (restartCount == 1)   /// If we have jammed for 1 second(s).
-                {
+            DEBUG_PRINT("FastLED.show() has jammed ");
+            DEBUG_PRINT(escalation.atUs / 1000000.0, 3);
+            DEBUG_PRINT(" seconds after boot, step ");
+            DEBUG_PRINT(escalation.step);
+            DEBUG_PRINT(" (");
+            DEBUG_PRINT(jamActionNames[escalation.action]);
+            DEBUG_PRINT(") ");
+            DEBUG_PRINT(escalation.overdueUs);
+            DEBUG_PRINT(" us past its deadline (margin ");
+            DEBUG_PRINT(escalation.marginUs);
+            DEBUG_PRINTLN(" us).");
+            DEBUG_SEMAPHORE_RELEASE;
+            }
+#  endif
+# endif
+#if FASTLED_RMT_RESET
+        if (escalation.action == FASTLED_JAM_WARM_RESTART)
+            {
+            fastLedWarmRestart();
+            rtcTelemetryRecordWarmRestart();
+            }
+#endif
+        if (escalation.action == FASTLED_JAM_RESTART)
+            {
+            // GiveGTX_sem() hasn't worked so something else is broken, 
+            // so let's just re-boot.
 # if DEBUG_FASTLED_JAM
-                DEBUG_START_SEMAPHORE_BLOCK
-                    {
-                    DEBUG_PRINTLN("");
-                    debugDisplaySeconds("FastLED.Show() has jammed after ", 
-                                        uint32_t (esp_timer_get_time() / 1000000.0));
-                    DEBUG_PRINT(" since boot!");
-
-                    DEBUG_PRINTLN("");
-                    DEBUG_DELAY(xTickATinyBit);
-    # if DEBUG_USE_PORT_MAX_DELAY_FOR_GTX_SEM
-                    DEBUG_PRINTLN("Forcing semaphore reset try.");
-    # else                
-                    DEBUG_PRINTLN("Waiting another second while gTX_sem times out.");
-    # endif                
-                    DEBUG_DELAY(xTickATinyBit);
-                    DEBUG_PRINTLN("");
-                    DEBUG_SEMAPHORE_RELEASE;
-                    }
-                vTaskDelay(pdMS_TO_TICKS(500));
-# endif            
-# if DEBUG_USE_PORT_MAX_DELAY_FOR_GTX_SEM
-                // This triggers FastLED RMT driver to reset its blocking semaphore.
-                GiveGTX_sem();
-# endif                
-                vTaskDelay(pdMS_TO_TICKS(1));
-                                // Now we trigger our FastLED task to clear our lock.
-                xTaskNotifyGive(FastLedShowHandlerTaskSignal);
-                vTaskDelay(pdMS_TO_TICKS(50));
+#  if DEBUG_BINARY_TELEMETRY
+            uint32_t values[] = { uint32_t (esp_timer_get_time() / 1000000) };
+            telemetryEmit(TELEMETRY_JAM_RESTART, values);
+#  else
+            DEBUG_START_SEMAPHORE_BLOCK
+                {
+                DEBUG_PRINTLN("");
+                debugDisplaySeconds("FastLED.Show() is still jammed after ", 
+                                    uint32_t (esp_timer_get_time() / 1000000.0));   
+                DEBUG_PRINTLN(" since boot!");                 
+                DEBUG_PRINTLN("Restarting now!");                 
+                DEBUG_PRINTLN("");
+                DEBUG_DELAY(xTickATinyBit);
+                DEBUG_PRINTLN("");
+                DEBUG_PRINTLN("");
+                DEBUG_PRINTLN("");
+                DEBUG_SEMAPHORE_RELEASE;
                 }
+#  endif
+            vTaskDelay(pdMS_TO_TICKS(500));
+# endif            
+            rtcTelemetryRecordJamRestart();
+            ESP.restart();
+            }
+        }
+    }
+
 
-            // If this doesn't work something else is broken so 
-            // let's just re-boot after 15 secs.
-            if (restartCount > 15)
+/// @brief Sends just the controllers in controllerMask (bit i is controllers[i])
+/// in one go, parking the others if the driver needs everybody to take part.
+/// This stands in for FastLED.show(uiBrightness), so it applies the power limit
+/// itself (or the output stage already has, and FastLED just sends the bytes).
+/// @param controllerMask Bit mask of controllers to send, fastLedAllControllers() for all.
+void fastLedShowControllers(uint8_t controllerMask)
+    {
+#if FASTLED_OUTPUT_STAGE
+    uint8_t scale = 255;
+#else
+    uint8_t scale = slotScales[showSlot];   // From the power budget, when it was submitted.
+#endif
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        if (controllerMask & (1 << i))
+            {
+            controllers[i]->showLeds(scale);
+            }
+#if FASTLED_PARK_IDLE_CONTROLLERS
+        else
+            {
+            CRGB* leds = controllers[i]->leds();
+            int size = controllers[i]->size();
+            controllers[i]->setLeds(leds, 0);
+            controllers[i]->showLeds(scale);
+            controllers[i]->setLeds(leds, size);
+            }
+#endif
+        }
+    }
+
+
+#if FASTLED_SKIP_UNCHANGED
+/// @brief Show task: the due controllers that would send just what they
+/// sent last time (the same generation of each of their segments, at the same
+/// brightness) and aren't due a full refresh.  Controllers that aren't
+/// from the arena, or that we don't know about, are always sent.
+/// @param controllerMask The due controllers.
+/// @param slot The frame about to be sent.
+/// @param nowUs When.
+/// @param refreshMask Set to the ones sent only because they're due a refresh.
+/// @return Bit mask of controllers to leave out.
+static uint8_t fastLedUnchangedControllers(uint8_t controllerMask, uint8_t slot, uint64_t nowUs, uint8_t* refreshMask)
+    {
+    uint8_t unchangedMask = 0;
+    *refreshMask = 0;
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        uint8_t segmentMask = fastLedOutputs[i].segmentMask;
+        if (!(controllerMask & (1 << i)) || segmentMask == 0 || sentUs[i] == 0 || sentScales[i] != slotScales[slot])
+            {
+            continue;
+            }
+        bool bSame = true;
+        for (uint8_t segment = 0; segment < NO_OF_ELEMS(ledSegments) && bSame; segment++)
+            {
+            if ((segmentMask & (1 << segment)) && segmentGenerations[slot][segment] != sentGenerations[i][segment])
                 {
-# if DEBUG_FASTLED_JAM
-                DEBUG_START_SEMAPHORE_BLOCK
-                    {
-                    DEBUG_PRINTLN("");
-                    debugDisplaySeconds("FastLED.Show() is still jammed after ", 
-                                        uint32_t (esp_timer_get_time() / 1000000.0));   
-                    DEBUG_PRINTLN(" since boot!");                 
-                    DEBUG_PRINTLN("Restarting now!");                 
-                    DEBUG_PRINTLN("");
-                    DEBUG_DELAY(xTickATinyBit);
-                    DEBUG_PRINTLN("");
-                    DEBUG_PRINTLN("");
-                    DEBUG_PRINTLN("");
-                    DEBUG_SEMAPHORE_RELEASE;
-                    }
-                vTaskDelay(pdMS_TO_TICKS(500));
-# endif            
-                ESP.restart();
+                bSame = false;
                 }
-            restartCount++;
+            }
+        if (!bSame)
+            {
+            continue;
+            }
+        if (FASTLED_FULL_REFRESH_MS > 0 && nowUs - sentUs[i] >= FASTLED_FULL_REFRESH_MS * 1000ULL)
+            {
+            *refreshMask |= (1 << i);
+            }
+        else
+            {
+            unchangedMask |= (1 << i);
             }
         }
+    return(unchangedMask);
     }
 
 
+/// @brief Show task: the controllers in controllerMask have sent slot.
+/// @param bJammed The show jammed, so we can't tell what any of the LEDs
+/// have, and every controller is sent next time.
+static void fastLedRecordSent(uint8_t controllerMask, uint8_t slot, uint64_t startUs, bool bJammed)
+    {
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        if (bJammed)
+            {
+            sentUs[i] = 0;
+            }
+        else if (controllerMask & (1 << i))
+            {
+            memcpy(sentGenerations[i], segmentGenerations[slot], sizeof(sentGenerations[i]));
+            sentScales[i] = slotScales[slot];
+            sentUs[i] = startUs;
+            }
+        }
+    }
+#endif
+
+
+#if FASTLED_STUTTER_REDUCTION
+/// @brief Turns a bit mask of groups into a bit mask of their controllers.
+static uint8_t fastLedGroupControllers(uint8_t groupMask)
+    {
+    uint8_t controllerMask = 0;
+    for (int i = 0; i < fastLedOutputCount; i++)
+        {
+        if (groupMask & (1 << fastLedOutputs[i].group))
+            {
+            controllerMask |= (1 << i);
+            }
+        }
+    return(controllerMask);
+    }
+#endif
+
+
+/// @brief Creates the show task, with its stack and TCB in .bss rather than the heap.
+/// A warm restart deletes the task from the loop (not from itself), which
+/// frees them at once, so they can be used again straight away.
 void setupFastLedShowHandlerTask(void)
     {
-    int stackSizeInWords = configMINIMAL_STACK_SIZE + 10000;
-    xTaskCreatePinnedToCore(
+    static StackType_t showTaskStack[WRITE_FASTLED_SHOW_STACK_BYTES];
+    static StaticTask_t showTaskBuffer;
+    FastLedShowHandlerTaskSignal = xTaskCreateStaticPinnedToCore(
         fastLedShowHandlerTask,
         "fastLedShowHandlerTask",
-        stackSizeInWords,
+        WRITE_FASTLED_SHOW_STACK_BYTES,
         NULL,
         WRITE_FASTLED_SHOW_PRIORITY,
-        &FastLedShowHandlerTaskSignal,
+        showTaskStack,
+        &showTaskBuffer,
         WRITE_FASTLED_SHOW_CORE);
+    taskStatsRegister(FastLedShowHandlerTaskSignal, "fastLedShowHandlerTask", WRITE_FASTLED_SHOW_STACK_BYTES, true);
+    showSchedulerInit(FastLedShowHandlerTaskSignal, fastLedSwapBuffers);
     }
 
 
-/// @brief FastLED.show task.  Trigger with xTaskNotifyGive(FastLedShowHandlerTaskSignal)
+/// @brief FastLED.show task.  Triggered by showSchedulerSubmitFrame().
 /// @param  param unused.
 void IRAM_ATTR fastLedShowHandlerTask(void* param)
     {
+    (void) param;
+#if !FAST_BOOT
     DEBUG_START_SEMAPHORE_BLOCK
         {
         DEBUG_PRINT("fastLedShowHandlerTask running on core ");
@@ -313,24 +1071,137 @@ void IRAM_ATTR fastLedShowHandlerTask(void* param)
         DEBUG_SEMAPHORE_RELEASE;
         }
     vTaskDelay(pdMS_TO_TICKS(100));
+#endif
+#if !FASTLED_STUTTER_REDUCTION
+    uint64_t lastShowStartUs = 0;
+    uint32_t lastShowWireUs = 0;
+#endif
     bFastLedInitialised = true;
     bFastLedReady = true;
+    bootProfileMark(BOOT_STAGE_SHOW_TASK);
     while (true)
         {
-        // Sleep until the ISR gives us something to do, or for our 
+        // Sleep until the scheduler gives us something to do, or for our 
         // timeout period in ticks (which is basically for ever).
-        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
-        NotShowing = false;
-        yield();
-        while (bFastLEDShowWait)
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#if FASTLED_STUTTER_REDUCTION
+        if (!frameGovernorAnyDue(esp_timer_get_time()))
+            {
+            frameGovernorRequestRelease();  // Too soon, so back to the queue until a deadline.
+            continue;
+            }
+#else
+        // Without the governor a queued frame would go as soon as the last
+        // show returned, before its LEDs had their reset time to latch.
+        uint64_t latchedUs = lastShowStartUs + lastShowWireUs;
+        uint64_t nowUs = esp_timer_get_time();
+        if (nowUs < latchedUs)
             {
-            yield();
+            delayMicroseconds((uint32_t) (latchedUs - nowUs));
             }
+#endif
+        int8_t slot = showSchedulerBeginTransmit();
+        if (slot < 0)
+            {
+            continue;
+            }
+        showSlot = slot;
+#if FASTLED_OUTPUT_STAGE
+        uint8_t wireBuffer = showSchedulerTransmitWire();
+        for (int i = 0; i < fastLedOutputCount; i++)
+            {
+            controllers[i]->setLeds(fastLedOutputs[i].wire[wireBuffer], fastLedOutputs[i].size);
+            }
+#else
+        for (int i = 0; i < fastLedOutputCount; i++)
+            {
+            controllers[i]->setLeds(fastLedOutputs[i].buffers[slot], fastLedOutputs[i].size);
+            }
+#endif
+        uint64_t startUs = showSchedulerTransmitStartUs();
+        uint32_t lateUs = FASTLED_NOT_LATE;
+#if FASTLED_STUTTER_REDUCTION
+        uint8_t controllerMask = fastLedGroupControllers(frameGovernorTakeDueGroups(startUs, showSchedulerSubmittedUs(), &lateUs));
+#else
+        uint8_t controllerMask = fastLedAllControllers();
+#endif
+        uint8_t unchangedMask = 0;
+        uint8_t refreshMask = 0;
+#if FASTLED_SKIP_UNCHANGED
+        unchangedMask = fastLedUnchangedControllers(controllerMask, slot, startUs, &refreshMask);
+        controllerMask &= ~unchangedMask;
+#endif
         DEBUG_ASSERT(FastLED.size() > 0);
-        DEBUG_ASSERT(FastLED.count() == 4);
-        FastLED.show(uiBrightness);
-        yield();
-        NotShowing = true;
+        DEBUG_ASSERT(FastLED.count() == fastLedOutputCount);
+        uint64_t endUs = startUs;
+        if (controllerMask != 0)    // Not if nothing has changed.
+            {
+            jamWatchdogArm(fastLedMaskWireTimeUs(controllerMask));
+            fastLedShowControllers(controllerMask);
+            endUs = esp_timer_get_time();
+#if !FASTLED_STUTTER_REDUCTION
+            lastShowStartUs = startUs;
+            lastShowWireUs = fastLedMaskWireTimeUs(controllerMask);
+#endif
+            int8_t recoveredAtStep = jamWatchdogDisarm(startUs, endUs);
+            rtcTelemetryRecordShow(recoveredAtStep);
+            bootProfileMark(BOOT_STAGE_FIRST_FRAME);
+#if FASTLED_SKIP_UNCHANGED
+            fastLedRecordSent(controllerMask, slot, startUs, recoveredAtStep >= 0);
+#endif
+            }
+        fastLedStatsRecordShow(showSchedulerSubmittedUs(), startUs, endUs, lateUs, controllerMask, unchangedMask, refreshMask);
+        if (showSchedulerEndTransmit())
+            {
+            // Another frame queued up while this one was on the wire.
+#if FASTLED_STUTTER_REDUCTION
+            frameGovernorRequestRelease();
+#else
+            showSchedulerRelease();
+#endif
+            }
+        }
+    }
+
+
+/// @brief Render task (core 0, FASTLED_RENDER_PIPELINE): paints a frame and
+/// submits it, once a frame period (of the slowest group).
+/// @param param The FastLedRenderFunction.
+static void fastLedRenderTask(void* param)
+    {
+    FastLedRenderFunction render = (FastLedRenderFunction) param;
+    TickType_t periodTicks = pdMS_TO_TICKS(fastLedFramePeriodUs() / 1000);
+    if (periodTicks == 0)
+        {
+        periodTicks = 1;
+        }
+    TickType_t lastWakeTicks = xTaskGetTickCount();
+    while (true)
+        {
+        render();
+        FastLEDshow();
+        vTaskDelayUntil(&lastWakeTicks, periodTicks);
         }
     }
 
+
+/// @brief Starts the render task on core 0, with a static stack.  From then on
+/// only it may paint into the arena or call FastLEDshow().  Call it after
+/// fastLedPostInit(), once, and not at all unless FASTLED_RENDER_PIPELINE.
+/// @param render Paints the next frame (e.g. paint_random_leds()).
+void fastLedStartRenderTask(FastLedRenderFunction render)
+    {
+    static StackType_t renderTaskStack[FASTLED_RENDER_STACK_BYTES];
+    static StaticTask_t renderTaskBuffer;
+    TaskHandle_t renderTask = xTaskCreateStaticPinnedToCore(
+        fastLedRenderTask,
+        "fastLedRenderTask",
+        FASTLED_RENDER_STACK_BYTES,
+        (void*) render,
+        FASTLED_RENDER_PRIORITY,
+        renderTaskStack,
+        &renderTaskBuffer,
+        FASTLED_RENDER_CORE);
+    taskStatsRegister(renderTask, "fastLedRenderTask", FASTLED_RENDER_STACK_BYTES, true);
+    }
+
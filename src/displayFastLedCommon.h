@@ -26,6 +26,41 @@
 # define FASTLED_RMT_MAX_TICKS_FOR_GTX_SEM  (2000/portTICK_PERIOD_MS)
 #endif
 
+// The warm restart (fastLedWarmRestart(), a jam watchdog step before
+// ESP.restart()) relies on this being added next to GiveGTX_sem() in
+// FastLED\src\platforms\esp\32\clockless_rmt_esp32.cpp, to put the driver
+// back as it was before the first show.  Whatever task was inside
+// showPixels() must have been deleted first.
+// void ResetRMT(int pin)
+//     {
+//     if (gRMT_intr_handle != NULL)
+//         {
+//         esp_intr_free(gRMT_intr_handle);
+//         gRMT_intr_handle = NULL;
+//         }
+//     for (int channel = 0; channel < gMaxChannel; channel++)
+//         {
+//         rmt_tx_stop((rmt_channel_t) channel);
+//         gOnChannel[channel] = NULL;
+//         }
+//     periph_module_reset(PERIPH_RMT_MODULE);
+//     gNumStarted = 0;
+//     gNumDone = 0;
+//     gNext = 0;
+//     if (gTX_sem != NULL)
+//         {
+//         vSemaphoreDelete(gTX_sem);
+//         gTX_sem = NULL;
+//         }
+//     gInitialized = false;
+//     ESP32RMTController::init((gpio_num_t) pin);  // Channels, gTX_sem and the interrupt again.
+//     }
+// If false the ladder goes straight from GiveGTX_sem() to ESP.restart().
+#define FASTLED_RMT_RESET true
+#if FASTLED_RMT_RESET
+extern void ResetRMT(int pin);
+#endif
+
 
 // Default settings for reference: (Things I've seen people try to address Esp32 RMT driver issues).
 // #define FASTLED_RMT_MAX_CHANNELS 8
@@ -121,7 +156,7 @@ following line *before* you include FastLED.h:  #define FASTLED_ESP32_FLASH_LOCK
 #define STEREO_DISPLAY true                     // If true, L&R channels are independent. 
                                                 // If false, both L&R outputs display same 
                                                 // data from L audio channel.
-#define FASTLED_STUTTER_REDUCTION   true
+#define FASTLED_STUTTER_REDUCTION   true      // Pace frames with the frame governor.
 
 #define _STRINGIFY(s) #s
 #define STRINGIFY(s) _STRINGIFY(s)
@@ -132,6 +167,9 @@ following line *before* you include FastLED.h:  #define FASTLED_ESP32_FLASH_LOCK
 #define COLOR_ORDER_STRAND GRB   // If colours look wrong, play with this
 #define LED_CHIPSET_MATRIX          WS2812B  // LED type  WS2812B
 #define LED_CHIPSET_STRAND          WS2812B  // WS2812? or WS2812B (or am I using both?) // LED string type [WS2812B]
+// Wire timing for the above (both the same here), used to work out the frame period.
+#define LED_CHIPSET_BIT_NS          1250     // 800 kilobits/sec.
+#define LED_CHIPSET_RESET_US        50       // Latch time. Newer WS2812B (V5) datasheets want 280.
 
 // This is define in the main app!  NOT HERE!
 // #define MAX_MILLIAMPS 500  // Careful with the amount of power here if running off USB port
@@ -155,22 +193,131 @@ following line *before* you include FastLED.h:  #define FASTLED_ESP32_FLASH_LOCK
 #define FASTLED_MATRIX_LEFT 2
 #define FASTLED_MATRIX_RIGHT 3
 
-#define NUM_FASTLED_CONTROLLERS 4
-
-extern CLEDController* controllers[NUM_FASTLED_CONTROLLERS];
+// Controller registry.  Controllers are numbered in the order they are added
+// (so the four above are the demo's), up to one per Esp32 RMT channel,
+// and a controller mask (bit i is controllers[i]) fits in a uint8_t.
+#define FASTLED_MAX_CONTROLLERS 8
+
+// Controllers in the same group latch together and share a frame period
+// (the wire time of the longest one).
+#define FASTLED_GROUP_STRANDS   0
+#define FASTLED_GROUP_MATRICES  1
+#define NUM_FASTLED_GROUPS      2
+
+// FastLED's Esp32 RMT driver doesn't start sending until every controller
+// has called showLeds(), so a controller that isn't due this frame is
+// "parked" by showing it with zero LEDs (which sends nothing, and the
+// LEDs keep what they had).  Set false for drivers that send per controller.
+#define FASTLED_PARK_IDLE_CONTROLLERS true
+
+// If true colour correction, brightness and the power limit are applied on
+// core 0 by the output stage (fastLedOutputStage.h) into a wire buffer, and
+// the show just sends that.  If false FastLED does it inside the show.
+#define FASTLED_OUTPUT_STAGE true
+#define FASTLED_OUTPUT_STAGE_BUFFERS 2  // Wire buffers: one frame staged while the one before is sent.
+#define FASTLED_CORRECTION TypicalLEDStrip
+
+// If true frames are painted by a render task on core 0 (fastLedStartRenderTask())
+// instead of the loop, so painting a frame overlaps sending the one before on
+// core 1.  Frames go to the show task through a queue of FASTLED_FRAME_SLOTS
+// preallocated frame buffers (see fastLedShowScheduler.h).  3, the default
+// with or without the render task, lets a finished frame wait while another
+// is on the wire, so the next show can start as soon as that one is done.
+// 2 is plain double buffering, which has to drop a frame finished while the
+// other is on the wire (there'd be nowhere left to paint).  When
+// the renderer has no free slot FASTLED_FRAME_DROP_OLDEST drops the oldest
+// frame that hasn't started, FASTLED_FRAME_DROP_NEWEST refuses the new one.
+#define FASTLED_RENDER_PIPELINE false
+#define FASTLED_FRAME_SLOTS 3
+#define FASTLED_FRAME_DROP_OLDEST 0
+#define FASTLED_FRAME_DROP_NEWEST 1
+#define FASTLED_FRAME_DROP_POLICY FASTLED_FRAME_DROP_OLDEST
+
+// If true a controller whose LEDs and brightness are the same as when it was
+// last sent is left out of the show (parked), which saves its RMT interrupts,
+// and a show with nothing changed isn't done at all.  Each slot keeps a
+// generation per segment, bumped by anything that writes to it.  Every
+// controller is still sent at least every FASTLED_FULL_REFRESH_MS (0 for
+// never), in case a frame went wrong on the wire, and after a jam.
+#define FASTLED_SKIP_UNCHANGED true
+#define FASTLED_FULL_REFRESH_MS 1000
+
+// If true frames come from a host over the slave SPI pins (fastLedIngest.h)
+// rather than being painted here: raw, RLE or XOR delta packets decoded
+// into the arena, one frame at a time.  Not with FASTLED_RENDER_PIPELINE.
+#define FASTLED_SPI_INGEST false
+
+typedef enum
+    {
+    FASTLED_OUTPUT_STRAND = 0,      // LED_CHIPSET_STRAND, COLOR_ORDER_STRAND
+    FASTLED_OUTPUT_MATRIX           // LED_CHIPSET_MATRIX, COLOR_ORDER_MATRIX
+    } FastLedOutputType;
+
+typedef struct
+    {
+    CLEDController* controller;
+    CRGB* buffers[FASTLED_FRAME_SLOTS];     // One per frame slot, see fastLedSwapBuffers().
+    CRGB* wire[FASTLED_OUTPUT_STAGE_BUFFERS];    // What the controller sends, with FASTLED_OUTPUT_STAGE.
+    FastLedOutputType type;
+    uint16_t size;
+    uint8_t pin;
+    uint8_t group;
+    uint8_t segmentMask;    // Arena segments it sends (bit i is segment i), 0 if not from the arena.
+    } FastLedOutput;
+
+// A run of LEDs in the LED arena, sent by one controller.
+typedef struct
+    {
+    uint16_t offset;            // Into the arena, in LEDs.
+    uint16_t length;
+    uint8_t controller;         // Registry index (FASTLED_STRAND_LEFT etc.).
+    FastLedOutputType layout;
+    } FastLedSegment;
+
+extern CLEDController* controllers[FASTLED_MAX_CONTROLLERS];
 
 extern bool bFastLedReady;
 extern bool bFastLedInitialised;
 extern uint8_t FastLedCommonDitherMode;
-extern volatile bool bFastLEDShowWait;
 
 extern void fastLedSetup(void);
+extern int8_t fastLedAddOutput(uint8_t pin, FastLedOutputType type, CRGB* const* buffers, uint16_t size, uint8_t group);
+extern uint8_t fastLedAddPlannedOutputs(const uint16_t* segmentLengths, uint16_t segmentCount, 
+                                        const uint8_t* pins, uint8_t pinCount, FastLedOutputType type, 
+                                        CRGB* const* buffers, uint8_t group);
+extern uint8_t fastLedControllerCount(void);
+extern uint8_t fastLedAllControllers(void);
+extern const FastLedOutput* fastLedGetOutput(uint8_t index);
 extern float fastLedCalcFrameRate(uint16_t numberOfLeds);
+extern uint32_t fastLedFramePeriodUs(void);
 extern void fastLedPostInit(void);
+extern void fastLedFrameRateReport(void);
 extern void FastLEDshow(void);
+extern void fastLedShowControllers(uint8_t controllerMask);
+extern void fastLedSwapBuffers(uint8_t renderSlot);
+#if FASTLED_RMT_RESET
+extern void fastLedWarmRestart(void);
+#endif
+
+// Paints the next frame into the arena, for the render task.
+typedef void (*FastLedRenderFunction)(void);
+extern void fastLedStartRenderTask(FastLedRenderFunction render);
+
 
+extern CRGB* fastLedArenaLeds(void);
+extern uint16_t fastLedArenaSize(void);
+extern uint8_t fastLedSegmentCount(void);
+extern const FastLedSegment* fastLedGetSegment(uint8_t index);
+extern CRGB* fastLedSegmentLeds(uint8_t index);
+extern void fastLedSetPixel(uint8_t segment, uint16_t index, const CRGB& colour);
+extern void fastLedArenaFill(const CRGB& colour);
+extern void fastLedArenaScale(uint8_t scale);
+extern void fastLedArenaCopy(const CRGB* source);
 
 extern void clear_all_leds(void);
 extern void paint_random_leds(void);
+extern void paint_random_segments(uint8_t segmentMask);
+extern void paint_random_leds_seed(uint32_t seed);
+extern void paint_random_leds_benchmark(uint16_t frames);
 
 #endif /* _DISPLAY_FAST_LED_COMMON_H_ */
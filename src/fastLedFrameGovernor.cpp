@@ -0,0 +1,213 @@
+#include "displayFastLedCommon.h"
+#include "fastLedShowScheduler.h"
+#include "fastLedFrameGovernor.h"
+
+static portMUX_TYPE frameGovernorMux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t releaseTimer = NULL;
+static uint8_t numberOfGroups = 0;
+static uint32_t periodUs[FASTLED_MAX_GROUPS] = {};
+static uint64_t nextDeadlineUs[FASTLED_MAX_GROUPS] = {};
+static uint64_t lastStartUs[FASTLED_MAX_GROUPS] = {};
+static uint32_t groupShows[FASTLED_MAX_GROUPS] = {};  // Not reset by a warm restart.
+static bool bReleaseArmed = false;
+
+static void frameGovernorTimerCallback(void* arg);
+
+
+/// @brief Exact time on the wire for one frame on one pin: 24 bits
+/// per LED at the chipset's bit time, plus the reset (latch) time.
+/// @param numberOfLeds Number of LEDs on a single pin or controller.
+/// @return Microseconds, rounded up.
+uint32_t fastLedWireTimeUs(uint16_t numberOfLeds)
+    {
+    uint32_t bitsNs = (uint32_t) numberOfLeds * 24UL * LED_CHIPSET_BIT_NS;
+    return((bitsNs + 999UL) / 1000UL + LED_CHIPSET_RESET_US);
+    }
+
+
+/// @brief Sets the frame period of each group and starts every grid at now.
+/// @param groupPeriodsUs Usually the wire time of the longest controller in the group.
+/// @param groupCount Up to FASTLED_MAX_GROUPS.
+void frameGovernorInit(const uint32_t* groupPeriodsUs, uint8_t groupCount)
+    {
+    if (releaseTimer == NULL)
+        {
+        esp_timer_create_args_t timerArgs;
+        memset(&timerArgs, 0, sizeof(timerArgs));
+        timerArgs.callback = frameGovernorTimerCallback;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = "frameGovernor";
+        esp_timer_create(&timerArgs, &releaseTimer);
+        }
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&frameGovernorMux);
+    numberOfGroups = (groupCount < FASTLED_MAX_GROUPS) ? groupCount : FASTLED_MAX_GROUPS;
+    for (uint8_t group = 0; group < numberOfGroups; group++)
+        {
+        periodUs[group] = groupPeriodsUs[group];
+        nextDeadlineUs[group] = nowUs;
+        lastStartUs[group] = 0;
+        }
+    portEXIT_CRITICAL(&frameGovernorMux);
+    }
+
+
+/// @brief When a group can next be sent: its deadline, but never less than
+/// a period after its last show started, or its LEDs wouldn't have latched.
+/// (Only a frame queued behind the last one, with a render pipeline, can be
+/// that early.)  Inside the critical section.
+static uint64_t frameGovernorReadyUs(uint8_t group)
+    {
+    uint64_t latchedUs = lastStartUs[group] + periodUs[group];
+    return((lastStartUs[group] > 0 && latchedUs > nextDeadlineUs[group]) ? latchedUs : nextDeadlineUs[group]);
+    }
+
+
+/// @brief A frame has been queued: release it to the show task now if any
+/// group's deadline has passed, otherwise when one does.
+void frameGovernorRequestRelease(void)
+    {
+    bool bReleaseNow = false;
+    uint64_t waitUs = 0;
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&frameGovernorMux);
+    if (!bReleaseArmed)
+        {
+        uint64_t earliestUs = UINT64_MAX;
+        for (uint8_t group = 0; group < numberOfGroups; group++)
+            {
+            if (frameGovernorReadyUs(group) < earliestUs)
+                {
+                earliestUs = frameGovernorReadyUs(group);
+                }
+            }
+        // A group that is only waiting for its LEDs to latch, just after
+        // the release would be, goes with this frame rather than missing it.
+        uint64_t releaseUs = (nowUs > earliestUs) ? nowUs : earliestUs;
+        uint64_t slackEndUs = releaseUs + FASTLED_GROUP_LATCH_SLACK_US;
+        for (uint8_t group = 0; group < numberOfGroups; group++)
+            {
+            uint64_t readyUs = frameGovernorReadyUs(group);
+            if (readyUs > nextDeadlineUs[group] && readyUs <= slackEndUs && readyUs > releaseUs)
+                {
+                releaseUs = readyUs;
+                }
+            }
+        earliestUs = releaseUs;
+        if (nowUs >= earliestUs)
+            {
+            bReleaseNow = true;
+            }
+        else
+            {
+            waitUs = earliestUs - nowUs;
+            bReleaseArmed = true;
+            }
+        }
+    portEXIT_CRITICAL(&frameGovernorMux);
+    if (bReleaseNow)
+        {
+        showSchedulerRelease();
+        }
+    else if (waitUs > 0)
+        {
+        esp_timer_start_once(releaseTimer, waitUs);
+        }
+    }
+
+
+/// @brief Whether a group is due (inside the critical section).
+static bool frameGovernorGroupDue(uint8_t group, uint64_t startUs)
+    {
+    return(nextDeadlineUs[group] <= startUs + FASTLED_GROUP_LATCH_SLACK_US
+           && (lastStartUs[group] == 0 || startUs >= lastStartUs[group] + periodUs[group]));
+    }
+
+
+/// @brief Whether any group could be sent now.  The show task asks before
+/// it takes a frame, so one released too soon waits for its deadline
+/// rather than going out before its LEDs have latched.
+bool frameGovernorAnyDue(uint64_t nowUs)
+    {
+    bool bDue = false;
+    portENTER_CRITICAL(&frameGovernorMux);
+    for (uint8_t group = 0; group < numberOfGroups; group++)
+        {
+        bDue |= frameGovernorGroupDue(group, nowUs);
+        }
+    portEXIT_CRITICAL(&frameGovernorMux);
+    return(bDue || numberOfGroups == 0);
+    }
+
+
+/// @brief The show task is starting on a frame: works out which groups are
+/// due and moves each of them on to its next deadline.
+/// @param startUs When the show is starting.
+/// @param submittedUs When the frame was submitted.
+/// @param lateUs Set to how far past its own deadline the latest due group
+/// is, counting only groups whose deadline the frame was waiting for.  A
+/// frame submitted after a deadline is late because the loop is, not the
+/// show, so if that goes for every due group it's FASTLED_NOT_LATE.
+/// @return Bit mask of the groups to send (none if it's too soon for all of them).
+uint8_t frameGovernorTakeDueGroups(uint64_t startUs, uint64_t submittedUs, uint32_t* lateUs)
+    {
+    uint8_t dueGroups = 0;
+    uint32_t latestUs = FASTLED_NOT_LATE;
+    portENTER_CRITICAL(&frameGovernorMux);
+    for (uint8_t group = 0; group < numberOfGroups; group++)
+        {
+        if (frameGovernorGroupDue(group, startUs))
+            {
+            dueGroups |= (1 << group);
+            }
+        }
+    for (uint8_t group = 0; group < numberOfGroups; group++)
+        {
+        if (dueGroups & (1 << group))
+            {
+            if (submittedUs <= nextDeadlineUs[group])
+                {
+                uint32_t groupLateUs = (startUs > nextDeadlineUs[group]) ? (uint32_t) (startUs - nextDeadlineUs[group]) : 0;
+                if (latestUs == FASTLED_NOT_LATE || groupLateUs > latestUs)
+                    {
+                    latestUs = groupLateUs;
+                    }
+                }
+            lastStartUs[group] = startUs;
+            groupShows[group]++;
+            nextDeadlineUs[group] += periodUs[group];
+            if (nextDeadlineUs[group] < startUs)
+                {
+                nextDeadlineUs[group] = startUs + periodUs[group]; // A whole period (or more) behind, so re-anchor.
+                }
+            }
+        }
+    portEXIT_CRITICAL(&frameGovernorMux);
+    *lateUs = latestUs;
+    return(dueGroups);
+    }
+
+
+uint32_t frameGovernorPeriodUs(uint8_t group)
+    {
+    return(periodUs[group]);
+    }
+
+
+/// @brief How many shows a group has been in (since boot), so animation can
+/// go at its actual refresh rate, whatever rate frames are painted at.
+uint32_t frameGovernorGroupShows(uint8_t group)
+    {
+    return((group < FASTLED_MAX_GROUPS) ? groupShows[group] : 0);
+    }
+
+
+/// @brief esp_timer task (core 0): a deadline for the pending frame has come.
+static void frameGovernorTimerCallback(void* arg)
+    {
+    (void) arg;
+    portENTER_CRITICAL(&frameGovernorMux);
+    bReleaseArmed = false;
+    portEXIT_CRITICAL(&frameGovernorMux);
+    showSchedulerRelease();
+    }
@@ -0,0 +1,41 @@
+#ifndef _FAST_LED_FRAME_GOVERNOR_H_
+#define _FAST_LED_FRAME_GOVERNOR_H_
+
+#include <Arduino.h>
+
+// Releases submitted frames to the show task on absolute deadlines
+// (t0, t0 + period, t0 + 2 * period ...) using an esp_timer one-shot,
+// rather than EVERY_N_MILLISECONDS plus FastLED.setMaxRefreshRate().
+//
+// Each group of controllers (ones that should latch together) has its own
+// period and deadline grid.  The timer is armed for whichever group is due
+// first, and when the show task starts it takes every group that is due (or
+// within FASTLED_GROUP_LATCH_SLACK_US of it) and sends just those controllers.
+// That doesn't make a short group run faster than a long one: one show
+// waits for its longest controller, by when a group whose period is its
+// wire time is due again.  So with a painter that keeps up every group is
+// in every show, at the slowest group's rate.  A group is only left out when
+// a frame comes between its deadline and a shorter group's.
+//
+// A frame that is submitted early waits in the scheduler's queue
+// (and newer frames may replace it) until a deadline.  A late frame goes
+// straight away and that group's next deadline stays on its grid, so 
+// lateness doesn't accumulate; if a group falls more than a whole period
+// behind its grid is re-anchored rather than bursting to catch up.  A group
+// is never sent less than a period after it last was (even within the
+// slack), which only a frame queued behind the last one could be, so its
+// LEDs always get their reset time to latch.
+
+#define FASTLED_MAX_GROUPS              4
+#define FASTLED_GROUP_LATCH_SLACK_US    500
+#define FASTLED_NOT_LATE                UINT32_MAX  // No due group's deadline to be late against.
+
+extern uint32_t fastLedWireTimeUs(uint16_t numberOfLeds);
+extern void frameGovernorInit(const uint32_t* groupPeriodsUs, uint8_t groupCount);
+extern void frameGovernorRequestRelease(void);
+extern bool frameGovernorAnyDue(uint64_t nowUs);
+extern uint8_t frameGovernorTakeDueGroups(uint64_t startUs, uint64_t submittedUs, uint32_t* lateUs);
+extern uint32_t frameGovernorPeriodUs(uint8_t group);
+extern uint32_t frameGovernorGroupShows(uint8_t group);
+
+#endif /* _FAST_LED_FRAME_GOVERNOR_H_ */
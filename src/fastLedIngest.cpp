@@ -0,0 +1,246 @@
+#include "FastLED_Hang_Fix_Demo.h"
+#include "debug_conditionals.h"
+#include "displayFastLedCommon.h"
+#include "fastLedIngest.h"
+
+#if FASTLED_SPI_INGEST
+
+#if defined(FASTLED_SIM)
+# error "There is no slave SPI in the simulation, see tools/ingest_encode.cpp --loopback"
+#endif
+#if FASTLED_RENDER_PIPELINE
+# error "Frames come from either the host (FASTLED_SPI_INGEST) or the render task (FASTLED_RENDER_PIPELINE)"
+#endif
+
+#include <driver/spi_slave.h>
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <soc/gpio_reg.h>
+#include "task_stats.h"
+
+// HSPI, through the GPIO matrix as our pins aren't its IO_MUX ones, which
+// the ESP32's slave is good for up to about 10MHz (a 470 LED raw packet in 1.2ms).
+#define FASTLED_INGEST_SPI_HOST     HSPI_HOST
+#define FASTLED_INGEST_SPI_MODE     0
+#define FASTLED_INGEST_QUEUE        1
+
+// Only paints into the arena, so core 0 like the render task, and the same
+// stack (the simulation can't run it, so it hasn't been measured).
+#define FASTLED_INGEST_CORE         0
+#define FASTLED_INGEST_PRIORITY     (tskIDLE_PRIORITY + 1)
+#define FASTLED_INGEST_STACK_BYTES  8192
+
+static_assert(GPIO_HPSI_HANDSHAKE < 32, "the handshake is set with GPIO_OUT_W1TS_REG");
+
+WORD_ALIGNED_ATTR DRAM_ATTR static uint8_t ingestHeaderBuffer[INGEST_HEADER_BYTES];
+WORD_ALIGNED_ATTR DRAM_ATTR static uint8_t ingestStaging[INGEST_MAX_PAYLOAD_BYTES];
+
+static FastLedIngestReceiver ingestReceiver;
+static uint32_t ingestZeroCopyPackets = 0;
+static portMUX_TYPE ingestMux = portMUX_INITIALIZER_UNLOCKED;
+
+
+/// @brief spi_slave post setup callback (ISR): a transaction is queued,
+/// so tell the host it can go.
+static void IRAM_ATTR fastLedIngestReady(spi_slave_transaction_t* transaction)
+    {
+    WRITE_PERI_REG(GPIO_OUT_W1TS_REG, (1 << GPIO_HPSI_HANDSHAKE));
+    }
+
+
+/// @brief spi_slave post transaction callback (ISR): wait until the next one is queued.
+static void IRAM_ATTR fastLedIngestTaken(spi_slave_transaction_t* transaction)
+    {
+    WRITE_PERI_REG(GPIO_OUT_W1TC_REG, (1 << GPIO_HPSI_HANDSHAKE));
+    }
+
+
+/// @brief Receives one transaction (raising the handshake while it waits).
+/// @return Bytes the host sent (anything past bytes is dropped).
+static size_t fastLedIngestReceive(uint8_t* buffer, size_t bytes)
+    {
+    spi_slave_transaction_t transaction = { };
+    transaction.length = bytes * 8;
+    transaction.rx_buffer = buffer;
+    spi_slave_transmit(FASTLED_INGEST_SPI_HOST, &transaction, portMAX_DELAY);
+    return(transaction.trans_len / 8);
+    }
+
+
+/// @brief Takes a packet's payload off the wire and decodes it into the back slot.
+/// @return How it went.
+static FastLedIngestResult fastLedIngestPayload(const FastLedIngestHeader* header, FastLedIngestResult accepted)
+    {
+    size_t paddedBytes = ingestPaddedBytes(header->payloadBytes);
+    if (accepted != INGEST_OK)
+        {
+        fastLedIngestReceive(ingestStaging, paddedBytes);   // Still has to come off the wire.
+        return(accepted);
+        }
+    uint8_t* leds = (uint8_t*) (fastLedSegmentLeds(header->segment) + header->offset);
+    if (header->encoding == INGEST_RAW && header->payloadBytes == header->count * INGEST_BYTES_PER_LED
+        && ((uintptr_t) leds & 3) == 0 && (header->payloadBytes & 3) == 0)
+        {
+        // Straight into the arena.  If it's no good the frame isn't shown,
+        // and the receiver wants the segment again before any deltas.
+        ingestZeroCopyPackets++;
+        if (fastLedIngestReceive(leds, header->payloadBytes) < header->payloadBytes
+            || ingestPayloadCheck(leds, header->payloadBytes) != header->payloadCheck)
+            {
+            return(INGEST_BAD_PAYLOAD);
+            }
+        return(INGEST_OK);
+        }
+    if (fastLedIngestReceive(ingestStaging, paddedBytes) < header->payloadBytes
+        || ingestPayloadCheck(ingestStaging, header->payloadBytes) != header->payloadCheck)
+        {
+        return(INGEST_BAD_PAYLOAD);
+        }
+    return(ingestDecode(header->encoding, ingestStaging, header->payloadBytes, leds, header->count));
+    }
+
+
+/// @brief Ingest task (core 0): a packet at a time, showing each frame
+/// that arrives whole, then holding the host off for the rest of the frame period.
+static void fastLedIngestTask(void* param)
+    {
+    TickType_t periodTicks = pdMS_TO_TICKS(fastLedFramePeriodUs() / 1000);
+    if (periodTicks == 0)
+        {
+        periodTicks = 1;
+        }
+    TickType_t lastFrameTicks = xTaskGetTickCount();
+    while (true)
+        {
+        FastLedIngestHeader header;
+        FastLedIngestResult result = INGEST_BAD_HEADER;
+        if (fastLedIngestReceive(ingestHeaderBuffer, INGEST_HEADER_BYTES) == INGEST_HEADER_BYTES)
+            {
+            result = ingestParseHeader(ingestHeaderBuffer, &header);
+            }
+        if (result != INGEST_OK)
+            {
+            // Wait for the next header, the host will have to send this packet's
+            // payload (to us, a bad header), which puts us back in step.
+            portENTER_CRITICAL(&ingestMux);
+            ingestReceiverReject(&ingestReceiver, result);
+            portEXIT_CRITICAL(&ingestMux);
+            continue;
+            }
+        portENTER_CRITICAL(&ingestMux);
+        FastLedIngestResult accepted = ingestReceiverAccept(&ingestReceiver, &header);
+        portEXIT_CRITICAL(&ingestMux);
+        result = fastLedIngestPayload(&header, accepted);
+        portENTER_CRITICAL(&ingestMux);
+        bool bShow = ingestReceiverFinish(&ingestReceiver, &header, result);
+        portEXIT_CRITICAL(&ingestMux);
+        if (header.flags & INGEST_FLAG_END_OF_FRAME)
+            {
+            if (bShow)
+                {
+                FastLEDshow();
+                }
+            if (xTaskGetTickCount() - lastFrameTicks > periodTicks)
+                {
+                lastFrameTicks = xTaskGetTickCount();   // The host went quiet, don't let it burst.
+                }
+            vTaskDelayUntil(&lastFrameTicks, periodTicks);
+            }
+        }
+    }
+
+
+/// @brief Sets up the slave SPI (with DMA) and the handshake, and starts the
+/// ingest task on core 0 with a static stack.  Call it after fastLedPostInit(),
+/// once, and from then on nothing else may paint into the arena or call FastLEDshow().
+void fastLedIngestStart(void)
+    {
+    uint16_t lengths[INGEST_MAX_SEGMENTS];
+    uint8_t segmentCount = fastLedSegmentCount();
+    DEBUG_ASSERT(segmentCount <= INGEST_MAX_SEGMENTS);
+    for (uint8_t segment = 0; segment < segmentCount; segment++)
+        {
+        lengths[segment] = fastLedGetSegment(segment)->length;
+        }
+    ingestReceiverInit(&ingestReceiver, lengths, segmentCount);
+
+    gpio_config_t handshake = { };
+    handshake.pin_bit_mask = (1ULL << GPIO_HPSI_HANDSHAKE);
+    handshake.mode = GPIO_MODE_OUTPUT;
+    gpio_config(&handshake);
+    gpio_set_level((gpio_num_t) GPIO_HPSI_HANDSHAKE, 0);
+
+    spi_bus_config_t bus = { };
+    bus.mosi_io_num = GPIO_HPSI_MOSI;
+    bus.miso_io_num = GPIO_HPSI_MISO;
+    bus.sclk_io_num = GPIO_HPSI_SCLK;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = INGEST_MAX_PAYLOAD_BYTES;
+    spi_slave_interface_config_t slave = { };
+    slave.spics_io_num = GPIO_HPSI_CS;
+    slave.queue_size = FASTLED_INGEST_QUEUE;
+    slave.mode = FASTLED_INGEST_SPI_MODE;
+    slave.post_setup_cb = fastLedIngestReady;
+    slave.post_trans_cb = fastLedIngestTaken;
+    // No rogue clocks or selects while the host isn't driving them.  (Not
+    // MOSI, GPIO 12 is a strapping pin and must be low at boot.)
+    gpio_set_pull_mode((gpio_num_t) GPIO_HPSI_SCLK, GPIO_PULLUP_ONLY);
+    gpio_set_pull_mode((gpio_num_t) GPIO_HPSI_CS, GPIO_PULLUP_ONLY);
+    esp_err_t error = spi_slave_initialize(FASTLED_INGEST_SPI_HOST, &bus, &slave, SPI_DMA_CH_AUTO);
+    if (error != ESP_OK)
+        {
+        DEBUG_START_SEMAPHORE_BLOCK
+            {
+            DEBUG_PRINT("Slave SPI failed to start: ");
+            DEBUG_PRINTLN(esp_err_to_name(error));
+            DEBUG_SEMAPHORE_RELEASE;
+            }
+        return;
+        }
+
+    static StackType_t ingestTaskStack[FASTLED_INGEST_STACK_BYTES];
+    static StaticTask_t ingestTaskBuffer;
+    TaskHandle_t ingestTask = xTaskCreateStaticPinnedToCore(
+        fastLedIngestTask,
+        "fastLedIngestTask",
+        FASTLED_INGEST_STACK_BYTES,
+        NULL,
+        FASTLED_INGEST_PRIORITY,
+        ingestTaskStack,
+        &ingestTaskBuffer,
+        FASTLED_INGEST_CORE);
+    taskStatsRegister(ingestTask, "fastLedIngestTask", FASTLED_INGEST_STACK_BYTES, true);
+    }
+
+
+/// @brief Prints the packet counts by result, and frames shown and thrown away.
+void fastLedIngestReport(void)
+    {
+#ifdef DEBUG_ON
+    FastLedIngestReceiver receiver;
+    portENTER_CRITICAL(&ingestMux);
+    receiver = ingestReceiver;
+    portEXIT_CRITICAL(&ingestMux);
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        DEBUG_PRINT("Ingest: frames shown ");
+        DEBUG_PRINT(receiver.framesShown);
+        DEBUG_PRINT(", discarded ");
+        DEBUG_PRINT(receiver.framesDiscarded);
+        DEBUG_PRINT(", packets zero copy ");
+        DEBUG_PRINT(ingestZeroCopyPackets);
+        for (int result = 0; result < INGEST_RESULTS; result++)
+            {
+            DEBUG_PRINT(", ");
+            DEBUG_PRINT(ingestResultNames[result]);
+            DEBUG_PRINT(" ");
+            DEBUG_PRINT(receiver.results[result]);
+            }
+        DEBUG_PRINTLN(".");
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+#endif
+    }
+
+#endif
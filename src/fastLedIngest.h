@@ -0,0 +1,33 @@
+#ifndef _FAST_LED_INGEST_H_
+#define _FAST_LED_INGEST_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+#include "fastLedIngestFormat.h"
+
+// Frames from a host over the slave SPI pins (GPIO_HPSI_...), with
+// FASTLED_SPI_INGEST, in the packets of fastLedIngestFormat.h.
+//
+// The ingest task (core 0, like the render task) queues each transaction
+// with the ESP32's spi_slave driver and DMA.  GPIO_HPSI_HANDSHAKE goes high
+// once a transaction is queued and low when it is done, so the host waits
+// for it before each header and each payload (as in ESP-IDF's spi_slave
+// example) and never clocks out data that has nowhere to go.  After the
+// last packet of a frame it stays low until a frame period has gone by,
+// so the host can't send frames faster than the LEDs can show them.
+//
+// A raw payload goes straight into the back slot of the LED arena by DMA,
+// with no copy, when it starts on a word and is whole words long (4 LEDs at
+// a time).  Anything else, RLE, XOR deltas and raw that doesn't line up, is
+// received into a staging buffer and decoded from there into the arena.  A
+// frame is submitted with FastLEDshow() at the end of its last packet,
+// unless something in it went wrong.
+//
+// Once fastLedIngestStart() is called only the ingest task may paint into
+// the arena or call FastLEDshow() (so not with FASTLED_RENDER_PIPELINE).
+// Type 'i' in the serial monitor for the packet counts.
+
+extern void fastLedIngestStart(void);
+extern void fastLedIngestReport(void);
+
+#endif /* _FAST_LED_INGEST_H_ */
@@ -0,0 +1,352 @@
+#include <string.h>
+#include "fastLedIngestFormat.h"
+
+const char* const ingestResultNames[INGEST_RESULTS] =
+    {
+    "ok", "bad magic", "bad header", "bad segment", "bad payload", "bad encoding", "sequence gap", "need keyframe"
+    };
+
+
+/// @brief CRC-8 (polynomial 0x07, as telemetryCrc8()) over the header.
+static uint8_t ingestHeaderCheck(const uint8_t* bytes)
+    {
+    uint8_t crc = 0;
+    for (int i = 0; i < INGEST_HEADER_BYTES - 1; i++)
+        {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++)
+            {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+            }
+        }
+    return(crc);
+    }
+
+
+/// @brief Fletcher-16 of a payload.  The sums are only reduced every 4K bytes,
+/// which is as long as 32 bits can go without overflowing.
+uint16_t ingestPayloadCheck(const uint8_t* payload, size_t length)
+    {
+    uint32_t sum1 = 0;
+    uint32_t sum2 = 0;
+    while (length > 0)
+        {
+        size_t block = (length > 4096) ? 4096 : length;
+        length -= block;
+        while (block--)
+            {
+            sum1 += *payload++;
+            sum2 += sum1;
+            }
+        sum1 %= 255;
+        sum2 %= 255;
+        }
+    return((uint16_t) ((sum2 << 8) | sum1));
+    }
+
+
+static inline void ingestPut16(uint8_t* bytes, uint16_t value)
+    {
+    bytes[0] = (uint8_t) value;
+    bytes[1] = (uint8_t) (value >> 8);
+    }
+
+static inline uint16_t ingestGet16(const uint8_t* bytes)
+    {
+    return((uint16_t) (bytes[0] | (bytes[1] << 8)));
+    }
+
+
+/// @brief Packs a header, with its check (payloadCheck should already be set).
+void ingestPackHeader(uint8_t* bytes, const FastLedIngestHeader* header)
+    {
+    bytes[0] = INGEST_MAGIC_0;
+    bytes[1] = INGEST_MAGIC_1;
+    bytes[2] = header->encoding;
+    bytes[3] = header->flags;
+    bytes[4] = header->segment;
+    bytes[5] = header->sequence;
+    ingestPut16(&bytes[6], header->offset);
+    ingestPut16(&bytes[8], header->count);
+    ingestPut16(&bytes[10], header->payloadBytes);
+    ingestPut16(&bytes[12], header->payloadCheck);
+    bytes[14] = 0;
+    bytes[15] = ingestHeaderCheck(bytes);
+    }
+
+
+/// @brief Unpacks a header, checking everything that doesn't need to know the segments.
+FastLedIngestResult ingestParseHeader(const uint8_t* bytes, FastLedIngestHeader* header)
+    {
+    if (bytes[0] != INGEST_MAGIC_0 || bytes[1] != INGEST_MAGIC_1)
+        {
+        return(INGEST_BAD_MAGIC);
+        }
+    header->encoding = bytes[2];
+    header->flags = bytes[3];
+    header->segment = bytes[4];
+    header->sequence = bytes[5];
+    header->offset = ingestGet16(&bytes[6]);
+    header->count = ingestGet16(&bytes[8]);
+    header->payloadBytes = ingestGet16(&bytes[10]);
+    header->payloadCheck = ingestGet16(&bytes[12]);
+    if (bytes[15] != ingestHeaderCheck(bytes) || header->encoding >= INGEST_ENCODINGS
+        || header->payloadBytes > INGEST_MAX_PAYLOAD_BYTES)
+        {
+        return(INGEST_BAD_HEADER);
+        }
+    return(INGEST_OK);
+    }
+
+
+static inline bool ingestSameLed(const uint8_t* a, const uint8_t* b)
+    {
+    return(a[0] == b[0] && a[1] == b[1] && a[2] == b[2]);
+    }
+
+
+/// @brief The LEDs as they are.
+/// @return Payload bytes, 0 if they won't fit in maxBytes.
+size_t ingestEncodeRaw(const uint8_t* leds, uint16_t count, uint8_t* payload, size_t maxBytes)
+    {
+    size_t bytes = (size_t) count * INGEST_BYTES_PER_LED;
+    if (bytes > maxBytes)
+        {
+        return(0);
+        }
+    memcpy(payload, leds, bytes);
+    return(bytes);
+    }
+
+
+/// @brief Runs of the same LED, two or more, as a run and the rest as literals.
+/// @return Payload bytes, 0 if they won't fit in maxBytes.
+size_t ingestEncodeRle(const uint8_t* leds, uint16_t count, uint8_t* payload, size_t maxBytes)
+    {
+    size_t length = 0;
+    uint16_t i = 0;
+    while (i < count)
+        {
+        const uint8_t* led = leds + i * INGEST_BYTES_PER_LED;
+        uint16_t run = 1;
+        while (i + run < count && run < INGEST_MAX_RUN && ingestSameLed(led, led + run * INGEST_BYTES_PER_LED))
+            {
+            run++;
+            }
+        if (run < 2)
+            {
+            // A literal, up to the next run of two.
+            run = 1;
+            while (i + run < count && run < INGEST_MAX_RUN
+                   && !(i + run + 1 < count && ingestSameLed(led + run * INGEST_BYTES_PER_LED, led + (run + 1) * INGEST_BYTES_PER_LED)))
+                {
+                run++;
+                }
+            if (length + 1 + run * INGEST_BYTES_PER_LED > maxBytes)
+                {
+                return(0);
+                }
+            payload[length++] = (uint8_t) (0x80 | (run - 1));
+            memcpy(&payload[length], led, run * INGEST_BYTES_PER_LED);
+            length += run * INGEST_BYTES_PER_LED;
+            }
+        else
+            {
+            if (length + 1 + INGEST_BYTES_PER_LED > maxBytes)
+                {
+                return(0);
+                }
+            payload[length++] = (uint8_t) (run - 1);
+            memcpy(&payload[length], led, INGEST_BYTES_PER_LED);
+            length += INGEST_BYTES_PER_LED;
+            }
+        i += run;
+        }
+    return(length);
+    }
+
+
+/// @brief The LEDs that differ from before, XORed with it, and skips over the rest.
+/// @return Payload bytes, 0 if they won't fit in maxBytes.
+size_t ingestEncodeXor(const uint8_t* leds, const uint8_t* before, uint16_t count, uint8_t* payload, size_t maxBytes)
+    {
+    size_t length = 0;
+    uint16_t i = 0;
+    while (i < count)
+        {
+        bool bSame = ingestSameLed(leds + i * INGEST_BYTES_PER_LED, before + i * INGEST_BYTES_PER_LED);
+        uint16_t run = 1;
+        while (i + run < count && run < INGEST_MAX_RUN
+               && ingestSameLed(leds + (i + run) * INGEST_BYTES_PER_LED, before + (i + run) * INGEST_BYTES_PER_LED) == bSame)
+            {
+            run++;
+            }
+        size_t needed = 1 + (bSame ? 0 : run * INGEST_BYTES_PER_LED);
+        if (length + needed > maxBytes)
+            {
+            return(0);
+            }
+        payload[length++] = (uint8_t) ((bSame ? 0 : 0x80) | (run - 1));
+        for (uint16_t byte = 0; !bSame && byte < run * INGEST_BYTES_PER_LED; byte++)
+            {
+            payload[length++] = leds[i * INGEST_BYTES_PER_LED + byte] ^ before[i * INGEST_BYTES_PER_LED + byte];
+            }
+        i += run;
+        }
+    return(length);
+    }
+
+
+/// @brief Decodes a payload into count LEDs (which for INGEST_XOR hold the frame before).
+/// @return INGEST_BAD_ENCODING unless it comes to exactly count LEDs.
+FastLedIngestResult ingestDecode(uint8_t encoding, const uint8_t* payload, uint16_t payloadBytes,
+                                 uint8_t* leds, uint16_t count)
+    {
+    if (encoding == INGEST_RAW)
+        {
+        if (payloadBytes != (uint32_t) count * INGEST_BYTES_PER_LED)
+            {
+            return(INGEST_BAD_ENCODING);
+            }
+        memcpy(leds, payload, payloadBytes);
+        return(INGEST_OK);
+        }
+    const uint8_t* end = payload + payloadBytes;
+    uint8_t* ledsEnd = leds + (size_t) count * INGEST_BYTES_PER_LED;
+    while (payload < end)
+        {
+        uint8_t control = *payload++;
+        size_t bytes = (size_t) ((control & 0x7F) + 1) * INGEST_BYTES_PER_LED;
+        if (bytes > (size_t) (ledsEnd - leds))
+            {
+            return(INGEST_BAD_ENCODING);
+            }
+        if (control & 0x80)
+            {
+            if (bytes > (size_t) (end - payload))
+                {
+                return(INGEST_BAD_ENCODING);
+                }
+            if (encoding == INGEST_RLE)
+                {
+                memcpy(leds, payload, bytes);
+                }
+            else
+                {
+                for (size_t byte = 0; byte < bytes; byte++)
+                    {
+                    leds[byte] ^= payload[byte];
+                    }
+                }
+            payload += bytes;
+            }
+        else if (encoding == INGEST_RLE)
+            {
+            if (end - payload < INGEST_BYTES_PER_LED)
+                {
+                return(INGEST_BAD_ENCODING);
+                }
+            for (size_t byte = 0; byte < bytes; byte += INGEST_BYTES_PER_LED)
+                {
+                leds[byte] = payload[0];
+                leds[byte + 1] = payload[1];
+                leds[byte + 2] = payload[2];
+                }
+            payload += INGEST_BYTES_PER_LED;
+            }
+        leds += bytes;  // A skip (INGEST_XOR) leaves them be.
+        }
+    return((leds == ledsEnd) ? INGEST_OK : INGEST_BAD_ENCODING);
+    }
+
+
+/// @brief Forget every segment (so deltas are refused until each has been
+/// set again) and don't show the frame this is in.
+static void ingestReceiverForget(FastLedIngestReceiver* receiver)
+    {
+    memset(receiver->keyedUpTo, 0, sizeof(receiver->keyedUpTo));
+    receiver->bFrameBad = true;
+    }
+
+
+/// @brief Starts a receiver off knowing none of the segments.
+/// @param lengths Of each segment, in LEDs.
+void ingestReceiverInit(FastLedIngestReceiver* receiver, const uint16_t* lengths, uint8_t segmentCount)
+    {
+    memset(receiver, 0, sizeof(*receiver));
+    receiver->segmentCount = (segmentCount < INGEST_MAX_SEGMENTS) ? segmentCount : INGEST_MAX_SEGMENTS;
+    memcpy(receiver->lengths, lengths, receiver->segmentCount * sizeof(lengths[0]));
+    }
+
+
+/// @brief Whether a packet whose header parsed should be decoded.  Either
+/// way its payload still has to be taken off the wire, and the packet
+/// finished with ingestReceiverFinish().
+/// @return INGEST_OK to decode it, else why not.
+FastLedIngestResult ingestReceiverAccept(FastLedIngestReceiver* receiver, const FastLedIngestHeader* header)
+    {
+    if (receiver->bStarted && header->sequence != receiver->nextSequence)
+        {
+        receiver->results[INGEST_SEQUENCE_GAP]++;
+        ingestReceiverForget(receiver);
+        }
+    receiver->bStarted = true;
+    receiver->nextSequence = (uint8_t) (header->sequence + 1);
+    if (header->segment >= receiver->segmentCount
+        || (uint32_t) header->offset + header->count > receiver->lengths[header->segment])
+        {
+        return(INGEST_BAD_SEGMENT);
+        }
+    if (header->encoding == INGEST_XOR && header->offset + header->count > receiver->keyedUpTo[header->segment])
+        {
+        return(INGEST_NEED_KEYFRAME);
+        }
+    return(INGEST_OK);
+    }
+
+
+/// @brief Counts a packet, and what it means for the frame.
+/// @param result From ingestReceiverAccept(), or the payload check or ingestDecode() after it.
+/// @return true if it ended a frame that should be shown: nothing in it
+/// went wrong, and every segment is known (so nothing is left over from
+/// before a reboot, or from packets lost before the first one we saw).
+bool ingestReceiverFinish(FastLedIngestReceiver* receiver, const FastLedIngestHeader* header, FastLedIngestResult result)
+    {
+    receiver->results[result]++;
+    if (result == INGEST_NEED_KEYFRAME)
+        {
+        receiver->bFrameBad = true;
+        }
+    else if (result != INGEST_OK)
+        {
+        ingestReceiverForget(receiver);
+        }
+    else if (header->encoding != INGEST_XOR && header->offset <= receiver->keyedUpTo[header->segment]
+             && header->offset + header->count > receiver->keyedUpTo[header->segment])
+        {
+        receiver->keyedUpTo[header->segment] = header->offset + header->count;
+        }
+    if (!(header->flags & INGEST_FLAG_END_OF_FRAME))
+        {
+        return(false);
+        }
+    bool bShow = !receiver->bFrameBad;
+    for (uint8_t segment = 0; segment < receiver->segmentCount; segment++)
+        {
+        if (receiver->keyedUpTo[segment] != receiver->lengths[segment])
+            {
+            bShow = false;
+            }
+        }
+    (bShow ? receiver->framesShown : receiver->framesDiscarded)++;
+    receiver->bFrameBad = false;
+    return(bShow);
+    }
+
+
+/// @brief Counts a packet whose header was no good (so nothing else can be told about it).
+void ingestReceiverReject(FastLedIngestReceiver* receiver, FastLedIngestResult result)
+    {
+    receiver->results[result]++;
+    ingestReceiverForget(receiver);
+    }
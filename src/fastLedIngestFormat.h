@@ -0,0 +1,118 @@
+#ifndef _FAST_LED_INGEST_FORMAT_H_
+#define _FAST_LED_INGEST_FORMAT_H_
+
+// Frames from a host, as packets of LEDs for one arena segment, shared by
+// the firmware (fastLedIngest.cpp, over the slave SPI pins) and the host
+// encoder (tools/ingest_encode.cpp), so no Arduino stuff in here.
+//
+// A packet is a 16 byte header and then its payload, each its own SPI
+// transaction (so each is framed by CS, and a packet that goes wrong can't
+// put the next one out of step).  The header, little endian:
+//      [magic 'L' 'F' : 2][encoding : 1][flags : 1][segment : 1][sequence : 1]
+//      [offset : 2][count : 2][payload bytes : 2][payload check : 2][0 : 1][header check : 1]
+// covers count LEDs of the segment from offset.  The header check is a CRC-8
+// of the 15 bytes before it, so the header can be trusted before the payload
+// comes; the payload check is a Fletcher-16.  The payload goes out padded to
+// a multiple of 4 bytes (the ESP32's slave DMA works in words).
+//
+// Payloads (LEDs are three bytes, r g b, as a CRGB):
+//   INGEST_RAW     count LEDs.
+//   INGEST_RLE     Runs: a byte n, then n + 1 (up to 128) LEDs if bit 7
+//                  is set (n is n & 0x7F), else one LED for n + 1 copies.
+//   INGEST_XOR     As RLE, but bit 7 set is n + 1 LEDs to XOR into what is
+//                  there, and clear is n + 1 LEDs left as they are.  What is
+//                  there is the frame before (see fastLedSwapBuffers()).
+//
+// A delta is only any good on top of the frame the host thinks is there.
+// So the receiver treats every segment as unknown until non-delta packets
+// have covered it from end to end.  It refuses deltas for a segment until
+// then, and forgets every segment after any error or missing packet (the
+// sequence goes up by one a packet).  The host sends a whole non-delta frame
+// every so often so it recovers.  A frame with anything wrong in it isn't
+// shown, and nor is any frame until every segment is known (packets lost
+// before the first one the receiver sees can't be counted as a gap).
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define INGEST_MAGIC_0              'L'
+#define INGEST_MAGIC_1              'F'
+#define INGEST_HEADER_BYTES         16
+#define INGEST_MAX_PAYLOAD_BYTES    1536    // 512 LEDs raw.
+#define INGEST_MAX_SEGMENTS         8
+#define INGEST_BYTES_PER_LED        3
+#define INGEST_MAX_RUN              128
+
+#define INGEST_FLAG_END_OF_FRAME    0x01    // Show the frame after this packet.
+
+typedef enum
+    {
+    INGEST_RAW = 0,
+    INGEST_RLE,
+    INGEST_XOR,
+    INGEST_ENCODINGS
+    } FastLedIngestEncoding;
+
+typedef enum
+    {
+    INGEST_OK = 0,
+    INGEST_BAD_MAGIC,       // Not a header (or the host is out of step).
+    INGEST_BAD_HEADER,      // Header check failed, or a field out of range.
+    INGEST_BAD_SEGMENT,     // No such segment, or past its end.
+    INGEST_BAD_PAYLOAD,     // Payload short, or its check failed.
+    INGEST_BAD_ENCODING,    // Payload doesn't come to exactly count LEDs.
+    INGEST_SEQUENCE_GAP,    // Packets went missing (counted, the packet itself may be fine).
+    INGEST_NEED_KEYFRAME,   // A delta for a segment we don't know.
+    INGEST_RESULTS
+    } FastLedIngestResult;
+
+typedef struct
+    {
+    uint8_t encoding;
+    uint8_t flags;
+    uint8_t segment;
+    uint8_t sequence;
+    uint16_t offset;        // In LEDs, into the segment.
+    uint16_t count;
+    uint16_t payloadBytes;
+    uint16_t payloadCheck;
+    } FastLedIngestHeader;
+
+// What the receiver knows, for one end of the link.
+typedef struct
+    {
+    uint16_t lengths[INGEST_MAX_SEGMENTS];
+    uint16_t keyedUpTo[INGEST_MAX_SEGMENTS];    // LEDs from 0 that a non-delta packet has set, length when known.
+    uint8_t segmentCount;
+    uint8_t nextSequence;
+    bool bStarted;          // Had a packet, so nextSequence means something.
+    bool bFrameBad;         // Something in this frame went wrong, don't show it.
+    uint32_t results[INGEST_RESULTS];   // Packets by how they went.
+    uint32_t framesShown;
+    uint32_t framesDiscarded;
+    } FastLedIngestReceiver;
+
+extern const char* const ingestResultNames[INGEST_RESULTS];
+
+extern uint16_t ingestPayloadCheck(const uint8_t* payload, size_t length);
+extern void ingestPackHeader(uint8_t* bytes, const FastLedIngestHeader* header);
+extern FastLedIngestResult ingestParseHeader(const uint8_t* bytes, FastLedIngestHeader* header);
+
+extern size_t ingestEncodeRaw(const uint8_t* leds, uint16_t count, uint8_t* payload, size_t maxBytes);
+extern size_t ingestEncodeRle(const uint8_t* leds, uint16_t count, uint8_t* payload, size_t maxBytes);
+extern size_t ingestEncodeXor(const uint8_t* leds, const uint8_t* before, uint16_t count, uint8_t* payload, size_t maxBytes);
+extern FastLedIngestResult ingestDecode(uint8_t encoding, const uint8_t* payload, uint16_t payloadBytes,
+                                        uint8_t* leds, uint16_t count);
+
+extern void ingestReceiverInit(FastLedIngestReceiver* receiver, const uint16_t* lengths, uint8_t segmentCount);
+extern FastLedIngestResult ingestReceiverAccept(FastLedIngestReceiver* receiver, const FastLedIngestHeader* header);
+extern bool ingestReceiverFinish(FastLedIngestReceiver* receiver, const FastLedIngestHeader* header, FastLedIngestResult result);
+extern void ingestReceiverReject(FastLedIngestReceiver* receiver, FastLedIngestResult result);
+
+/// @brief Payload bytes as sent, padded to whole words.
+static inline size_t ingestPaddedBytes(size_t payloadBytes)
+    {
+    return((payloadBytes + 3) & ~(size_t) 3);
+    }
+
+#endif /* _FAST_LED_INGEST_FORMAT_H_ */
@@ -0,0 +1,257 @@
+#include "displayFastLedCommon.h"
+#include "fastLedJamWatchdog.h"
+
+static portMUX_TYPE jamWatchdogMux = portMUX_INITIALIZER_UNLOCKED;
+// Two timers, used in turn by alternate shows.  Each one's argument is the
+// arm it was last started for, so a callback still running for the last
+// show (which esp_timer_stop() can't stop) knows it is stale.
+static esp_timer_handle_t jamTimers[2] = { NULL, NULL };
+static uint32_t timerArms[2] = {};
+static uint32_t armSequence = 0;
+static const FastLedJamStep* jamLadder = NULL;
+static uint8_t jamStepCount = 0;
+static uint32_t jamPeriodUs = 0;
+
+static bool bArmed = false;
+static bool bJammed = false;            // The show being watched has gone past its deadline.
+static uint64_t deadlineUs = 0;
+static uint32_t expectedUs = 0;
+static uint32_t showMarginUs = FASTLED_JAM_MAX_MARGIN_US;
+static uint8_t level = 0;               // Next step of the ladder.
+static uint8_t lastStep = 0;            // Last step taken.
+static uint8_t healthyShows = 0;
+
+// Smoothed overrun (x8) and mean deviation (x4), as TCP's srtt and rttvar.
+static int32_t overrunUs8 = 0;
+static int32_t deviationUs4 = 0;
+static uint32_t learnedShows = 0;
+
+static FastLedJamWatchdogStats jamStats = {};
+static FastLedJamEscalation history[FASTLED_JAM_HISTORY];
+static uint8_t historyHead = 0;
+static uint8_t historyCount = 0;
+
+static void jamWatchdogTimerCallback(void* arg);
+
+
+/// @brief Sets the escalation ladder and starts learning the margin from scratch.
+/// @param ladder Steps in order, the last one is repeated if we get that far.
+/// @param stepCount Up to FASTLED_JAM_MAX_STEPS.
+/// @param framePeriodUs What the steps' waits are counted in.
+void jamWatchdogInit(const FastLedJamStep* ladder, uint8_t stepCount, uint32_t framePeriodUs)
+    {
+    for (uint8_t timer = 0; timer < 2; timer++)
+        {
+        if (jamTimers[timer] == NULL)
+            {
+            esp_timer_create_args_t timerArgs;
+            memset(&timerArgs, 0, sizeof(timerArgs));
+            timerArgs.callback = jamWatchdogTimerCallback;
+            timerArgs.arg = &timerArms[timer];
+            timerArgs.dispatch_method = ESP_TIMER_TASK;
+            timerArgs.name = "jamWatchdog";
+            esp_timer_create(&timerArgs, &jamTimers[timer]);
+            }
+        }
+    portENTER_CRITICAL(&jamWatchdogMux);
+    jamLadder = ladder;
+    jamStepCount = (stepCount < FASTLED_JAM_MAX_STEPS) ? stepCount : FASTLED_JAM_MAX_STEPS;
+    jamPeriodUs = framePeriodUs;
+    bArmed = false;
+    level = 0;
+    healthyShows = 0;
+    learnedShows = 0;
+    showMarginUs = FASTLED_JAM_MAX_MARGIN_US;
+    memset(&jamStats, 0, sizeof(jamStats));
+    historyCount = 0;
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    }
+
+
+/// @brief How long after the deadline (or the last step) to wait for the next step.
+static uint32_t jamWatchdogWaitUs(void)
+    {
+    return((uint32_t) jamLadder[level].waitPeriods * jamPeriodUs);
+    }
+
+
+/// @brief Show task, just before the show: start the deadline.
+/// @param showExpectedUs Wire time of the longest controller being sent.
+void jamWatchdogArm(uint32_t showExpectedUs)
+    {
+    if (jamTimers[0] == NULL || jamStepCount == 0)
+        {
+        return;
+        }
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&jamWatchdogMux);
+    armSequence++;
+    uint8_t timer = armSequence & 1;
+    timerArms[timer] = armSequence;
+    expectedUs = showExpectedUs;
+    deadlineUs = nowUs + showExpectedUs + showMarginUs;
+    uint32_t timeoutUs = showExpectedUs + showMarginUs + jamWatchdogWaitUs();
+    bArmed = true;
+    bJammed = false;
+    jamStats.shows++;
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    esp_timer_stop(jamTimers[timer ^ 1]);   // In case the callback re-armed it as the last show returned.
+    esp_timer_stop(jamTimers[timer]);
+    esp_timer_start_once(jamTimers[timer], timeoutUs);
+    }
+
+
+/// @brief Show task, when the show has returned: stop the deadline and,
+/// if it was a clean show, learn from how long it took.
+/// @param startUs When the show started.
+/// @param endUs When it returned.
+/// @return The step that got it going if it jammed, otherwise -1.
+int8_t jamWatchdogDisarm(uint64_t startUs, uint64_t endUs)
+    {
+    if (jamTimers[0] == NULL || jamStepCount == 0)
+        {
+        return(-1);
+        }
+    int8_t recoveredAtStep = -1;
+    esp_timer_stop(jamTimers[armSequence & 1]);
+    portENTER_CRITICAL(&jamWatchdogMux);
+    bArmed = false;
+    if (bJammed)
+        {
+        recoveredAtStep = (int8_t) lastStep;
+        uint32_t jamUs = (endUs > deadlineUs) ? (uint32_t) (endUs - deadlineUs) : 0;
+        if (jamUs > jamStats.longestJamUs)
+            {
+            jamStats.longestJamUs = jamUs;
+            }
+        }
+    else
+        {
+        int32_t overrunUs = (int32_t) (endUs - startUs) - (int32_t) expectedUs;
+        if (overrunUs < 0)
+            {
+            overrunUs = 0;
+            }
+        if (learnedShows == 0)
+            {
+            overrunUs8 = overrunUs << 3;
+            deviationUs4 = overrunUs << 1;
+            }
+        else
+            {
+            int32_t errorUs = overrunUs - (overrunUs8 >> 3);
+            overrunUs8 += errorUs;
+            deviationUs4 += ((errorUs < 0) ? -errorUs : errorUs) - (deviationUs4 >> 2);
+            }
+        if (++learnedShows >= FASTLED_JAM_LEARN_SHOWS)
+            {
+            int32_t marginUs = (overrunUs8 >> 3) + deviationUs4;
+            showMarginUs = (marginUs < FASTLED_JAM_MIN_MARGIN_US) ? FASTLED_JAM_MIN_MARGIN_US :
+                           (marginUs > FASTLED_JAM_MAX_MARGIN_US) ? FASTLED_JAM_MAX_MARGIN_US : (uint32_t) marginUs;
+            }
+        if (healthyShows < FASTLED_JAM_HEALTHY_SHOWS && ++healthyShows == FASTLED_JAM_HEALTHY_SHOWS)
+            {
+            level = 0;
+            }
+        }
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    return(recoveredAtStep);
+    }
+
+
+/// @brief Stops watching the current show without learning from it, for
+/// when the show task is about to be deleted.  The ladder stays where it is,
+/// so if whatever replaces it jams too the next step is the one after.
+void jamWatchdogStop(void)
+    {
+    if (jamTimers[0] == NULL)
+        {
+        return;
+        }
+    portENTER_CRITICAL(&jamWatchdogMux);
+    bArmed = false;
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    esp_timer_stop(jamTimers[armSequence & 1]);
+    }
+
+
+/// @brief Loop: the oldest escalation not yet reported (and acted on, for
+/// the actions the timer can't do itself).
+/// @return false if there isn't one.
+bool jamWatchdogTakeEscalation(FastLedJamEscalation* escalation)
+    {
+    bool bHaveOne = false;
+    portENTER_CRITICAL(&jamWatchdogMux);
+    if (historyCount > 0)
+        {
+        *escalation = history[(historyHead + FASTLED_JAM_HISTORY - historyCount) % FASTLED_JAM_HISTORY];
+        historyCount--;
+        bHaveOne = true;
+        }
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    return(bHaveOne);
+    }
+
+
+void jamWatchdogGetStats(FastLedJamWatchdogStats* stats)
+    {
+    portENTER_CRITICAL(&jamWatchdogMux);
+    *stats = jamStats;
+    stats->marginUs = showMarginUs;
+    stats->step = level;
+    portEXIT_CRITICAL(&jamWatchdogMux);
+    }
+
+
+/// @brief esp_timer task (core 0): the show is past its deadline (or the
+/// last step didn't get it going).  Records the step, does it if it can
+/// be done from here, and arms the timer for the next one.
+/// @param arg The timer's entry in timerArms.
+static void jamWatchdogTimerCallback(void* arg)
+    {
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&jamWatchdogMux);
+    uint32_t arm = *(const uint32_t*) arg;
+    if (!bArmed || arm != armSequence)
+        {
+        portEXIT_CRITICAL(&jamWatchdogMux);
+        return;     // The show got there first (or this is the last show's timer).
+        }
+    FastLedJamEscalation* escalation = &history[historyHead];
+    escalation->atUs = nowUs;
+    escalation->overdueUs = (nowUs > deadlineUs) ? (uint32_t) (nowUs - deadlineUs) : 0;
+    escalation->marginUs = showMarginUs;
+    escalation->step = level;
+    lastStep = level;
+    escalation->action = jamLadder[level].action;
+    historyHead = (historyHead + 1) % FASTLED_JAM_HISTORY;
+    if (historyCount < FASTLED_JAM_HISTORY)
+        {
+        historyCount++;     // Otherwise the oldest one is lost.
+        }
+    FastLedJamAction action = jamLadder[level].action;
+    if (!bJammed)
+        {
+        bJammed = true;
+        jamStats.jams++;
+        }
+    jamStats.actions[action]++;
+    healthyShows = 0;
+    if (level + 1 < jamStepCount)
+        {
+        level++;
+        }
+    uint32_t timeoutUs = jamWatchdogWaitUs();
+    portEXIT_CRITICAL(&jamWatchdogMux);
+
+#if DEBUG_USE_PORT_MAX_DELAY_FOR_GTX_SEM
+    if (action == FASTLED_JAM_GIVE_GTX_SEM)
+        {
+        // FastLED.show() then returns and the show task disarms us.
+        // If it returned just before this, the give can at worst cut
+        // short the next show's wait, which is no worse than a jam.
+        GiveGTX_sem();
+        }
+#endif
+    esp_timer_start_once(jamTimers[arm & 1], (timeoutUs > jamPeriodUs) ? timeoutUs : jamPeriodUs);
+    }
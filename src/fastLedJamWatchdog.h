@@ -0,0 +1,73 @@
+#ifndef _FAST_LED_JAM_WATCHDOG_H_
+#define _FAST_LED_JAM_WATCHDOG_H_
+
+#include <Arduino.h>
+
+// Per-show jam detection.  We know how long a show should take (the wire
+// time of the longest controller being sent), so the show task arms an
+// esp_timer one-shot for that plus a margin before each show and stops it
+// when the show returns.  If it fires the show has jammed (the RMT "all done"
+// interrupt went missing) and the watchdog works down an escalation ladder:
+// each step has an action and how many frame periods to wait after the
+// deadline (or the step before) for it.  The ladder only goes back to the
+// first step after FASTLED_JAM_HEALTHY_SHOWS clean shows in a row, so a
+// peripheral that jams on every show still gets as far as the last step.
+//
+// The margin is learned from how far clean shows run over their wire time
+// (a smoothed mean plus four times the smoothed mean deviation, as TCP does
+// for its retransmit timeout), kept between FASTLED_JAM_MIN_MARGIN_US and
+// FASTLED_JAM_MAX_MARGIN_US.  Until FASTLED_JAM_LEARN_SHOWS have been seen
+// the maximum is used.
+//
+// Actions that can't be done from the esp_timer task (anything that blocks,
+// or restarts) are left for the loop to pick up with jamWatchdogTakeEscalation(),
+// which is also how every escalation gets reported.
+
+#define FASTLED_JAM_MIN_MARGIN_US   2000
+#define FASTLED_JAM_MAX_MARGIN_US   20000
+#define FASTLED_JAM_LEARN_SHOWS     16
+#define FASTLED_JAM_HEALTHY_SHOWS   16
+#define FASTLED_JAM_MAX_STEPS       8
+#define FASTLED_JAM_HISTORY         8       // Escalations waiting to be reported.
+
+typedef enum
+    {
+    FASTLED_JAM_GIVE_GTX_SEM = 0,   // GiveGTX_sem() (or just wait, if gTX_sem times out by itself).
+    FASTLED_JAM_RESTART,            // ESP.restart(), done by the loop.
+    FASTLED_JAM_WARM_RESTART,       // fastLedWarmRestart(), done by the loop (FASTLED_RMT_RESET).
+    FASTLED_JAM_ACTION_COUNT
+    } FastLedJamAction;
+
+typedef struct
+    {
+    FastLedJamAction action;
+    uint16_t waitPeriods;           // Frame periods after the deadline (or the step before).
+    } FastLedJamStep;
+
+typedef struct
+    {
+    uint64_t atUs;
+    uint32_t overdueUs;             // How long past the show's deadline.
+    uint32_t marginUs;              // The margin the show had.
+    uint8_t step;
+    FastLedJamAction action;
+    } FastLedJamEscalation;
+
+typedef struct
+    {
+    uint32_t shows;                 // Shows watched.
+    uint32_t jams;                  // Shows that went past their deadline.
+    uint32_t actions[FASTLED_JAM_ACTION_COUNT];
+    uint32_t marginUs;
+    uint32_t longestJamUs;          // Deadline to the show returning.
+    uint8_t step;                   // Next step of the ladder.
+    } FastLedJamWatchdogStats;
+
+extern void jamWatchdogInit(const FastLedJamStep* ladder, uint8_t stepCount, uint32_t framePeriodUs);
+extern void jamWatchdogArm(uint32_t expectedUs);
+extern int8_t jamWatchdogDisarm(uint64_t startUs, uint64_t endUs);
+extern void jamWatchdogStop(void);
+extern bool jamWatchdogTakeEscalation(FastLedJamEscalation* escalation);
+extern void jamWatchdogGetStats(FastLedJamWatchdogStats* stats);
+
+#endif /* _FAST_LED_JAM_WATCHDOG_H_ */
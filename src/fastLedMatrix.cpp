@@ -0,0 +1,185 @@
+#include "displayFastLedCommon.h"
+#include "fastLedMatrix.h"
+
+constexpr FastLedMatrixMap fastLedMatrixMap = fastLedMatrixBuildMap(FASTLED_MATRIX_LAYOUT);
+
+static_assert(fastLedMatrixMap.xy[0][FASTLED_MATRIX_WIDTH - 1] == FASTLED_MATRIX_WIDTH - 1, "first row");
+static_assert(fastLedMatrixMap.xy[1][0] == ((FASTLED_MATRIX_LAYOUT == FASTLED_MATRIX_SERPENTINE) ?
+                                            2 * FASTLED_MATRIX_WIDTH - 1 : FASTLED_MATRIX_WIDTH), "second row");
+static_assert(fastLedMatrixMap.xy[FASTLED_MATRIX_HEIGHT - 1][FASTLED_MATRIX_WIDTH - 1] ==
+              ((fastLedMatrixMap.rowReversed[FASTLED_MATRIX_HEIGHT - 1]) ? (FASTLED_MATRIX_HEIGHT - 1) * FASTLED_MATRIX_WIDTH :
+                                                                           FASTLED_MATRIX_HEIGHT * FASTLED_MATRIX_WIDTH - 1), "last row");
+
+#define FASTLED_MATRIX_LEDS (FASTLED_MATRIX_WIDTH * FASTLED_MATRIX_HEIGHT)
+
+
+/// @brief A matrix's LEDs in the back slot (which counts as writing to it).
+static CRGB* fastLedMatrixLeds(uint8_t matrix)
+    {
+    DEBUG_ASSERT(fastLedGetSegment(matrix) != NULL && fastLedGetSegment(matrix)->length == FASTLED_MATRIX_LEDS);
+    return(fastLedSegmentLeds(matrix));
+    }
+
+
+/// @brief The LEDs of pixels x to x + count - 1 of row y (all on the
+/// matrix), from the lowest, which is x + count - 1 if the row is reversed.
+static inline CRGB* fastLedMatrixRun(CRGB* leds, int16_t x, int16_t y, int16_t count)
+    {
+    return(leds + (fastLedMatrixMap.rowReversed[y] ? fastLedMatrixMap.rowStart[y] - (x + count - 1) :
+                                                     fastLedMatrixMap.rowStart[y] + x));
+    }
+
+
+/// @brief Copies a run of LEDs, back to front if bReverse.
+static inline void fastLedMatrixCopyRun(CRGB* to, const CRGB* from, int16_t count, bool bReverse)
+    {
+    if (!bReverse)
+        {
+        memcpy(to, from, count * sizeof(CRGB));
+        return;
+        }
+    for (int16_t i = 0; i < count; i++)
+        {
+        to[count - 1 - i] = from[i];
+        }
+    }
+
+
+/// @brief Clips count pixels from start to [0, limit).
+/// @param skipped Set to how many were cut off the front.
+/// @return false if there's nothing left.
+static bool fastLedMatrixClip(int16_t* start, int16_t* count, int16_t limit, int16_t* skipped)
+    {
+    *skipped = (*start < 0) ? -*start : 0;
+    *start += *skipped;
+    *count -= *skipped;
+    if (*start + *count > limit)
+        {
+        *count = limit - *start;
+        }
+    return(*count > 0);
+    }
+
+
+/// @brief One pixel, keeping the power budget up to date (as fastLedSetPixel()).
+void fastLedMatrixSet(uint8_t matrix, int16_t x, int16_t y, const CRGB& colour)
+    {
+    if (x >= 0 && x < FASTLED_MATRIX_WIDTH && y >= 0 && y < FASTLED_MATRIX_HEIGHT)
+        {
+        fastLedSetPixel(matrix, fastLedMatrixXY((uint8_t) x, (uint8_t) y), colour);
+        }
+    }
+
+
+/// @brief Fills a rectangle, a fill_solid() per row (or one for full width rows,
+/// which are one run of the strand whichever way they are wired).
+void fastLedMatrixFillRect(uint8_t matrix, int16_t x, int16_t y, int16_t width, int16_t height, const CRGB& colour)
+    {
+    int16_t skipped;
+    if (!fastLedMatrixClip(&x, &width, FASTLED_MATRIX_WIDTH, &skipped)
+        || !fastLedMatrixClip(&y, &height, FASTLED_MATRIX_HEIGHT, &skipped))
+        {
+        return;
+        }
+    CRGB* leds = fastLedMatrixLeds(matrix);
+    if (width == FASTLED_MATRIX_WIDTH)
+        {
+        fill_solid(leds + y * FASTLED_MATRIX_WIDTH, height * FASTLED_MATRIX_WIDTH, colour);
+        return;
+        }
+    for (int16_t row = y; row < y + height; row++)
+        {
+        fill_solid(fastLedMatrixRun(leds, x, row, width), width, colour);
+        }
+    }
+
+
+static void fastLedMatrixBlitRowTo(CRGB* leds, int16_t x, int16_t y, const CRGB* pixels, int16_t count)
+    {
+    int16_t skipped;
+    if (y < 0 || y >= FASTLED_MATRIX_HEIGHT || !fastLedMatrixClip(&x, &count, FASTLED_MATRIX_WIDTH, &skipped))
+        {
+        return;
+        }
+    fastLedMatrixCopyRun(fastLedMatrixRun(leds, x, y, count), pixels + skipped, count, fastLedMatrixMap.rowReversed[y]);
+    }
+
+
+/// @brief Copies count pixels (left to right) into row y from x.
+void fastLedMatrixBlitRow(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels, int16_t count)
+    {
+    fastLedMatrixBlitRowTo(fastLedMatrixLeds(matrix), x, y, pixels, count);
+    }
+
+
+/// @brief Copies an image (rows top to bottom, pixels left to right) with its top left at x, y.
+/// @param stride Pixels from one row of the image to the next (at least width).
+void fastLedMatrixBlit(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels,
+                       int16_t width, int16_t height, uint16_t stride)
+    {
+    CRGB* leds = fastLedMatrixLeds(matrix);
+    for (int16_t row = 0; row < height; row++)
+        {
+        fastLedMatrixBlitRowTo(leds, x, y + row, pixels + row * stride, width);
+        }
+    }
+
+
+/// @brief Copies count pixels (top to bottom) into column x from y.  A column
+/// isn't a run of the strand, so this is a table lookup per pixel.
+void fastLedMatrixBlitColumn(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels, int16_t count)
+    {
+    int16_t skipped;
+    if (x < 0 || x >= FASTLED_MATRIX_WIDTH || !fastLedMatrixClip(&y, &count, FASTLED_MATRIX_HEIGHT, &skipped))
+        {
+        return;
+        }
+    CRGB* leds = fastLedMatrixLeds(matrix);
+    pixels += skipped;
+    for (int16_t row = 0; row < count; row++)
+        {
+        leds[fastLedMatrixMap.xy[y + row][x]] = pixels[row];
+        }
+    }
+
+
+/// @brief Moves everything dx right and dy down (negative for left and up),
+/// filling in behind with fill.  Rows move with a memcpy() each (or a reversed
+/// copy, between rows wired opposite ways) and within a row with a memmove().
+void fastLedMatrixScroll(uint8_t matrix, int16_t dx, int16_t dy, const CRGB& fill)
+    {
+    CRGB* leds = fastLedMatrixLeds(matrix);
+    int16_t rowsMoved = (dy < 0) ? -dy : dy;
+    int16_t pixelsMoved = (dx < 0) ? -dx : dx;
+    if (rowsMoved >= FASTLED_MATRIX_HEIGHT || pixelsMoved >= FASTLED_MATRIX_WIDTH)
+        {
+        fill_solid(leds, FASTLED_MATRIX_LEDS, fill);
+        return;
+        }
+    if (rowsMoved > 0)
+        {
+        // In the order that never overwrites a row still to be moved.
+        for (int16_t i = 0; i < FASTLED_MATRIX_HEIGHT - rowsMoved; i++)
+            {
+            int16_t to = (dy > 0) ? FASTLED_MATRIX_HEIGHT - 1 - i : i;
+            int16_t from = to - dy;
+            fastLedMatrixCopyRun(leds + to * FASTLED_MATRIX_WIDTH, leds + from * FASTLED_MATRIX_WIDTH, FASTLED_MATRIX_WIDTH,
+                                 fastLedMatrixMap.rowReversed[to] != fastLedMatrixMap.rowReversed[from]);
+            }
+        int16_t firstEmpty = (dy > 0) ? 0 : FASTLED_MATRIX_HEIGHT - rowsMoved;
+        fill_solid(leds + firstEmpty * FASTLED_MATRIX_WIDTH, rowsMoved * FASTLED_MATRIX_WIDTH, fill);
+        }
+    if (pixelsMoved > 0)
+        {
+        // A run keeps its order along the strand whichever way the row goes.
+        int16_t kept = FASTLED_MATRIX_WIDTH - pixelsMoved;
+        int16_t keptTo = (dx > 0) ? dx : 0;
+        int16_t firstEmpty = (dx > 0) ? 0 : kept;
+        for (int16_t row = 0; row < FASTLED_MATRIX_HEIGHT; row++)
+            {
+            memmove(fastLedMatrixRun(leds, keptTo, row, kept), fastLedMatrixRun(leds, keptTo - dx, row, kept),
+                    kept * sizeof(CRGB));
+            fill_solid(fastLedMatrixRun(leds, firstEmpty, row, pixelsMoved), pixelsMoved, fill);
+            }
+        }
+    }
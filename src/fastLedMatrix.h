@@ -0,0 +1,69 @@
+#ifndef _FAST_LED_MATRIX_H_
+#define _FAST_LED_MATRIX_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+
+// The matrices (FASTLED_MATRIX_LEFT and FASTLED_MATRIX_RIGHT) as 2D displays.
+//
+// Each is a segment of the arena, wired a row at a time from the top left:
+// FASTLED_MATRIX_PROGRESSIVE has every row going left to right,
+// FASTLED_MATRIX_SERPENTINE has every other row coming back right to left.
+// The XY to LED table is worked out by the compiler, so a single pixel is
+// one lookup.  Everything else works on row spans: a run of a row is a run
+// of the strand either way round, so a fill is a fill_solid(), a scroll is a
+// memmove() and a blit is a memcpy() (or a reversed copy) per row, rather
+// than an XY() per pixel.
+//
+// x and y can be off the matrix (or partly), anything outside is clipped.
+// Like fastLedSegmentLeds() these write the back slot, so the power budget
+// sums a matrix again (and it counts as changed) after any but fastLedMatrixSet().
+
+#define FASTLED_MATRIX_WIDTH        47
+#define FASTLED_MATRIX_HEIGHT       10
+
+#define FASTLED_MATRIX_PROGRESSIVE  0
+#define FASTLED_MATRIX_SERPENTINE   1
+#define FASTLED_MATRIX_LAYOUT       FASTLED_MATRIX_SERPENTINE
+
+typedef struct
+    {
+    uint16_t xy[FASTLED_MATRIX_HEIGHT][FASTLED_MATRIX_WIDTH];   // LED of each pixel.
+    uint16_t rowStart[FASTLED_MATRIX_HEIGHT];                   // LED of x = 0.
+    bool rowReversed[FASTLED_MATRIX_HEIGHT];                    // x runs down the strand.
+    } FastLedMatrixMap;
+
+/// @brief The XY table for a layout, for the compiler to work out.
+constexpr FastLedMatrixMap fastLedMatrixBuildMap(uint8_t layout)
+    {
+    FastLedMatrixMap map = {};
+    for (uint8_t y = 0; y < FASTLED_MATRIX_HEIGHT; y++)
+        {
+        bool bReversed = (layout == FASTLED_MATRIX_SERPENTINE) && (y & 1);
+        map.rowReversed[y] = bReversed;
+        map.rowStart[y] = (uint16_t) (y * FASTLED_MATRIX_WIDTH + (bReversed ? FASTLED_MATRIX_WIDTH - 1 : 0));
+        for (uint8_t x = 0; x < FASTLED_MATRIX_WIDTH; x++)
+            {
+            map.xy[y][x] = (uint16_t) (bReversed ? map.rowStart[y] - x : map.rowStart[y] + x);
+            }
+        }
+    return(map);
+    }
+
+extern const FastLedMatrixMap fastLedMatrixMap;
+
+/// @brief LED index in the matrix's segment of pixel x, y (both on the matrix).
+static inline uint16_t fastLedMatrixXY(uint8_t x, uint8_t y)
+    {
+    return(fastLedMatrixMap.xy[y][x]);
+    }
+
+extern void fastLedMatrixSet(uint8_t matrix, int16_t x, int16_t y, const CRGB& colour);
+extern void fastLedMatrixFillRect(uint8_t matrix, int16_t x, int16_t y, int16_t width, int16_t height, const CRGB& colour);
+extern void fastLedMatrixBlitRow(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels, int16_t count);
+extern void fastLedMatrixBlit(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels,
+                              int16_t width, int16_t height, uint16_t stride);
+extern void fastLedMatrixBlitColumn(uint8_t matrix, int16_t x, int16_t y, const CRGB* pixels, int16_t count);
+extern void fastLedMatrixScroll(uint8_t matrix, int16_t dx, int16_t dy, const CRGB& fill);
+
+#endif /* _FAST_LED_MATRIX_H_ */
@@ -0,0 +1,99 @@
+#include "fastLedOutputPlanner.h"
+
+
+/// @brief How many pins a greedy fill needs if no pin may have more than
+/// capacity LEDs.  (Every segment must fit, i.e. capacity >= the longest.)
+static uint16_t fastLedPinsNeeded(const uint16_t* segmentLengths, uint16_t segmentCount, uint32_t capacity)
+    {
+    uint16_t pins = 1;
+    uint32_t onPin = 0;
+    for (uint16_t i = 0; i < segmentCount; i++)
+        {
+        if (onPin + segmentLengths[i] > capacity)
+            {
+            pins++;
+            onPin = 0;
+            }
+        onPin += segmentLengths[i];
+        }
+    return(pins);
+    }
+
+
+/// @brief Plans which segments go on which pin, minimising the longest pin.
+/// Binary searches the smallest per pin capacity that a greedy fill can
+/// manage with pinCount pins, then fills to that capacity.  That's optimal
+/// for contiguous runs and is O(segments x log(LEDs)), fine for setup().
+/// @param segmentLengths LEDs in each segment, in layout order.
+/// @param segmentCount Number of segments.
+/// @param pinCount Pins available (plan must have room for this many).
+/// @param plan Filled in, one entry per pin used.
+/// @return Pins used, which may be fewer than pinCount if there are few
+/// segments or one dominates.  0 if there is nothing to plan.
+uint8_t fastLedPlanOutputs(const uint16_t* segmentLengths, uint16_t segmentCount,
+                           uint8_t pinCount, FastLedPinPlan* plan)
+    {
+    if (segmentCount == 0 || pinCount == 0)
+        {
+        return(0);
+        }
+    uint32_t low = 0;
+    uint32_t high = 0;
+    for (uint16_t i = 0; i < segmentCount; i++)
+        {
+        if (segmentLengths[i] > low)
+            {
+            low = segmentLengths[i];
+            }
+        high += segmentLengths[i];
+        }
+    while (low < high)
+        {
+        uint32_t capacity = low + (high - low) / 2;
+        if (fastLedPinsNeeded(segmentLengths, segmentCount, capacity) <= pinCount)
+            {
+            high = capacity;
+            }
+        else
+            {
+            low = capacity + 1;
+            }
+        }
+
+    uint8_t pin = 0;
+    uint32_t ledOffset = 0;
+    plan[0].firstSegment = 0;
+    plan[0].segmentCount = 0;
+    plan[0].ledOffset = 0;
+    plan[0].ledCount = 0;
+    for (uint16_t i = 0; i < segmentCount; i++)
+        {
+        if (plan[pin].ledCount + segmentLengths[i] > low)
+            {
+            pin++;
+            plan[pin].firstSegment = i;
+            plan[pin].segmentCount = 0;
+            plan[pin].ledOffset = (uint16_t) ledOffset;
+            plan[pin].ledCount = 0;
+            }
+        plan[pin].segmentCount++;
+        plan[pin].ledCount += segmentLengths[i];
+        ledOffset += segmentLengths[i];
+        }
+    return(pin + 1);
+    }
+
+
+/// @brief The longest pin in a plan, which sets the wire time of a show.
+uint16_t fastLedPlanLongestPin(const FastLedPinPlan* plan, uint8_t pinsUsed)
+    {
+    uint16_t longest = 0;
+    for (uint8_t pin = 0; pin < pinsUsed; pin++)
+        {
+        if (plan[pin].ledCount > longest)
+            {
+            longest = plan[pin].ledCount;
+            }
+        }
+    return(longest);
+    }
@@ -0,0 +1,32 @@
+#ifndef _FAST_LED_OUTPUT_PLANNER_H_
+#define _FAST_LED_OUTPUT_PLANNER_H_
+
+// Splits a logical LED layout across output pins so the longest pin is as
+// short as possible.  All the pins send in parallel, so one show takes the
+// wire time of the longest pin: four pins of 256, 256, 470 and 470 LEDs take
+// as long as four of 470, while the same 1452 LEDs balanced over 8 pins is
+// ~182 LEDs (5.5ms rather than 14.2ms).
+//
+// The layout is an ordered list of segments, runs of LEDs that must stay on
+// one pin (a matrix row, a strip between connectors, or a single LED if it
+// can be cut anywhere).  Segments keep their order and each pin gets a
+// contiguous run of them, so a pin's LEDs are a contiguous slice of one
+// logical CRGB buffer and the controllers can point straight into it.
+//
+// No Arduino stuff in here so it can be run on the host.
+
+#include <stdint.h>
+
+typedef struct
+    {
+    uint16_t firstSegment;
+    uint16_t segmentCount;
+    uint16_t ledOffset;     // From the start of the logical layout.
+    uint16_t ledCount;
+    } FastLedPinPlan;
+
+extern uint8_t fastLedPlanOutputs(const uint16_t* segmentLengths, uint16_t segmentCount,
+                                  uint8_t pinCount, FastLedPinPlan* plan);
+extern uint16_t fastLedPlanLongestPin(const FastLedPinPlan* plan, uint8_t pinsUsed);
+
+#endif /* _FAST_LED_OUTPUT_PLANNER_H_ */
@@ -0,0 +1,142 @@
+#include "fastLedOutputStage.h"
+#include "fastLedShowScheduler.h"
+#include "fastLedStats.h"
+#include "task_stats.h"
+
+static TaskHandle_t stageTask = NULL;
+static FastLedStageFunction stageFrame = NULL;
+
+static CRGB wireLeds[FASTLED_OUTPUT_STAGE_BUFFERS][FASTLED_OUTPUT_STAGE_LEDS];
+static uint16_t wireLedsUsed = 0;
+
+static uint8_t stageTables[3][256];
+static bool bTablesBuilt = false;
+static uint8_t tableScale = 0;
+static CRGB tableCorrection(0, 0, 0);
+
+static FastLedOutputStageStats stageStats = {};
+
+static void outputStageTask(void* param);
+
+
+/// @brief Starts the output stage task on core 0 (once, a warm restart leaves it be).
+/// @param stageFunction Does the staging (tables and apply) for a frame slot.
+/// @return The task, for showSchedulerSetStage().
+TaskHandle_t outputStageInit(FastLedStageFunction stageFunction)
+    {
+    stageFrame = stageFunction;
+    if (stageTask == NULL)
+        {
+        static StackType_t stageTaskStack[FASTLED_OUTPUT_STAGE_STACK_BYTES];
+        static StaticTask_t stageTaskBuffer;
+        stageTask = xTaskCreateStaticPinnedToCore(
+            outputStageTask,
+            "outputStageTask",
+            FASTLED_OUTPUT_STAGE_STACK_BYTES,
+            NULL,
+            FASTLED_OUTPUT_STAGE_PRIORITY,
+            stageTaskStack,
+            &stageTaskBuffer,
+            FASTLED_OUTPUT_STAGE_CORE);
+        taskStatsRegister(stageTask, "outputStageTask", FASTLED_OUTPUT_STAGE_STACK_BYTES, true);
+        }
+    return(stageTask);
+    }
+
+
+/// @brief A controller's slice of each wire buffer.  Slices are handed out
+/// in order, so adding the same controllers again after outputStageFreeAll()
+/// gets the same ones back.
+/// @param wires Set to the slice in each of the FASTLED_OUTPUT_STAGE_BUFFERS.
+/// @return false if there isn't room.
+bool outputStageAllocate(uint16_t size, CRGB** wires)
+    {
+    if (size > FASTLED_OUTPUT_STAGE_LEDS - wireLedsUsed)
+        {
+        return(false);
+        }
+    for (uint8_t buffer = 0; buffer < FASTLED_OUTPUT_STAGE_BUFFERS; buffer++)
+        {
+        wires[buffer] = wireLeds[buffer] + wireLedsUsed;
+        }
+    wireLedsUsed += size;
+    return(true);
+    }
+
+
+void outputStageFreeAll(void)
+    {
+    wireLedsUsed = 0;
+    }
+
+
+/// @brief Rebuilds the tables if the scale or correction have changed.
+/// Each entry is what FastLED would send for that byte: the correction
+/// and scale make a per colour adjustment (as CLEDController::computeAdjustment()
+/// does with no colour temperature), which then scales the byte.
+/// @param scale Brightness with the power limit already applied.
+void outputStageSetLevels(uint8_t scale, const CRGB& correction)
+    {
+    if (bTablesBuilt && scale == tableScale && correction == tableCorrection)
+        {
+        return;
+        }
+    for (uint8_t colour = 0; colour < 3; colour++)
+        {
+        uint8_t adjustment = (scale > 0 && correction[colour] > 0) ? 
+                             (uint8_t) ((((uint32_t) correction[colour] + 1) * scale) >> 8) : 0;
+        uint8_t* table = stageTables[colour];
+        for (uint16_t value = 0; value < 256; value++)
+            {
+            table[value] = scale8((uint8_t) value, adjustment);
+            }
+        }
+    tableScale = scale;
+    tableCorrection = correction;
+    bTablesBuilt = true;
+    stageStats.tableBuilds++;
+    }
+
+
+/// @brief Runs some LEDs through the tables into the wire buffer.
+void outputStageApply(const CRGB* leds, CRGB* wire, uint16_t count)
+    {
+    const uint8_t* red = stageTables[0];
+    const uint8_t* green = stageTables[1];
+    const uint8_t* blue = stageTables[2];
+    for (uint16_t i = 0; i < count; i++)
+        {
+        wire[i].r = red[leds[i].r];
+        wire[i].g = green[leds[i].g];
+        wire[i].b = blue[leds[i].b];
+        }
+    }
+
+
+void outputStageGetStats(FastLedOutputStageStats* stats)
+    {
+    *stats = stageStats;
+    stats->scale = tableScale;
+    }
+
+
+/// @brief Output stage task (core 0).  Woken by the scheduler for each
+/// frame to stage, stages it and hands it back.
+static void outputStageTask(void* param)
+    {
+    (void) param;
+    while (true)
+        {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int8_t slot = showSchedulerStagingSlot();
+        if (slot < 0)
+            {
+            continue;   // A warm restart has been since.
+            }
+        uint64_t startUs = esp_timer_get_time();
+        stageFrame((uint8_t) slot, showSchedulerStagingWire());
+        stageStats.framesStaged++;
+        fastLedStatsRecord(FASTLED_HIST_STAGE, (uint32_t) (esp_timer_get_time() - startUs));
+        showSchedulerEndStaging();
+        }
+    }
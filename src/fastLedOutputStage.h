@@ -0,0 +1,48 @@
+#ifndef _FAST_LED_OUTPUT_STAGE_H_
+#define _FAST_LED_OUTPUT_STAGE_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+
+// Output stage, used when FASTLED_OUTPUT_STAGE is true.
+//
+// FastLED applies the colour correction, the brightness and the power limit
+// scale to every byte inside FastLED.show(), which is on core 1 while the
+// frame is going out.  Instead, when a frame is submitted the scheduler
+// hands it to a task on core 0 which runs it through three 256 entry tables
+// (one per colour, with all three folded in) into a wire buffer.  The
+// controllers point at the wire buffer, with no correction and brightness
+// 255, which FastLED's scaling passes straight through, so all the show
+// does is send bytes that are already done.
+//
+// There are two wire buffers (FASTLED_OUTPUT_STAGE_BUFFERS), so a frame can
+// be staged into one while the frame before it goes out of the other, and
+// staging only holds up a show when the queue was empty until just before it.
+// The tables are only rebuilt when the scale or the correction change, so
+// on most frames staging is just the lookups.  The scheduler doesn't drop
+// the frame (or let the show task have it) until staging is done.
+// It doesn't dither, so it wants DISABLE_DITHER, which is what we use anyway.
+
+#define FASTLED_OUTPUT_STAGE_LEDS           1536    // Each wire buffer, room for every controller's LEDs (the demo has 1452).
+#define FASTLED_OUTPUT_STAGE_CORE           0
+#define FASTLED_OUTPUT_STAGE_PRIORITY       (tskIDLE_PRIORITY + 2)
+#define FASTLED_OUTPUT_STAGE_STACK_BYTES    6144    // The simulation's peak is about 4.8 KB.
+
+// Stages the frame in a slot (the oldest queued) into a wire buffer, from the output stage task.
+typedef void (*FastLedStageFunction)(uint8_t slot, uint8_t wireBuffer);
+
+typedef struct
+    {
+    uint32_t framesStaged;
+    uint32_t tableBuilds;
+    uint8_t scale;              // The tables' brightness (with the power limit).
+    } FastLedOutputStageStats;
+
+extern TaskHandle_t outputStageInit(FastLedStageFunction stageFunction);
+extern bool outputStageAllocate(uint16_t size, CRGB** wires);
+extern void outputStageFreeAll(void);
+extern void outputStageSetLevels(uint8_t scale, const CRGB& correction);
+extern void outputStageApply(const CRGB* leds, CRGB* wire, uint16_t count);
+extern void outputStageGetStats(FastLedOutputStageStats* stats);
+
+#endif /* _FAST_LED_OUTPUT_STAGE_H_ */
@@ -0,0 +1,94 @@
+#include "displayFastLedCommon.h"
+#include "fastLedPowerBudget.h"
+
+FastLedPowerStats fastLedPowerStats = {};
+
+
+/// @brief Sets the segments up, all dirty (so the first total sums them).
+/// @param offsets Where each segment starts in the arena half, in LEDs.
+void powerLedgerInit(FastLedPowerLedger* ledger, const uint16_t* offsets, const uint16_t* lengths, uint8_t segmentCount)
+    {
+    memset(ledger, 0, sizeof(*ledger));
+    ledger->segmentCount = (segmentCount < FASTLED_POWER_MAX_SEGMENTS) ? segmentCount : FASTLED_POWER_MAX_SEGMENTS;
+    for (uint8_t segment = 0; segment < ledger->segmentCount; segment++)
+        {
+        ledger->segments[segment].offset = offsets[segment];
+        ledger->segments[segment].length = lengths[segment];
+        ledger->segments[segment].bDirty = true;
+        }
+    }
+
+
+/// @brief The whole segment is now colour.
+void powerLedgerFill(FastLedPowerLedger* ledger, uint8_t segment, const CRGB& colour)
+    {
+    FastLedPowerSegment* totals = &ledger->segments[segment];
+    totals->red = (uint32_t) colour.r * totals->length;
+    totals->green = (uint32_t) colour.g * totals->length;
+    totals->blue = (uint32_t) colour.b * totals->length;
+    totals->bDirty = false;
+    fastLedPowerStats.fills++;
+    }
+
+
+void powerLedgerMarkDirty(FastLedPowerLedger* ledger, uint8_t segment)
+    {
+    ledger->segments[segment].bDirty = true;
+    }
+
+
+void powerLedgerMarkAllDirty(FastLedPowerLedger* ledger)
+    {
+    for (uint8_t segment = 0; segment < ledger->segmentCount; segment++)
+        {
+        ledger->segments[segment].bDirty = true;
+        }
+    }
+
+
+/// @brief Unscaled power of every segment (summing the dirty ones again first).
+/// @param leds The arena half the ledger is for.
+/// @return Milliwatts, not counting the Esp32.
+uint32_t powerLedgerMw(FastLedPowerLedger* ledger, const CRGB* leds)
+    {
+    uint32_t totalMw = 0;
+    for (uint8_t segment = 0; segment < ledger->segmentCount; segment++)
+        {
+        FastLedPowerSegment* totals = &ledger->segments[segment];
+        if (totals->bDirty)
+            {
+            uint32_t red = 0;
+            uint32_t green = 0;
+            uint32_t blue = 0;
+            const CRGB* led = leds + totals->offset;
+            for (uint16_t i = 0; i < totals->length; i++)
+                {
+                red += led[i].r;
+                green += led[i].g;
+                blue += led[i].b;
+                }
+            totals->red = red;
+            totals->green = green;
+            totals->blue = blue;
+            totals->bDirty = false;
+            fastLedPowerStats.recomputes++;
+            }
+        // Rounded per segment as FastLED rounds per controller.
+        totalMw += ((totals->red * FASTLED_POWER_RED_MW) >> 8) + ((totals->green * FASTLED_POWER_GREEN_MW) >> 8)
+                 + ((totals->blue * FASTLED_POWER_BLUE_MW) >> 8) + (uint32_t) totals->length * FASTLED_POWER_DARK_MW;
+        }
+    return(totalMw);
+    }
+
+
+/// @brief As calculate_max_brightness_for_power_mW(), from a total we already have.
+/// @param ledsMw From powerLedgerMw() (the Esp32 is added here).
+uint8_t powerLimitScale(uint32_t ledsMw, uint8_t brightness, uint32_t maxMw)
+    {
+    uint32_t requestedMw = ((ledsMw + FASTLED_POWER_MCU_MW) * brightness) / 256;
+    if (requestedMw <= maxMw)
+        {
+        return(brightness);
+        }
+    return((uint8_t) (((uint32_t) brightness * maxMw) / requestedMw));
+    }
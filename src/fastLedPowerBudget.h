@@ -0,0 +1,73 @@
+#ifndef _FAST_LED_POWER_BUDGET_H_
+#define _FAST_LED_POWER_BUDGET_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+
+// Running power totals for the LED arena, so the power limit scale is known
+// when a frame is submitted without walking every LED.
+//
+// A ledger (one per arena half) keeps the red, green and blue sums of each
+// segment.  Single pixel writes (fastLedSetPixel()) adjust them by the
+// difference, a fill sets them outright, and anything that hands out a
+// pointer or changes LEDs wholesale (scale, copy, the random paint) marks
+// the segment dirty so it is summed again the next time the total is asked
+// for.  The power model is FastLED's (power_mgt.cpp), worked out per
+// segment just as calculate_unscaled_power_mW() does per controller, so the
+// scale comes out the same as calculate_max_brightness_for_power_mW().
+
+#define FASTLED_POWER_MAX_SEGMENTS  8
+
+// FastLED's power model, milliwatts at 5V for a channel at 255 (and an LED
+// that is off), and for the Esp32 itself.
+#define FASTLED_POWER_RED_MW        (16 * 5)
+#define FASTLED_POWER_GREEN_MW      (11 * 5)
+#define FASTLED_POWER_BLUE_MW       (15 * 5)
+#define FASTLED_POWER_DARK_MW       (1 * 5)
+#define FASTLED_POWER_MCU_MW        (25 * 5)
+
+typedef struct
+    {
+    uint32_t red;               // Sum of the segment's red bytes.
+    uint32_t green;
+    uint32_t blue;
+    uint16_t offset;            // Into the arena half, in LEDs.
+    uint16_t length;
+    bool bDirty;                // Sums out of date, recompute before use.
+    } FastLedPowerSegment;
+
+typedef struct
+    {
+    FastLedPowerSegment segments[FASTLED_POWER_MAX_SEGMENTS];
+    uint8_t segmentCount;
+    } FastLedPowerLedger;
+
+typedef struct
+    {
+    uint32_t pixelUpdates;      // Incremental (single pixel) updates.
+    uint32_t fills;             // Segments set by a fill.
+    uint32_t recomputes;        // Segments summed again.
+    uint32_t frameMw;           // The last frame submitted, before the limit.
+    uint8_t scale;              // Its brightness with the limit applied.
+    } FastLedPowerStats;
+
+extern FastLedPowerStats fastLedPowerStats;
+
+/// @brief A pixel is about to change from was to now.
+static inline void powerLedgerSetPixel(FastLedPowerLedger* ledger, uint8_t segment, const CRGB& was, const CRGB& now)
+    {
+    FastLedPowerSegment* totals = &ledger->segments[segment];
+    totals->red += (uint32_t) now.r - was.r;
+    totals->green += (uint32_t) now.g - was.g;
+    totals->blue += (uint32_t) now.b - was.b;
+    fastLedPowerStats.pixelUpdates++;
+    }
+
+extern void powerLedgerInit(FastLedPowerLedger* ledger, const uint16_t* offsets, const uint16_t* lengths, uint8_t segmentCount);
+extern void powerLedgerFill(FastLedPowerLedger* ledger, uint8_t segment, const CRGB& colour);
+extern void powerLedgerMarkDirty(FastLedPowerLedger* ledger, uint8_t segment);
+extern void powerLedgerMarkAllDirty(FastLedPowerLedger* ledger);
+extern uint32_t powerLedgerMw(FastLedPowerLedger* ledger, const CRGB* leds);
+extern uint8_t powerLimitScale(uint32_t ledsMw, uint8_t brightness, uint32_t maxMw);
+
+#endif /* _FAST_LED_POWER_BUDGET_H_ */
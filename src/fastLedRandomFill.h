@@ -0,0 +1,66 @@
+#ifndef _FAST_LED_RANDOM_FILL_H_
+#define _FAST_LED_RANDOM_FILL_H_
+
+// Bulk random fill for the stress load in paint_random_leds().
+// random8() is one PRNG step per byte (three per LED), this is one xorshift32
+// step per 32 bit word, written a whole word at a time.  Seeded, so a run
+// paints the same frames every time.  No Arduino stuff in here so it can be
+// run (and benchmarked) on the host.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FASTLED_RANDOM_DEFAULT_SEED 0x2545F491UL
+
+typedef struct
+    {
+    uint32_t state;
+    } FastLedRandom;
+
+
+/// @brief Seeds the generator.  xorshift gets stuck on 0, so 0 gets the default seed.
+static inline void fastLedRandomSeed(FastLedRandom* random, uint32_t seed)
+    {
+    random->state = (seed != 0) ? seed : FASTLED_RANDOM_DEFAULT_SEED;
+    }
+
+/// @brief Marsaglia's xorshift32, a period of 2^32 - 1 for three shifts and three xors.
+static inline uint32_t fastLedRandomNext(FastLedRandom* random)
+    {
+    uint32_t x = random->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    random->state = x;
+    return(x);
+    }
+
+/// @brief Fills count bytes (e.g. a CRGB buffer cast to uint8_t*) with random data.
+/// Any bytes before the first word boundary, and after the last, are done
+/// one at a time from a word of their own; the rest are whole aligned words.
+static inline void fastLedRandomFill(FastLedRandom* random, uint8_t* bytes, size_t count)
+    {
+    while (count > 0 && ((uintptr_t) bytes & 3) != 0)
+        {
+        *bytes++ = (uint8_t) fastLedRandomNext(random);
+        count--;
+        }
+    uint32_t* words = (uint32_t*) bytes;
+    for (size_t i = count / 4; i > 0; i--)
+        {
+        *words++ = fastLedRandomNext(random);
+        }
+    bytes = (uint8_t*) words;
+    count &= 3;
+    if (count > 0)
+        {
+        uint32_t word = fastLedRandomNext(random);
+        while (count-- > 0)
+            {
+            *bytes++ = (uint8_t) word;
+            word >>= 8;
+            }
+        }
+    }
+
+#endif /* _FAST_LED_RANDOM_FILL_H_ */
@@ -0,0 +1,208 @@
+#include "displayFastLedCommon.h"
+#include "fastLedFrameGovernor.h"
+#include "fastLedScrollText.h"
+
+#define FASTLED_TEXT_FIRST_CHAR     ' '
+#define FASTLED_TEXT_LAST_CHAR      '~'
+#define FASTLED_TEXT_UNKNOWN_CHAR   '?'
+
+// The classic 5x7 font, a byte per column (left to right) with bit 0 at the top.
+static const uint8_t fastLedTextFont[FASTLED_TEXT_LAST_CHAR - FASTLED_TEXT_FIRST_CHAR + 1][FASTLED_TEXT_FONT_WIDTH] =
+    {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 },     // ' ' !
+    { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },     // " #
+    { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },     // $ %
+    { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 },     // & '
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 },     // ( )
+    { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },     // * +
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 },     // , -
+    { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },     // . /
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 },     // 0 1
+    { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 },     // 2 3
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 },     // 4 5
+    { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },     // 6 7
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E },     // 8 9
+    { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 },     // : ;
+    { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },     // < =
+    { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 },     // > ?
+    { 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E },     // @ A
+    { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },     // B C
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 },     // D E
+    { 0x7F, 0x09, 0x09, 0x01, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x32 },     // F G
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 },     // H I
+    { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },     // J K
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x04, 0x02, 0x7F },     // L M
+    { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },     // N O
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E },     // P Q
+    { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 },     // R S
+    { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F },     // T U
+    { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x7F, 0x20, 0x18, 0x20, 0x7F },     // V W
+    { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 },     // X Y
+    { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },     // Z [
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 },     // \ ]
+    { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },     // ^ _
+    { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },     // ` a
+    { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 },     // b c
+    { 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 },     // d e
+    { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x08, 0x14, 0x54, 0x54, 0x3C },     // f g
+    { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 },     // h i
+    { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x00, 0x7F, 0x10, 0x28, 0x44 },     // j k
+    { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 },     // l m
+    { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },     // n o
+    { 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C },     // p q
+    { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },     // r s
+    { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C },     // t u
+    { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },     // v w
+    { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C },     // x y
+    { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },     // z {
+    { 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 },     // | }
+    { 0x08, 0x04, 0x08, 0x10, 0x08 }                                        // ~
+    };
+
+
+/// @brief The count that steps go by, the matrix's group's shows (or renders).
+static uint32_t fastLedTextShows(FastLedScrollText* text)
+    {
+#if FASTLED_STUTTER_REDUCTION
+    return(frameGovernorGroupShows(fastLedGetOutput(fastLedGetSegment(text->matrix)->controller)->group));
+#else
+    return(text->renders);
+#endif
+    }
+
+
+/// @brief Rasterises a character into a glyph cache slot, spacing column and all.
+static void fastLedTextRasterise(FastLedScrollText* text, uint8_t slot, char character, const CRGB& colour)
+    {
+    const uint8_t* font = fastLedTextFont[character - FASTLED_TEXT_FIRST_CHAR];
+    CRGB (*columns)[FASTLED_MATRIX_HEIGHT] = &text->glyphColumns[slot * FASTLED_TEXT_GLYPH_COLUMNS];
+    for (uint8_t column = 0; column < FASTLED_TEXT_GLYPH_COLUMNS; column++)
+        {
+        uint8_t bits = (column < FASTLED_TEXT_FONT_WIDTH) ? font[column] : 0;
+        for (uint8_t row = 0; row < FASTLED_MATRIX_HEIGHT; row++)
+            {
+            bool bLit = row >= FASTLED_TEXT_TOP && row < FASTLED_TEXT_TOP + FASTLED_TEXT_FONT_HEIGHT
+                        && (bits & (1 << (row - FASTLED_TEXT_TOP)));
+            columns[column][row] = bLit ? colour : text->background;
+            }
+        }
+    }
+
+
+/// @brief The pixels (top to bottom) of a column of the text and the gap after it.
+static const CRGB* fastLedTextColumn(const FastLedScrollText* text, uint16_t column)
+    {
+    if (column >= text->textColumns)
+        {
+        return(text->blankColumn);
+        }
+    uint8_t slot = text->glyphs[column / FASTLED_TEXT_GLYPH_COLUMNS];
+    return(text->glyphColumns[slot * FASTLED_TEXT_GLYPH_COLUMNS + column % FASTLED_TEXT_GLYPH_COLUMNS]);
+    }
+
+
+/// @brief Sets the text to scroll, rasterising its characters into the glyph
+/// cache.  It comes in from the right at the next step, which draws the whole matrix.
+/// @param string ASCII, anything else shows as '?'.
+/// @param framesPerColumn Shows of the matrix for each column it moves.
+/// @return false (and a blank matrix) if it has more than FASTLED_TEXT_MAX_CHARS
+/// characters or FASTLED_TEXT_MAX_GLYPHS different ones.
+bool fastLedTextInit(FastLedScrollText* text, uint8_t matrix, const char* string,
+                     const CRGB& colour, const CRGB& background, uint8_t framesPerColumn)
+    {
+    DEBUG_ASSERT(fastLedGetSegment(matrix) != NULL);
+    text->matrix = matrix;
+    text->background = background;
+    text->framesPerColumn = (framesPerColumn > 0) ? framesPerColumn : 1;
+    text->textColumns = 0;
+    text->nextColumn = 0;
+    text->renders = 0;
+    text->steppedAt = fastLedTextShows(text);
+    text->bRedraw = true;
+    fill_solid(text->blankColumn, FASTLED_MATRIX_HEIGHT, background);
+
+    char cached[FASTLED_TEXT_MAX_GLYPHS];
+    uint8_t glyphCount = 0;
+    uint16_t length = 0;
+    for (; string[length] != '\0'; length++)
+        {
+        if (length >= FASTLED_TEXT_MAX_CHARS)
+            {
+            return(false);
+            }
+        char character = string[length];
+        if (character < FASTLED_TEXT_FIRST_CHAR || character > FASTLED_TEXT_LAST_CHAR)
+            {
+            character = FASTLED_TEXT_UNKNOWN_CHAR;
+            }
+        uint8_t slot = 0;
+        while (slot < glyphCount && cached[slot] != character)
+            {
+            slot++;
+            }
+        if (slot == glyphCount)
+            {
+            if (glyphCount == FASTLED_TEXT_MAX_GLYPHS)
+                {
+                return(false);
+                }
+            cached[glyphCount++] = character;
+            fastLedTextRasterise(text, slot, character, colour);
+            }
+        text->glyphs[length] = slot;
+        }
+    text->textColumns = length * FASTLED_TEXT_GLYPH_COLUMNS;
+    return(true);
+    }
+
+
+/// @brief Moves the text columns to the left.  The matrix is scrolled and
+/// just the columns that come in are drawn, unless it needs drawing afresh
+/// (or it moves the whole width).
+void fastLedTextStep(FastLedScrollText* text, uint16_t columns)
+    {
+    uint16_t streamColumns = text->textColumns + FASTLED_MATRIX_WIDTH;
+    uint16_t firstNew = text->nextColumn;
+    text->nextColumn = (text->nextColumn + columns) % streamColumns;
+    if (text->bRedraw || columns >= FASTLED_MATRIX_WIDTH)
+        {
+        uint16_t column = (text->nextColumn + streamColumns - FASTLED_MATRIX_WIDTH) % streamColumns;
+        for (int16_t x = 0; x < FASTLED_MATRIX_WIDTH; x++)
+            {
+            fastLedMatrixBlitColumn(text->matrix, x, 0, fastLedTextColumn(text, column), FASTLED_MATRIX_HEIGHT);
+            column = (column + 1 < streamColumns) ? column + 1 : 0;
+            }
+        text->bRedraw = false;
+        return;
+        }
+    if (columns == 0)
+        {
+        return;     // Leave the matrix alone, so it can go unsent.
+        }
+    fastLedMatrixScroll(text->matrix, -(int16_t) columns, 0, text->background);
+    uint16_t column = firstNew;
+    for (int16_t x = FASTLED_MATRIX_WIDTH - columns; x < FASTLED_MATRIX_WIDTH; x++)
+        {
+        if (column < text->textColumns)     // The gap's already background.
+            {
+            fastLedMatrixBlitColumn(text->matrix, x, 0, fastLedTextColumn(text, column), FASTLED_MATRIX_HEIGHT);
+            }
+        column = (column + 1 < streamColumns) ? column + 1 : 0;
+        }
+    }
+
+
+/// @brief Steps the text for the shows since it last did, for the render
+/// function to call every frame.  Draws nothing if it isn't time to move.
+void fastLedTextRender(FastLedScrollText* text)
+    {
+    text->renders++;
+    uint32_t steps = (fastLedTextShows(text) - text->steppedAt) / text->framesPerColumn;
+    text->steppedAt += steps * text->framesPerColumn;
+    uint16_t streamColumns = text->textColumns + FASTLED_MATRIX_WIDTH;
+    if (steps > streamColumns)
+        {
+        steps = streamColumns + steps % streamColumns;  // Still a whole redraw.
+        }
+    fastLedTextStep(text, (uint16_t) steps);
+    }
@@ -0,0 +1,55 @@
+#ifndef _FAST_LED_SCROLL_TEXT_H_
+#define _FAST_LED_SCROLL_TEXT_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+#include "fastLedMatrix.h"
+
+// Text scrolling right to left across a matrix, in a 5x7 font.
+//
+// Each distinct character is rasterised once, when the text is set, into a
+// glyph cache of CRGB columns (its five and a blank one to space it from the
+// next), so drawing a column is copying ten pixels.  A step moves the whole
+// matrix left with fastLedMatrixScroll() (a memmove() per row) and draws
+// only the columns that have come in at the right, rather than drawing the
+// lot again.  That works because every new back buffer starts as a copy of
+// the frame before (see fastLedSwapBuffers()), so the matrix still has
+// what the last step left there; nothing else should paint the matrix.
+//
+// fastLedTextRender() steps once every framesPerColumn shows of the
+// matrix's group (see frameGovernorGroupShows()), so the text moves at the
+// rate the LEDs actually refresh, however unevenly frames are painted, and
+// catches up if a render comes late.  Without FASTLED_STUTTER_REDUCTION
+// there is no governor, so it steps every framesPerColumn renders.
+//
+// The text goes round again after a matrix width gap.  The caller owns the
+// FastLedScrollText (one per matrix), which is about 4.5K.
+
+#define FASTLED_TEXT_MAX_CHARS      64
+#define FASTLED_TEXT_MAX_GLYPHS     24      // Distinct characters in a text.
+#define FASTLED_TEXT_FONT_WIDTH     5
+#define FASTLED_TEXT_FONT_HEIGHT    7
+#define FASTLED_TEXT_GLYPH_COLUMNS  (FASTLED_TEXT_FONT_WIDTH + 1)
+#define FASTLED_TEXT_TOP            ((FASTLED_MATRIX_HEIGHT - FASTLED_TEXT_FONT_HEIGHT) / 2)
+
+typedef struct
+    {
+    CRGB glyphColumns[FASTLED_TEXT_MAX_GLYPHS * FASTLED_TEXT_GLYPH_COLUMNS][FASTLED_MATRIX_HEIGHT];
+    CRGB blankColumn[FASTLED_MATRIX_HEIGHT];
+    uint8_t glyphs[FASTLED_TEXT_MAX_CHARS];     // Glyph cache slot of each character.
+    uint16_t textColumns;       // The text's columns, then a gap of FASTLED_MATRIX_WIDTH.
+    uint16_t nextColumn;        // Column of text (and gap) that comes in next at the right.
+    CRGB background;
+    uint8_t matrix;
+    uint8_t framesPerColumn;
+    uint32_t steppedAt;         // Shows (or renders) the steps so far were for.
+    uint32_t renders;           // Without FASTLED_STUTTER_REDUCTION.
+    bool bRedraw;               // Draw the whole matrix at the next step.
+    } FastLedScrollText;
+
+extern bool fastLedTextInit(FastLedScrollText* text, uint8_t matrix, const char* string,
+                            const CRGB& colour, const CRGB& background, uint8_t framesPerColumn);
+extern void fastLedTextStep(FastLedScrollText* text, uint16_t columns);
+extern void fastLedTextRender(FastLedScrollText* text);
+
+#endif /* _FAST_LED_SCROLL_TEXT_H_ */
@@ -0,0 +1,378 @@
+#include "fastLedShowScheduler.h"
+
+#if FASTLED_FRAME_SLOTS < 2 || FASTLED_FRAME_SLOTS > 8
+# error "FASTLED_FRAME_SLOTS must be 2 to 8"
+#endif
+
+static portMUX_TYPE showSchedulerMux = portMUX_INITIALIZER_UNLOCKED;
+static FastLedShowSchedulerStats showStats = {};
+static TaskHandle_t showTaskHandle = NULL;
+static TaskHandle_t stageTaskHandle = NULL;
+static bool bReleaseHeld = false;       // Released while staging.
+static bool bShownOne = false;
+static bool bHeld = false;              // Nothing more goes on the wire until showSchedulerInit().
+static FastLedSwapFunction swapFrame = NULL;
+
+// Where each slot is.  The queue is oldest first.
+static FastLedSlotState slotStates[FASTLED_FRAME_SLOTS] = { SHOW_SLOT_RENDERING };
+static uint8_t slotCounts[SHOW_SLOT_STATES] = { FASTLED_FRAME_SLOTS - 1, 1 };
+static uint64_t slotSubmittedUs[FASTLED_FRAME_SLOTS] = { 0 };
+static uint8_t queuedSlots[FASTLED_FRAME_SLOTS];
+static uint8_t queuedCount = 0;
+static volatile int8_t stagingSlot = -1;
+static int8_t stagedSlot = -1;          // Whose frame is staged, ready to go.
+static volatile uint8_t stagingWire = 0;    // The wire buffer the staging or staged frame is in,
+static volatile uint8_t transmitWire = 1;   // and the one on the wire (or last on it).
+static volatile int8_t transmitSlot = -1;
+static uint8_t renderSlot = 0;
+static volatile uint64_t transmitStartUs = 0;
+static uint64_t occupancyFromUs = 0;
+
+
+/// @brief Moves a slot to a new state, adding the time since the last move
+/// to the occupancy counters first.  Inside the critical section.
+static void showSchedulerSetSlot(uint8_t slot, FastLedSlotState state, uint64_t nowUs)
+    {
+    for (uint8_t i = 0; i < SHOW_SLOT_STATES; i++)
+        {
+        showStats.occupancyUs[i] += slotCounts[i] * (nowUs - occupancyFromUs);
+        }
+    occupancyFromUs = nowUs;
+    slotCounts[slotStates[slot]]--;
+    slotCounts[state]++;
+    slotStates[slot] = state;
+    }
+
+
+/// @brief Takes the queued frame at position out of the queue.
+static void showSchedulerUnqueue(uint8_t position)
+    {
+    for (uint8_t i = position; i + 1 < queuedCount; i++)
+        {
+        queuedSlots[i] = queuedSlots[i + 1];
+        }
+    queuedCount--;
+    }
+
+
+/// @brief Starts staging the oldest frame if it needs it and the stage is
+/// free, into the wire buffer that isn't on the wire.
+/// @return The stage task to notify, or NULL.
+static TaskHandle_t showSchedulerStartStaging(uint64_t nowUs)
+    {
+    if (stageTaskHandle == NULL || queuedCount == 0 || stagingSlot >= 0 || stagedSlot == queuedSlots[0])
+        {
+        return(NULL);
+        }
+    stagingWire = transmitWire ^ 1;
+    stagingSlot = queuedSlots[0];
+    showSchedulerSetSlot(stagingSlot, SHOW_SLOT_STAGING, nowUs);
+    return(stageTaskHandle);
+    }
+
+
+/// @brief Connects the scheduler to the show task and the slot swap.
+/// Called again (without a task, then with the new one) by a warm restart,
+/// which forgets every queued frame but leaves the renderer its slot, and
+/// leaves the counters alone.
+/// @param showTask Task that waits (ulTaskNotifyTake) for frames, or NULL
+/// to release frames to nobody.
+/// @param swapFunction Gives the renderer its next slot.
+void showSchedulerInit(TaskHandle_t showTask, FastLedSwapFunction swapFunction)
+    {
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    showTaskHandle = showTask;
+    swapFrame = swapFunction;
+    for (uint8_t slot = 0; slot < FASTLED_FRAME_SLOTS; slot++)
+        {
+        if (slot != renderSlot && slotStates[slot] != SHOW_SLOT_FREE)
+            {
+            showSchedulerSetSlot(slot, SHOW_SLOT_FREE, nowUs);
+            }
+        }
+    queuedCount = 0;
+    stagingSlot = -1;
+    stagedSlot = -1;
+    transmitSlot = -1;
+    bShownOne = false;
+    bReleaseHeld = false;
+    bHeld = false;
+    if (showStats.occupancySinceUs == 0)
+        {
+        showStats.occupancySinceUs = nowUs;
+        occupancyFromUs = nowUs;
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    }
+
+
+/// @brief Stops the show task starting any more frames (a warm restart,
+/// waiting for it to come out of the one it is stuck in, doesn't want it
+/// going straight into the next queued one).  Undone by showSchedulerInit().
+void showSchedulerHold(void)
+    {
+    portENTER_CRITICAL(&showSchedulerMux);
+    bHeld = true;
+    portEXIT_CRITICAL(&showSchedulerMux);
+    }
+
+
+/// @brief Puts the output stage between a frame being queued and it being sent.
+/// @param stageTask Task that waits (ulTaskNotifyTake) for frames to stage,
+/// stages showSchedulerStagingSlot() and calls showSchedulerEndStaging(), or NULL for no stage.
+void showSchedulerSetStage(TaskHandle_t stageTask)
+    {
+    portENTER_CRITICAL(&showSchedulerMux);
+    stageTaskHandle = stageTask;
+    portEXIT_CRITICAL(&showSchedulerMux);
+    }
+
+
+/// @brief Stage task side: the slot to stage, or -1 if there isn't one
+/// (a warm restart has been since it was notified).
+int8_t showSchedulerStagingSlot(void)
+    {
+    return(stagingSlot);
+    }
+
+
+/// @brief Stage task side: the wire buffer to stage into.
+uint8_t showSchedulerStagingWire(void)
+    {
+    return(stagingWire);
+    }
+
+
+/// @brief Render side: offer the render slot as the next frame.  Never blocks.
+/// @return Whether the frame was queued (and the renderer given another slot),
+/// queued in place of an older one, or dropped for want of a slot.
+FastLedSubmitResult showSchedulerSubmitFrame(void)
+    {
+    FastLedSubmitResult result = SHOW_SUBMIT_QUEUED;
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    showStats.framesSubmitted++;
+    int8_t nextSlot = -1;
+    for (uint8_t slot = 0; slot < FASTLED_FRAME_SLOTS && nextSlot < 0; slot++)
+        {
+        if (slotStates[slot] == SHOW_SLOT_FREE)
+            {
+            nextSlot = slot;
+            }
+        }
+#if FASTLED_FRAME_DROP_POLICY == FASTLED_FRAME_DROP_OLDEST
+    for (uint8_t position = 0; position < queuedCount && nextSlot < 0; position++)
+        {
+        if (queuedSlots[position] != stagingSlot)
+            {
+            // The show task hasn't started on it, so the newer frame wins.
+            nextSlot = queuedSlots[position];
+            showSchedulerUnqueue(position);
+            showStats.framesCoalesced++;
+            result = SHOW_SUBMIT_COALESCED;
+            }
+        }
+#endif
+    TaskHandle_t stageTask = NULL;
+    if (nextSlot < 0)
+        {
+        showStats.framesDropped++;
+        result = SHOW_SUBMIT_DROPPED;
+        }
+    else
+        {
+        slotSubmittedUs[renderSlot] = nowUs;
+        queuedSlots[queuedCount++] = renderSlot;
+        showSchedulerSetSlot(renderSlot, SHOW_SLOT_QUEUED, nowUs);
+        if (queuedCount > showStats.maxQueued)
+            {
+            showStats.maxQueued = queuedCount;
+            }
+        renderSlot = nextSlot;
+        if (stagedSlot == renderSlot)
+            {
+            stagedSlot = -1;    // It's about to be painted over.
+            }
+        showSchedulerSetSlot(renderSlot, SHOW_SLOT_RENDERING, nowUs);
+        swapFrame(renderSlot);
+        stageTask = showSchedulerStartStaging(nowUs);
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    if (stageTask != NULL)
+        {
+        xTaskNotifyGive(stageTask);
+        }
+    return(result);
+    }
+
+
+/// @brief Wakes the show task for the oldest queued frame.  Called when the
+/// frame governor says it's time (or straight after a queued submit).
+void showSchedulerRelease(void)
+    {
+    portENTER_CRITICAL(&showSchedulerMux);
+    TaskHandle_t showTask = showTaskHandle;
+    if (transmitSlot >= 0 || bHeld)
+        {
+        showTask = NULL;        // Stale by the time it's done, which asks again (see showSchedulerEndTransmit()).
+        }
+    else if (stagingSlot >= 0)
+        {
+        bReleaseHeld = true;    // showSchedulerEndStaging() will do it.
+        showTask = NULL;
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    if (showTask != NULL)
+        {
+        xTaskNotifyGive(showTask);
+        }
+    }
+
+
+/// @brief Stage task side: the oldest frame is staged and can be sent (and
+/// is released, if the release came while it was being staged).
+void showSchedulerEndStaging(void)
+    {
+    TaskHandle_t showTask = NULL;
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    if (stagingSlot >= 0)     // Not if a warm restart has been since.
+        {
+        stagedSlot = stagingSlot;
+        showSchedulerSetSlot(stagingSlot, SHOW_SLOT_QUEUED, nowUs);
+        stagingSlot = -1;
+        if (bReleaseHeld)
+            {
+            showTask = showTaskHandle;
+            }
+        }
+    bReleaseHeld = false;
+    portEXIT_CRITICAL(&showSchedulerMux);
+    if (showTask != NULL)
+        {
+        xTaskNotifyGive(showTask);
+        }
+    }
+
+
+/// @brief Show task side: claim the oldest queued frame.
+/// @return Its slot, or -1 if there isn't one ready to send.
+int8_t showSchedulerBeginTransmit(void)
+    {
+    int8_t slot = -1;
+    TaskHandle_t stageTask = NULL;
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    if (queuedCount > 0 && transmitSlot < 0 && !bHeld)
+        {
+        if (stageTaskHandle != NULL && stagedSlot != queuedSlots[0])
+            {
+            bReleaseHeld = true;    // Released, then replaced by a frame still being staged.
+            }
+        else
+            {
+            slot = queuedSlots[0];
+            showSchedulerUnqueue(0);
+            showSchedulerSetSlot(slot, SHOW_SLOT_TRANSMITTING, nowUs);
+            transmitSlot = slot;
+            transmitStartUs = nowUs;
+            if (stageTaskHandle != NULL)
+                {
+                transmitWire = stagingWire;
+                stagedSlot = -1;
+                stageTask = showSchedulerStartStaging(nowUs);    // The next one, into the other buffer.
+                }
+            }
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    if (stageTask != NULL)
+        {
+        xTaskNotifyGive(stageTask);
+        }
+    return(slot);
+    }
+
+
+/// @brief Show task side: FastLED.show() has returned, its slot is free.
+/// @return true if there is another frame queued, which wants releasing.
+bool showSchedulerEndTransmit(void)
+    {
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    if (transmitSlot >= 0)
+        {
+        showSchedulerSetSlot(transmitSlot, SHOW_SLOT_FREE, nowUs);
+        transmitSlot = -1;
+        }
+    showStats.framesShown++;
+    bShownOne = true;
+    bool bMore = (queuedCount > 0);
+    TaskHandle_t stageTask = showSchedulerStartStaging(nowUs);
+    portEXIT_CRITICAL(&showSchedulerMux);
+    if (stageTask != NULL)
+        {
+        xTaskNotifyGive(stageTask);
+        }
+    return(bMore);
+    }
+
+
+FastLedShowState showSchedulerState(void)
+    {
+    FastLedShowState state;
+    portENTER_CRITICAL(&showSchedulerMux);
+    if (transmitSlot >= 0)
+        {
+        state = SHOW_STATE_TRANSMITTING;
+        }
+    else if (stagingSlot >= 0)
+        {
+        state = SHOW_STATE_STAGING;
+        }
+    else if (queuedCount > 0)
+        {
+        state = SHOW_STATE_PENDING;
+        }
+    else
+        {
+        state = bShownOne ? SHOW_STATE_DONE : SHOW_STATE_IDLE;
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    return(state);
+    }
+
+
+/// @brief When the frame on the wire (or the last one) was submitted.
+uint64_t showSchedulerSubmittedUs(void)
+    {
+    int8_t slot = transmitSlot;
+    return((slot >= 0) ? slotSubmittedUs[slot] : 0);
+    }
+
+
+/// @brief When the current (or last) transmission started.
+uint64_t showSchedulerTransmitStartUs(void)
+    {
+    return(transmitStartUs);
+    }
+
+
+/// @brief The wire buffer the frame on the wire was staged into (with an output stage).
+uint8_t showSchedulerTransmitWire(void)
+    {
+    return(transmitWire);
+    }
+
+
+void showSchedulerGetStats(FastLedShowSchedulerStats* stats)
+    {
+    uint64_t nowUs = esp_timer_get_time();
+    portENTER_CRITICAL(&showSchedulerMux);
+    *stats = showStats;
+    for (uint8_t i = 0; i < SHOW_SLOT_STATES; i++)
+        {
+        stats->occupancyUs[i] += slotCounts[i] * (nowUs - occupancyFromUs);
+        }
+    portEXIT_CRITICAL(&showSchedulerMux);
+    }
@@ -0,0 +1,91 @@
+#ifndef _FAST_LED_SHOW_SCHEDULER_H_
+#define _FAST_LED_SHOW_SCHEDULER_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+
+// Hand over between the renderer and fastLedShowHandlerTask.
+//
+// Frames live in FASTLED_FRAME_SLOTS preallocated slots (the LED arena's
+// thirds, or halves...).  One is always the renderer's to paint into.  When
+// it submits a frame that slot joins the queue and the renderer is given a
+// free one.  It then releases the frame (directly or via the frame governor),
+// which wakes the show task with a task notification, and the show task
+// sends the oldest queued frame.  Once it is on the wire the slot is free again.
+//
+// If there is no free slot for the renderer, FASTLED_FRAME_DROP_POLICY says
+// who loses: DROP_OLDEST takes the oldest queued frame that hasn't been
+// started on (counted as coalesced, so with two slots a newer frame replaces
+// the pending one), DROP_NEWEST refuses the submit (counted as dropped), and
+// the renderer simply carries on painting into the slot it has.  A frame on
+// the wire is never dropped, so with two slots a submit while transmitting
+// is always refused.  Nobody ever spins or yields waiting for anybody else.
+//
+// With an output stage (see fastLedOutputStage.h) the oldest frame goes to
+// the stage task first, and can only be sent once it has been staged.  It is
+// staged into whichever of the two wire buffers isn't on the wire, so it is
+// staged while the frame before it is being sent, and only one frame is
+// staged ahead.  A release while it is still being staged is held until
+// then, and a frame being staged is never dropped, as the stage is reading it.
+// A staged frame can still be replaced by a newer one (DROP_OLDEST), which
+// is then staged in its place, so the stage can run more often than the show.
+
+typedef enum
+    {
+    SHOW_STATE_IDLE = 0,        // Nothing submitted yet.
+    SHOW_STATE_STAGING,         // The output stage (core 0) is preparing the oldest frame.
+    SHOW_STATE_PENDING,         // A frame is queued (staged), show task notified.
+    SHOW_STATE_TRANSMITTING,    // Show task is inside FastLED.show().
+    SHOW_STATE_DONE             // Last frame is on the wire, nothing queued.
+    } FastLedShowState;
+
+typedef enum
+    {
+    SHOW_SUBMIT_QUEUED = 0,     // Frame is queued, needs releasing.
+    SHOW_SUBMIT_COALESCED,      // Frame queued in place of an older one that hadn't started.
+    SHOW_SUBMIT_DROPPED         // No slot to spare, frame refused, renderer keeps its slot.
+    } FastLedSubmitResult;
+
+// What a slot is doing, for the occupancy counters.  (One is always rendering.)
+typedef enum
+    {
+    SHOW_SLOT_FREE = 0,
+    SHOW_SLOT_RENDERING,
+    SHOW_SLOT_QUEUED,
+    SHOW_SLOT_STAGING,
+    SHOW_SLOT_TRANSMITTING,
+    SHOW_SLOT_STATES
+    } FastLedSlotState;
+
+typedef struct
+    {
+    uint32_t framesSubmitted;   // Every call to showSchedulerSubmitFrame().
+    uint32_t framesShown;       // Frames that made it through FastLED.show().
+    uint32_t framesCoalesced;   // Queued frames dropped for a newer one (DROP_OLDEST).
+    uint32_t framesDropped;     // Submits refused for want of a slot.
+    uint8_t maxQueued;          // Most frames ever waiting (including one being staged).
+    uint64_t occupancyUs[SHOW_SLOT_STATES];     // Slot microseconds in each state since boot,
+    uint64_t occupancySinceUs;                  // so each over this is the mean slots in it.
+    } FastLedShowSchedulerStats;
+
+/// @brief Gives the renderer the slot it is to paint into next.  Called by
+/// the scheduler inside its critical section, so keep it short.
+typedef void (*FastLedSwapFunction)(uint8_t renderSlot);
+
+extern void showSchedulerInit(TaskHandle_t showTask, FastLedSwapFunction swapFunction);
+extern void showSchedulerHold(void);
+extern void showSchedulerSetStage(TaskHandle_t stageTask);
+extern int8_t showSchedulerStagingSlot(void);
+extern uint8_t showSchedulerStagingWire(void);
+extern void showSchedulerEndStaging(void);
+extern FastLedSubmitResult showSchedulerSubmitFrame(void);
+extern void showSchedulerRelease(void);
+extern int8_t showSchedulerBeginTransmit(void);
+extern bool showSchedulerEndTransmit(void);
+extern FastLedShowState showSchedulerState(void);
+extern uint64_t showSchedulerSubmittedUs(void);
+extern uint64_t showSchedulerTransmitStartUs(void);
+extern uint8_t showSchedulerTransmitWire(void);
+extern void showSchedulerGetStats(FastLedShowSchedulerStats* stats);
+
+#endif /* _FAST_LED_SHOW_SCHEDULER_H_ */
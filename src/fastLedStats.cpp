@@ -0,0 +1,234 @@
+#include "debug_conditionals.h"
+#include "fastLedStats.h"
+#include "fastLedFrameGovernor.h"
+#include "fastLedJamWatchdog.h"
+#include "fastLedOutputStage.h"
+#include "fastLedPowerBudget.h"
+#include "fastLedShowScheduler.h"
+
+static portMUX_TYPE fastLedStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static FastLedStats fastLedStats = {};
+static bool bLastShowLate = false;      // There was a show before, so lastShowLateUs means something.
+static uint32_t lastShowLateUs = 0;
+
+static const char* const slotStateNames[SHOW_SLOT_STATES] =
+    {
+    "free",
+    "rendering",
+    "queued",
+    "staging",
+    "transmitting",
+    };
+
+static const char* const histogramNames[FASTLED_HIST_COUNT] =
+    {
+    "render",
+    "queue wait",
+    "show",
+    "lateness",
+    "jitter",
+    "stage",
+    };
+
+
+uint32_t fastLedHistogramPercentileUs(const FastLedHistogram* histogram, uint8_t percentile)
+    {
+    if (histogram->samples == 0)
+        {
+        return(0);
+        }
+    uint32_t wanted = (uint32_t) (((uint64_t) histogram->samples * percentile + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t bucket = 0; bucket < FASTLED_STATS_BUCKETS; bucket++)
+        {
+        seen += histogram->counts[bucket];
+        if (seen >= wanted)
+            {
+            return((bucket == 0) ? 0 : (uint32_t) ((1ULL << bucket) - 1));
+            }
+        }
+    return(histogram->maxUs);
+    }
+
+
+void fastLedStatsRecord(FastLedHistogramId id, uint32_t us)
+    {
+    portENTER_CRITICAL(&fastLedStatsMux);
+    fastLedHistogramAdd(&fastLedStats.histograms[id], us);
+    portEXIT_CRITICAL(&fastLedStatsMux);
+    }
+
+
+/// @brief Called by the show task after every show.
+/// @param submittedUs When the frame went into the pending slot.
+/// @param startUs When the show started.
+/// @param endUs When it returned.
+/// @param lateUs How far past its deadline it started (from the frame governor),
+/// or FASTLED_NOT_LATE if it had none to be late against.
+/// @param controllerMask Which controllers were sent, the others skipped this frame.
+/// @param unchangedMask Which were skipped because they hadn't changed (not dropped, they have it already).
+/// @param refreshMask Which were sent unchanged, as they were due a full refresh.
+void fastLedStatsRecordShow(uint64_t submittedUs, uint64_t startUs, uint64_t endUs, uint32_t lateUs, uint8_t controllerMask,
+                            uint8_t unchangedMask, uint8_t refreshMask)
+    {
+    portENTER_CRITICAL(&fastLedStatsMux);
+    fastLedHistogramAdd(&fastLedStats.histograms[FASTLED_HIST_QUEUE_WAIT], (uint32_t) (startUs - submittedUs));
+    fastLedHistogramAdd(&fastLedStats.histograms[FASTLED_HIST_SHOW], (uint32_t) (endUs - startUs));
+    if (lateUs != FASTLED_NOT_LATE)
+        {
+        fastLedHistogramAdd(&fastLedStats.histograms[FASTLED_HIST_LATENESS], lateUs);
+        if (bLastShowLate)
+            {
+            // Starts minus deadlines, from one show to the next, is the difference in lateness.
+            fastLedHistogramAdd(&fastLedStats.histograms[FASTLED_HIST_JITTER],
+                                (lateUs > lastShowLateUs) ? lateUs - lastShowLateUs : lastShowLateUs - lateUs);
+            }
+        }
+    bLastShowLate = (lateUs != FASTLED_NOT_LATE);
+    lastShowLateUs = lateUs;
+    for (int i = 0; i < fastLedControllerCount(); i++)
+        {
+        if (controllerMask & (1 << i))
+            {
+            fastLedStats.framesShown[i]++;
+            if (refreshMask & (1 << i))
+                {
+                fastLedStats.framesRefreshed[i]++;
+                }
+            }
+        else if (unchangedMask & (1 << i))
+            {
+            fastLedStats.framesUnchanged[i]++;
+            }
+        else
+            {
+            fastLedStats.framesDropped[i]++;
+            }
+        }
+    portEXIT_CRITICAL(&fastLedStatsMux);
+    }
+
+
+/// @brief A frame was painted and submitted but will never be sent
+/// (dropped or coalesced by the show scheduler).
+void fastLedStatsRecordDropped(void)
+    {
+    portENTER_CRITICAL(&fastLedStatsMux);
+    for (int i = 0; i < fastLedControllerCount(); i++)
+        {
+        fastLedStats.framesDropped[i]++;
+        }
+    portEXIT_CRITICAL(&fastLedStatsMux);
+    }
+
+
+void fastLedStatsGet(FastLedStats* stats)
+    {
+    portENTER_CRITICAL(&fastLedStatsMux);
+    *stats = fastLedStats;
+    portEXIT_CRITICAL(&fastLedStatsMux);
+    }
+
+
+void fastLedStatsReset(void)
+    {
+    portENTER_CRITICAL(&fastLedStatsMux);
+    memset(&fastLedStats, 0, sizeof(fastLedStats));
+    bLastShowLate = false;
+    portEXIT_CRITICAL(&fastLedStatsMux);
+    }
+
+
+/// @brief Prints a summary line and the non-empty buckets for each histogram,
+/// then the per controller frame counts.  Each line is put together in a
+/// buffer and printed in one go, so the whole dump fits in the debug log ring.
+void fastLedStatsDump(void)
+    {
+#ifdef DEBUG_ON
+    FastLedStats stats;
+    fastLedStatsGet(&stats);
+    char line[FASTLED_STATS_LINE_BYTES];
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        for (int id = 0; id < FASTLED_HIST_COUNT; id++)
+            {
+            const FastLedHistogram* histogram = &stats.histograms[id];
+            snprintf(line, sizeof(line), "%s: n=%lu mean=%lu p50<=%lu p99<=%lu max=%lu us",
+                     histogramNames[id],
+                     (unsigned long) histogram->samples,
+                     (unsigned long) (histogram->samples ? histogram->totalUs / histogram->samples : 0),
+                     (unsigned long) fastLedHistogramPercentileUs(histogram, 50),
+                     (unsigned long) fastLedHistogramPercentileUs(histogram, 99),
+                     (unsigned long) histogram->maxUs);
+            DEBUG_PRINTLN(line);
+            size_t length = snprintf(line, sizeof(line), "   ");
+            for (uint8_t bucket = 0; bucket < FASTLED_STATS_BUCKETS && length < sizeof(line); bucket++)
+                {
+                if (histogram->counts[bucket] > 0)
+                    {
+                    length += snprintf(line + length, sizeof(line) - length, " <%lu:%lu",
+                                       (unsigned long) (1UL << bucket), (unsigned long) histogram->counts[bucket]);
+                    }
+                }
+            DEBUG_PRINTLN(line);
+            }
+        for (int i = 0; i < fastLedControllerCount(); i++)
+            {
+            snprintf(line, sizeof(line), "controllers[%d] shown %lu (%lu refreshes) unchanged %lu dropped %lu.",
+                     i,
+                     (unsigned long) stats.framesShown[i],
+                     (unsigned long) stats.framesRefreshed[i],
+                     (unsigned long) stats.framesUnchanged[i],
+                     (unsigned long) stats.framesDropped[i]);
+            DEBUG_PRINTLN(line);
+            }
+        FastLedJamWatchdogStats jamStats;
+        jamWatchdogGetStats(&jamStats);
+        snprintf(line, sizeof(line), "jam watchdog: %lu shows, %lu jams, %lu GiveGTX_sem, %lu warm restarts, "
+                                     "margin %lu us, longest jam %lu us, next step %lu.",
+                 (unsigned long) jamStats.shows,
+                 (unsigned long) jamStats.jams,
+                 (unsigned long) jamStats.actions[FASTLED_JAM_GIVE_GTX_SEM],
+                 (unsigned long) jamStats.actions[FASTLED_JAM_WARM_RESTART],
+                 (unsigned long) jamStats.marginUs,
+                 (unsigned long) jamStats.longestJamUs,
+                 (unsigned long) jamStats.step);
+        DEBUG_PRINTLN(line);
+#if FASTLED_OUTPUT_STAGE
+        FastLedOutputStageStats stageStats;
+        outputStageGetStats(&stageStats);
+        snprintf(line, sizeof(line), "output stage: %lu frames staged, tables built %lu times, scale now %lu.",
+                 (unsigned long) stageStats.framesStaged,
+                 (unsigned long) stageStats.tableBuilds,
+                 (unsigned long) stageStats.scale);
+        DEBUG_PRINTLN(line);
+#endif
+        snprintf(line, sizeof(line), "power: last frame %lu mW, scale %lu, %lu pixel updates, %lu segment fills, %lu segment sums.",
+                 (unsigned long) fastLedPowerStats.frameMw,
+                 (unsigned long) fastLedPowerStats.scale,
+                 (unsigned long) fastLedPowerStats.pixelUpdates,
+                 (unsigned long) fastLedPowerStats.fills,
+                 (unsigned long) fastLedPowerStats.recomputes);
+        DEBUG_PRINTLN(line);
+        // Mean slots in each state since boot, e.g. "queued 0.42".
+        FastLedShowSchedulerStats queueStats;
+        showSchedulerGetStats(&queueStats);
+        uint64_t elapsedUs = esp_timer_get_time() - queueStats.occupancySinceUs;
+        size_t length = snprintf(line, sizeof(line), "frame queue: %d slots, ", FASTLED_FRAME_SLOTS);
+        for (uint8_t state = 0; state < SHOW_SLOT_STATES && length < sizeof(line); state++)
+            {
+            length += snprintf(line + length, sizeof(line) - length, "%s %.2f, ", slotStateNames[state],
+                               (elapsedUs > 0) ? (double) queueStats.occupancyUs[state] / elapsedUs : 0.0);
+            }
+        if (length < sizeof(line))
+            {
+            snprintf(line + length, sizeof(line) - length, "at most %lu queued, %lu dropped oldest, %lu dropped newest.",
+                     (unsigned long) queueStats.maxQueued,
+                     (unsigned long) queueStats.framesCoalesced,
+                     (unsigned long) queueStats.framesDropped);
+            }
+        DEBUG_PRINTLN(line);
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+#endif
+    }
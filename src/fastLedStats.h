@@ -0,0 +1,74 @@
+#ifndef _FAST_LED_STATS_H_
+#define _FAST_LED_STATS_H_
+
+#include <Arduino.h>
+#include "displayFastLedCommon.h"
+
+// Frame timing instrumentation.  All times are microseconds from
+// esp_timer_get_time() and go into log2 histograms: bucket 0 counts 0us,
+// bucket b counts [2^(b-1), 2^b) us, and the last bucket catches anything
+// longer (about 8 seconds, which is a jam by anybody's standards).
+
+#define FASTLED_STATS_BUCKETS 24
+#define FASTLED_STATS_LINE_BYTES 192    // The longest line of fastLedStatsDump().
+
+typedef struct
+    {
+    uint32_t counts[FASTLED_STATS_BUCKETS];
+    uint32_t samples;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    } FastLedHistogram;
+
+typedef enum
+    {
+    FASTLED_HIST_RENDER = 0,    // paint_random_leds() (or whatever paints a frame).
+    FASTLED_HIST_QUEUE_WAIT,    // Frame submitted until FastLED.show() starts on it.
+    FASTLED_HIST_SHOW,          // FastLED.show() itself (wire time plus any waiting).
+    FASTLED_HIST_LATENESS,      // How late a show started against its groups' deadlines (frames submitted before them).
+    FASTLED_HIST_JITTER,        // How far the time from the last show start was from the time between
+                                // their deadlines (a period, or whole periods when frames come slower).
+    FASTLED_HIST_STAGE,         // The output stage: tables and lookups for a frame (core 0).
+    FASTLED_HIST_COUNT
+    } FastLedHistogramId;
+
+typedef struct
+    {
+    FastLedHistogram histograms[FASTLED_HIST_COUNT];
+    uint32_t framesShown[FASTLED_MAX_CONTROLLERS];
+    uint32_t framesDropped[FASTLED_MAX_CONTROLLERS];  // Submitted but never sent (on that controller).
+    uint32_t framesUnchanged[FASTLED_MAX_CONTROLLERS];    // Left out, as it would have sent the same again.
+    uint32_t framesRefreshed[FASTLED_MAX_CONTROLLERS];    // Sent unchanged, for the full refresh.
+    } FastLedStats;
+
+
+/// @brief Which bucket a time goes in.
+static inline uint8_t fastLedHistogramBucket(uint32_t us)
+    {
+    uint8_t bucket = (us == 0) ? 0 : (uint8_t) (32 - __builtin_clz(us));
+    return((bucket < FASTLED_STATS_BUCKETS) ? bucket : FASTLED_STATS_BUCKETS - 1);
+    }
+
+static inline void fastLedHistogramAdd(FastLedHistogram* histogram, uint32_t us)
+    {
+    histogram->counts[fastLedHistogramBucket(us)]++;
+    histogram->samples++;
+    histogram->totalUs += us;
+    if (us > histogram->maxUs)
+        {
+        histogram->maxUs = us;
+        }
+    }
+
+/// @brief Upper bound (in us) of the bucket holding the given percentile.
+extern uint32_t fastLedHistogramPercentileUs(const FastLedHistogram* histogram, uint8_t percentile);
+
+extern void fastLedStatsRecord(FastLedHistogramId id, uint32_t us);
+extern void fastLedStatsRecordShow(uint64_t submittedUs, uint64_t startUs, uint64_t endUs, uint32_t lateUs, uint8_t controllerMask,
+                                   uint8_t unchangedMask, uint8_t refreshMask);
+extern void fastLedStatsRecordDropped(void);
+extern void fastLedStatsGet(FastLedStats* stats);
+extern void fastLedStatsReset(void);
+extern void fastLedStatsDump(void);
+
+#endif /* _FAST_LED_STATS_H_ */
@@ -0,0 +1,91 @@
+#include "debug_conditionals.h"
+#include "telemetry.h"
+#include "task_stats.h"
+
+static portMUX_TYPE taskStatsMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskStatsEntry tasks[TASK_STATS_MAX_TASKS];
+static uint8_t taskCount = 0;
+
+
+/// @brief Call straight after creating a task.  A name seen before replaces that entry.
+/// @param stackBytes The stack size it was created with (bytes on an Esp32).
+void taskStatsRegister(TaskHandle_t handle, const char* name, uint32_t stackBytes, bool bStatic)
+    {
+    portENTER_CRITICAL(&taskStatsMux);
+    uint8_t index = 0;
+    while (index < taskCount && strcmp(tasks[index].name, name) != 0)
+        {
+        index++;
+        }
+    if (index < TASK_STATS_MAX_TASKS)
+        {
+        tasks[index].name = name;
+        tasks[index].handle = handle;
+        tasks[index].stackBytes = stackBytes;
+        tasks[index].bStatic = bStatic;
+        if (index == taskCount)
+            {
+            taskCount++;
+            }
+        }
+    portEXIT_CRITICAL(&taskStatsMux);
+    }
+
+
+/// @brief Most of the task's stack ever used, in bytes.
+uint32_t taskStatsStackUsed(uint8_t index)
+    {
+    if (index >= taskCount || tasks[index].handle == NULL)
+        {
+        return(0);
+        }
+    uint32_t neverUsed = uxTaskGetStackHighWaterMark(tasks[index].handle);
+    return((neverUsed < tasks[index].stackBytes) ? tasks[index].stackBytes - neverUsed : 0);
+    }
+
+
+/// @brief Stack peaks for every registered task, then the heap.
+void taskStatsReport(void)
+    {
+#ifdef DEBUG_ON
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largestBlock = ESP.getMaxAllocHeap();
+    uint32_t fragmentation = (freeHeap > 0 && largestBlock < freeHeap) ? 100 - (largestBlock * 100) / freeHeap : 0;
+# if DEBUG_BINARY_TELEMETRY
+    for (uint8_t i = 0; i < taskCount; i++)
+        {
+        uint32_t values[] = { i, tasks[i].stackBytes, taskStatsStackUsed(i), tasks[i].bStatic };
+        telemetryEmit(TELEMETRY_TASK_STACK, values);
+        }
+    uint32_t values[] = { freeHeap, ESP.getMinFreeHeap(), largestBlock, fragmentation };
+    telemetryEmit(TELEMETRY_HEAP, values);
+# else
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        for (uint8_t i = 0; i < taskCount; i++)
+            {
+            uint32_t used = taskStatsStackUsed(i);
+            DEBUG_PRINT("Task ");
+            DEBUG_PRINT(tasks[i].name);
+            DEBUG_PRINT(": stack ");
+            DEBUG_PRINT(tasks[i].stackBytes);
+            DEBUG_PRINT(tasks[i].bStatic ? " bytes (static), peak " : " bytes (heap), peak ");
+            DEBUG_PRINT(used);
+            DEBUG_PRINT(", ");
+            DEBUG_PRINT(tasks[i].stackBytes - used);
+            DEBUG_PRINTLN(" never used.");
+            }
+        DEBUG_PRINT("Heap: ");
+        DEBUG_PRINT(freeHeap);
+        DEBUG_PRINT(" bytes free (");
+        DEBUG_PRINT(ESP.getMinFreeHeap());
+        DEBUG_PRINT(" at the lowest), largest block ");
+        DEBUG_PRINT(largestBlock);
+        DEBUG_PRINT(", ");
+        DEBUG_PRINT(fragmentation);
+        DEBUG_PRINTLN("% fragmented.");
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+# endif
+#endif
+    }
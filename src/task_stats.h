@@ -0,0 +1,31 @@
+#ifndef _TASK_STATS_H_
+#define _TASK_STATS_H_
+
+#include <Arduino.h>
+
+// Stack and heap instrumentation for the tasks we create.  Each task is
+// registered when it is created (by name, so a task that is deleted and
+// created again, as the show task is by a warm restart, keeps its entry)
+// and taskStatsReport() prints how much of each stack has ever been used
+// (uxTaskGetStackHighWaterMark(), which ESP-IDF counts in bytes) and the
+// state of the heap.  Type 'm' in the serial monitor for it.
+//
+// Fragmentation is how much of the free heap isn't in the largest free
+// block, so 0% is one big block and anything high means a big allocation
+// (a frame buffer, say) can fail with plenty free.
+
+#define TASK_STATS_MAX_TASKS    6
+
+typedef struct
+    {
+    const char* name;
+    TaskHandle_t handle;
+    uint32_t stackBytes;
+    bool bStatic;               // Stack and TCB in .bss rather than the heap.
+    } TaskStatsEntry;
+
+extern void taskStatsRegister(TaskHandle_t handle, const char* name, uint32_t stackBytes, bool bStatic);
+extern uint32_t taskStatsStackUsed(uint8_t index);
+extern void taskStatsReport(void);
+
+#endif /* _TASK_STATS_H_ */
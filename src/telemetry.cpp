@@ -0,0 +1,21 @@
+#include "debug_conditionals.h"
+#include "telemetry.h"
+
+#if DEBUG_BINARY_TELEMETRY
+
+/// @brief Sends one record as a single '~' line.
+/// @param id Which record (sets how many values are used).
+/// @param values One per field, already scaled for any fixed point decimals.
+void telemetryEmit(TelemetryRecordId id, const uint32_t* values)
+    {
+    uint8_t record[TELEMETRY_MAX_RECORD_BYTES];
+    char line[TELEMETRY_MAX_LINE_BYTES + 1];
+    size_t length = telemetryPackRecord(record, id, (uint32_t) (esp_timer_get_time() / 1000), values);
+    if (length > 0)
+        {
+        telemetryEncodeLine(line, record, length);
+        DEBUG_PRINTLN(line);
+        }
+    }
+
+#endif
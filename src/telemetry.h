@@ -0,0 +1,12 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <Arduino.h>
+#include "telemetry_format.h"
+
+// Emits the records described in telemetry_format.h on the debug output.
+// Decode a capture with tools/telemetry_decode.
+
+extern void telemetryEmit(TelemetryRecordId id, const uint32_t* values);
+
+#endif /* _TELEMETRY_H_ */
@@ -0,0 +1,211 @@
+#ifndef _TELEMETRY_FORMAT_H_
+#define _TELEMETRY_FORMAT_H_
+
+// Compact telemetry records, shared by the firmware (telemetry.cpp) and the
+// host decoder (tools/telemetry_decode.cpp), so no Arduino stuff in here.
+//
+// A record is:
+//      [record id : 1][timestamp ms since boot : 4][fields : fixed width, little endian][crc8 : 1]
+// and goes out on the serial port as one line:
+//      '~' base64(record) '\n'
+// The base64 costs a third more than raw binary, but the line survives the
+// PlatformIO monitor's "time" and "log2file" filters (and its UTF-8 decoding),
+// so a capture like logs/device-monitor-*.log can hold text and records mixed.
+// A jam report is ~20 bytes on the wire rather than ~200 bytes of text.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEMETRY_LINE_START        '~'
+#define TELEMETRY_MAX_FIELDS        6
+#define TELEMETRY_MAX_RECORD_BYTES  (1 + 4 + TELEMETRY_MAX_FIELDS * 4 + 1)
+#define TELEMETRY_MAX_LINE_BYTES    (1 + ((TELEMETRY_MAX_RECORD_BYTES + 2) / 3) * 4 + 1)
+
+typedef enum
+    {
+    TELEMETRY_BOOT = 1,
+    TELEMETRY_INIT_COMPLETE,
+    TELEMETRY_FRAME_RATE,
+    TELEMETRY_LOOP_REPORT,
+    TELEMETRY_JAM_DETECTED,
+    TELEMETRY_JAM_RESTART,
+    TELEMETRY_FRAME_PERIOD,
+    TELEMETRY_JAM_ESCALATION,
+    TELEMETRY_RTC_REPORT,
+    TELEMETRY_BOOT_PROFILE,
+    TELEMETRY_TASK_STACK,
+    TELEMETRY_HEAP,
+    TELEMETRY_RECORD_COUNT
+    } TelemetryRecordId;
+
+typedef struct
+    {
+    const char* name;
+    uint8_t bytes;      // 1, 2 or 4.
+    uint8_t decimals;   // Fixed point: value is sent multiplied by 10^decimals.
+    } TelemetryField;
+
+typedef struct
+    {
+    const char* name;
+    uint8_t fieldCount;
+    TelemetryField fields[TELEMETRY_MAX_FIELDS];
+    } TelemetryRecord;
+
+// Indexed by TelemetryRecordId.  Only ever add to the end, the decoder
+// needs to read old captures.
+static const TelemetryRecord telemetryRecords[TELEMETRY_RECORD_COUNT] =
+    {
+        { "unknown", 0, { } },
+        { "boot", 2, { { "cpu_mhz", 2, 0 }, { "core", 1, 0 } } },
+        { "init_complete", 1, { { "boot_s", 4, 2 } } },
+        { "frame_rate", 2, { { "fps", 2, 0 }, { "period_ms", 2, 0 } } },
+        { "loop_report", 6, { { "uptime_s", 4, 0 }, { "loops_per_sec", 2, 2 }, { "ints_per_sec", 4, 0 },
+                              { "frames_shown", 4, 0 }, { "frames_coalesced", 4, 0 }, { "frames_dropped", 4, 0 } } },
+        { "jam_detected", 2, { { "uptime_s", 4, 0 }, { "forced_reset", 1, 0 } } },
+        { "jam_restart", 1, { { "uptime_s", 4, 0 } } },
+        { "frame_period", 2, { { "fps", 2, 2 }, { "period_us", 4, 0 } } },
+        { "jam_escalation", 4, { { "step", 1, 0 }, { "action", 1, 0 }, { "overdue_us", 4, 0 }, { "margin_us", 4, 0 } } },
+        { "rtc_report", 5, { { "boots", 4, 0 }, { "jams", 4, 0 }, { "jam_restarts", 4, 0 },
+                             { "uptime_s", 4, 0 }, { "reset_reason", 1, 0 } } },
+        { "boot_profile", 6, { { "serial_ms", 4, 2 }, { "fastled_setup_ms", 4, 2 }, { "show_task_ms", 4, 2 },
+                               { "post_init_ms", 4, 2 }, { "setup_done_ms", 4, 2 }, { "first_frame_ms", 4, 2 } } },
+        { "task_stack", 4, { { "task", 1, 0 }, { "stack_bytes", 4, 0 }, { "peak_bytes", 4, 0 }, { "static", 1, 0 } } },
+        { "heap", 4, { { "free", 4, 0 }, { "min_free", 4, 0 }, { "largest_block", 4, 0 }, { "fragmentation_pct", 1, 0 } } },
+    };
+
+
+/// @brief CRC-8 (polynomial 0x07) over a record.
+static inline uint8_t telemetryCrc8(const uint8_t* data, size_t length)
+    {
+    uint8_t crc = 0;
+    while (length--)
+        {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; bit++)
+            {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+            }
+        }
+    return(crc);
+    }
+
+
+/// @brief Packs a record.
+/// @return Number of bytes used in record (0 if the id is unknown).
+static inline size_t telemetryPackRecord(uint8_t* record, uint8_t id, uint32_t timestampMs, const uint32_t* values)
+    {
+    if (id == 0 || id >= TELEMETRY_RECORD_COUNT)
+        {
+        return(0);
+        }
+    size_t length = 0;
+    record[length++] = id;
+    for (int i = 0; i < 4; i++)
+        {
+        record[length++] = (uint8_t) (timestampMs >> (8 * i));
+        }
+    const TelemetryRecord& descriptor = telemetryRecords[id];
+    for (int field = 0; field < descriptor.fieldCount; field++)
+        {
+        for (int i = 0; i < descriptor.fields[field].bytes; i++)
+            {
+            record[length++] = (uint8_t) (values[field] >> (8 * i));
+            }
+        }
+    record[length] = telemetryCrc8(record, length);
+    return(length + 1);
+    }
+
+
+/// @brief Unpacks a record, checking its length and crc.
+/// @return true if record holds a good record.
+static inline bool telemetryUnpackRecord(const uint8_t* record, size_t length, uint8_t* id, uint32_t* timestampMs, uint32_t* values)
+    {
+    if (length < 6 || record[0] == 0 || record[0] >= TELEMETRY_RECORD_COUNT)
+        {
+        return(false);
+        }
+    const TelemetryRecord& descriptor = telemetryRecords[record[0]];
+    size_t expected = 1 + 4 + 1;
+    for (int field = 0; field < descriptor.fieldCount; field++)
+        {
+        expected += descriptor.fields[field].bytes;
+        }
+    if (length != expected || telemetryCrc8(record, length - 1) != record[length - 1])
+        {
+        return(false);
+        }
+    *id = record[0];
+    *timestampMs = (uint32_t) record[1] | ((uint32_t) record[2] << 8) | ((uint32_t) record[3] << 16) | ((uint32_t) record[4] << 24);
+    size_t pos = 5;
+    for (int field = 0; field < descriptor.fieldCount; field++)
+        {
+        uint32_t value = 0;
+        for (int i = 0; i < descriptor.fields[field].bytes; i++)
+            {
+            value |= (uint32_t) record[pos++] << (8 * i);
+            }
+        values[field] = value;
+        }
+    return(true);
+    }
+
+
+static const char telemetryBase64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/// @brief Makes the '~' base64 line (nul terminated, no newline) for a record.
+/// @return Length of the line.
+static inline size_t telemetryEncodeLine(char* line, const uint8_t* record, size_t length)
+    {
+    size_t pos = 0;
+    line[pos++] = TELEMETRY_LINE_START;
+    for (size_t i = 0; i < length; i += 3)
+        {
+        uint32_t group = (uint32_t) record[i] << 16;
+        if (i + 1 < length) group |= (uint32_t) record[i + 1] << 8;
+        if (i + 2 < length) group |= record[i + 2];
+        line[pos++] = telemetryBase64[(group >> 18) & 0x3F];
+        line[pos++] = telemetryBase64[(group >> 12) & 0x3F];
+        line[pos++] = (i + 1 < length) ? telemetryBase64[(group >> 6) & 0x3F] : '=';
+        line[pos++] = (i + 2 < length) ? telemetryBase64[group & 0x3F] : '=';
+        }
+    line[pos] = '\0';
+    return(pos);
+    }
+
+
+/// @brief Decodes the base64 part of a line (without the '~').
+/// @return Number of record bytes, or 0 if it isn't base64.
+static inline size_t telemetryDecodeLine(const char* text, size_t textLength, uint8_t* record, size_t maxLength)
+    {
+    size_t length = 0;
+    uint32_t group = 0;
+    int bits = 0;
+    for (size_t i = 0; i < textLength; i++)
+        {
+        char c = text[i];
+        int value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+') value = 62;
+        else if (c == '/') value = 63;
+        else if (c == '=') break;
+        else return(0);
+        group = (group << 6) | (uint32_t) value;
+        bits += 6;
+        if (bits >= 8)
+            {
+            bits -= 8;
+            if (length >= maxLength)
+                {
+                return(0);
+                }
+            record[length++] = (uint8_t) (group >> bits);
+            }
+        }
+    return(length);
+    }
+
+#endif /* _TELEMETRY_FORMAT_H_ */
@@ -0,0 +1,178 @@
+#include "debug_conditionals.h"
+#include "telemetry.h"
+#include "telemetry_rtc.h"
+#include <esp_system.h>
+
+static portMUX_TYPE rtcTelemetryMux = portMUX_INITIALIZER_UNLOCKED;
+static RTC_NOINIT_ATTR RtcTelemetryBlock rtcBlock;
+
+#define RTC_TELEMETRY_WORDS (sizeof(RtcTelemetryBlock) / sizeof(uint32_t))
+
+
+/// @brief Sum of every word in the block, checksum included (so 0 if it's good).
+static uint32_t rtcTelemetrySum(void)
+    {
+    const uint32_t* words = (const uint32_t*) &rtcBlock;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < RTC_TELEMETRY_WORDS; i++)
+        {
+        sum += words[i];
+        }
+    return(sum);
+    }
+
+
+/// @brief Adds to a counter in the block, keeping the checksum right.
+/// Call inside rtcTelemetryMux.
+static inline void rtcTelemetryAdd(uint32_t* word, uint32_t amount)
+    {
+    *word += amount;
+    rtcBlock.checksum -= amount;
+    }
+
+static inline void rtcTelemetrySet(uint32_t* word, uint32_t value)
+    {
+    rtcTelemetryAdd(word, value - *word);
+    }
+
+
+/// @brief Call first thing in setup().  Keeps the block if it survived the
+/// reset (adding the last boot's uptime to the total), otherwise starts it again.
+/// @return true if it survived.
+bool rtcTelemetryBoot(void)
+    {
+    bool bSurvived = (rtcBlock.magic == RTC_TELEMETRY_MAGIC && rtcTelemetrySum() == 0);
+    portENTER_CRITICAL(&rtcTelemetryMux);
+    if (bSurvived)
+        {
+        rtcBlock.totalUptimeS += rtcBlock.uptimeS;
+        rtcBlock.uptimeS = 0;
+        rtcBlock.boots++;
+        }
+    else
+        {
+        memset(&rtcBlock, 0, sizeof(rtcBlock));
+        rtcBlock.magic = RTC_TELEMETRY_MAGIC;
+        rtcBlock.boots = 1;
+        }
+    rtcBlock.lastResetReason = (uint32_t) esp_reset_reason();
+    rtcBlock.checksum = 0;
+    rtcBlock.checksum = 0 - rtcTelemetrySum();
+    portEXIT_CRITICAL(&rtcTelemetryMux);
+    return(bSurvived);
+    }
+
+
+/// @brief A jam has ended (one way or another).  Call inside rtcTelemetryMux.
+static void rtcTelemetryJam(void)
+    {
+    uint32_t nowS = rtcBlock.totalUptimeS + rtcBlock.uptimeS;
+    rtcTelemetryAdd(&rtcBlock.jams, 1);
+    if (nowS - rtcBlock.lastJamUptimeS > rtcBlock.longestRunS)
+        {
+        rtcTelemetrySet(&rtcBlock.longestRunS, nowS - rtcBlock.lastJamUptimeS);
+        }
+    rtcTelemetrySet(&rtcBlock.lastJamUptimeS, nowS);
+    }
+
+
+/// @brief Show task, after every show.
+/// @param recoveredAtStep The jam watchdog step that got the show going, -1 if it didn't jam.
+void rtcTelemetryRecordShow(int8_t recoveredAtStep)
+    {
+    uint32_t uptimeS = (uint32_t) (esp_timer_get_time() / 1000000);
+    portENTER_CRITICAL(&rtcTelemetryMux);
+    rtcTelemetryAdd(&rtcBlock.framesShown, 1);
+    if (uptimeS != rtcBlock.uptimeS)
+        {
+        rtcTelemetrySet(&rtcBlock.uptimeS, uptimeS);
+        }
+    if (recoveredAtStep >= 0 && recoveredAtStep < FASTLED_JAM_MAX_STEPS)
+        {
+        rtcTelemetryAdd(&rtcBlock.recoveredAtStep[recoveredAtStep], 1);
+        rtcTelemetryJam();
+        }
+    portEXIT_CRITICAL(&rtcTelemetryMux);
+    }
+
+
+void rtcTelemetryRecordWarmRestart(void)
+    {
+    portENTER_CRITICAL(&rtcTelemetryMux);
+    rtcTelemetryAdd(&rtcBlock.warmRestarts, 1);
+    portEXIT_CRITICAL(&rtcTelemetryMux);
+    }
+
+
+/// @brief Just before the jam watchdog's ESP.restart() (the jammed show never comes back).
+void rtcTelemetryRecordJamRestart(void)
+    {
+    uint32_t uptimeS = (uint32_t) (esp_timer_get_time() / 1000000);
+    portENTER_CRITICAL(&rtcTelemetryMux);
+    rtcTelemetrySet(&rtcBlock.uptimeS, uptimeS);
+    rtcTelemetryAdd(&rtcBlock.jamRestarts, 1);
+    rtcTelemetryJam();
+    portEXIT_CRITICAL(&rtcTelemetryMux);
+    }
+
+
+void rtcTelemetryGet(RtcTelemetryBlock* block)
+    {
+    portENTER_CRITICAL(&rtcTelemetryMux);
+    *block = rtcBlock;
+    portEXIT_CRITICAL(&rtcTelemetryMux);
+    }
+
+
+/// @brief Prints the block (or sends it as a record).
+void rtcTelemetryReport(void)
+    {
+#ifdef DEBUG_ON
+    RtcTelemetryBlock block;
+    rtcTelemetryGet(&block);
+    uint32_t totalS = block.totalUptimeS + block.uptimeS;
+# if DEBUG_BINARY_TELEMETRY
+    uint32_t values[] = { block.boots, block.jams, block.jamRestarts, totalS, block.lastResetReason };
+    telemetryEmit(TELEMETRY_RTC_REPORT, values);
+# else
+    DEBUG_START_SEMAPHORE_BLOCK
+        {
+        DEBUG_PRINT("RTC telemetry: boot ");
+        DEBUG_PRINT(block.boots);
+        DEBUG_PRINT(" (reset reason ");
+        DEBUG_PRINT(block.lastResetReason);
+        DEBUG_PRINT("), ");
+        DEBUG_PRINT(totalS);
+        DEBUG_PRINT(" s up in all, ");
+        DEBUG_PRINT(block.framesShown);
+        DEBUG_PRINTLN(" frames shown.");
+        DEBUG_PRINT("RTC telemetry: ");
+        DEBUG_PRINT(block.jams);
+        DEBUG_PRINT(" jams (");
+        DEBUG_PRINT(block.jamRestarts);
+        DEBUG_PRINT(" ended in a reboot, ");
+        DEBUG_PRINT(block.warmRestarts);
+        DEBUG_PRINT(" warm restarts), mean time between jams ");
+        DEBUG_PRINT(block.jams ? totalS / block.jams : totalS);
+        DEBUG_PRINT(" s, longest run ");
+        DEBUG_PRINT((totalS - block.lastJamUptimeS > block.longestRunS) ? totalS - block.lastJamUptimeS : block.longestRunS);
+        DEBUG_PRINTLN(" s.");
+        DEBUG_PRINT("RTC telemetry: jams recovered at step");
+        bool bAny = false;
+        for (uint8_t step = 0; step < FASTLED_JAM_MAX_STEPS; step++)
+            {
+            if (block.recoveredAtStep[step] > 0)
+                {
+                DEBUG_PRINT(" ");
+                DEBUG_PRINT(step);
+                DEBUG_PRINT(":");
+                DEBUG_PRINT(block.recoveredAtStep[step]);
+                bAny = true;
+                }
+            }
+        DEBUG_PRINTLN(bAny ? "." : " (none).");
+        DEBUG_SEMAPHORE_RELEASE;
+        }
+# endif
+#endif
+    }
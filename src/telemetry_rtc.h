@@ -0,0 +1,46 @@
+#ifndef _TELEMETRY_RTC_H_
+#define _TELEMETRY_RTC_H_
+
+#include <Arduino.h>
+#include "fastLedJamWatchdog.h"
+
+// Jam and restart counters that survive ESP.restart() (and watchdog resets),
+// kept in RTC slow memory (RTC_NOINIT_ATTR, so the bootloader doesn't clear
+// it).  After a power on it holds garbage, which the checksum catches, and
+// the block starts again from zero.
+//
+// The checksum is the negated sum of every other word, so the whole block
+// sums to zero and bumping a counter only has to take the same amount off
+// the checksum.  That keeps the per show update down to a few adds.
+//
+// rtcTelemetryBoot() checks the block (and folds the last boot's uptime into
+// the total) at the top of setup(), rtcTelemetryReport() prints it, at boot
+// and when 't' is typed.  Mean time between jams is totalUptimeS / jams.
+
+#define RTC_TELEMETRY_MAGIC     0x46544C31UL    // "FTL1", change if the layout does.
+
+typedef struct
+    {
+    uint32_t magic;
+    uint32_t boots;                 // Since the block was last started again.
+    uint32_t lastResetReason;       // esp_reset_reason() at this boot.
+    uint32_t jamRestarts;           // Reboots by the jam watchdog.
+    uint32_t warmRestarts;
+    uint32_t jams;                  // Shows that went past their deadline.
+    uint32_t recoveredAtStep[FASTLED_JAM_MAX_STEPS];   // Which ladder step got each jammed show going.
+    uint32_t framesShown;
+    uint32_t uptimeS;               // This boot so far.
+    uint32_t totalUptimeS;          // Earlier boots.
+    uint32_t lastJamUptimeS;        // Total uptime at the last jam.
+    uint32_t longestRunS;           // Longest uptime between jams.
+    uint32_t checksum;
+    } RtcTelemetryBlock;
+
+extern bool rtcTelemetryBoot(void);
+extern void rtcTelemetryRecordShow(int8_t recoveredAtStep);
+extern void rtcTelemetryRecordWarmRestart(void);
+extern void rtcTelemetryRecordJamRestart(void);
+extern void rtcTelemetryGet(RtcTelemetryBlock* block);
+extern void rtcTelemetryReport(void);
+
+#endif /* _TELEMETRY_RTC_H_ */
@@ -0,0 +1,380 @@
+// Host side encoder for the SPI ingest packets (see src/fastLedIngestFormat.h),
+// and a loopback that decodes them again as the ESP32 would.
+//
+// Build (Linux):
+//      g++ -std=c++17 -O2 -I src -o ingest_encode tools/ingest_encode.cpp src/fastLedIngestFormat.cpp
+// Use:
+//      ./ingest_encode [--in frames.rgb | --pattern stripes|sparse|fade|random] [--frames N]
+//                      [--encoding auto|raw|rle|xor] [--keyframe-every N] [--segments 256,256,470,470]
+//                      [--out packets.bin] [--loopback [--drop-rate R] [--seed S]] [--spi-mhz M]
+//
+// Frames are every segment's LEDs one after the other (r g b bytes), from
+// --in or made up by --pattern.  Each segment goes as packets of up to 508
+// LEDs.  With --encoding raw they are cut on 4 LED boundaries of the arena,
+// so the ESP32 can DMA them straight in.  --encoding auto sends each packet
+// whichever way is smallest.  Every --keyframe-every frames (and the first) no deltas are
+// used, so a receiver that lost something can start again.  --out writes
+// the packets as they go on the wire: each header, then its payload
+// padded to a word.
+//
+// --loopback puts the packets through the receiver and the decoder from the
+// firmware (dropping or corrupting --drop-rate of them) and checks every
+// frame it would show against the original.  It exits 1 if any differ.
+// The report is bytes and time per frame, and how long the SPI would take.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "fastLedIngestFormat.h"
+
+#define ENCODE_MAX_LEDS_PER_PACKET  508     // A multiple of 4, and literal RLE still fits.
+#define ENCODE_MATRIX_PERIOD_US     14150   // 470 LEDs x 30us + 50us, our slowest.
+
+typedef struct
+    {
+    std::vector<uint8_t> bytes;     // Header then payload, padded.
+    uint16_t payloadBytes;
+    uint8_t encoding;
+    } EncodePacket;
+
+static uint32_t randomState = 0x2545F491UL;
+
+/// @brief xorshift32, as fastLedRandomFill.h.
+static uint32_t encodeRandom(void)
+    {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return(randomState);
+    }
+
+
+/// @brief Starts encodeRandom() from a --seed, scrambled (the murmur3
+/// finaliser) so small seeds don't all start with tiny numbers.
+static void encodeRandomSeed(uint32_t seed)
+    {
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6BUL;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35UL;
+    seed ^= seed >> 16;
+    randomState = (seed != 0) ? seed : 0x2545F491UL;
+    }
+
+
+/// @brief Makes frame number n of a pattern, from the frame before (which it may keep some of).
+static bool encodePattern(const std::string& pattern, uint32_t n, std::vector<uint8_t>& frame)
+    {
+    size_t leds = frame.size() / INGEST_BYTES_PER_LED;
+    if (pattern == "random")
+        {
+        for (uint8_t& byte : frame)
+            {
+            byte = (uint8_t) encodeRandom();
+            }
+        }
+    else if (pattern == "sparse")   // A few percent of the LEDs change each frame.
+        {
+        for (size_t i = 0; i < ((n == 0) ? frame.size() : leds / 32); i++)
+            {
+            frame[(n == 0) ? i : (encodeRandom() % leds) * INGEST_BYTES_PER_LED + encodeRandom() % 3] = (uint8_t) encodeRandom();
+            }
+        }
+    else if (pattern == "fade")     // Everything the same colour, slowly changing.
+        {
+        for (size_t i = 0; i < leds; i++)
+            {
+            frame[i * 3] = (uint8_t) n;
+            frame[i * 3 + 1] = (uint8_t) (n / 2);
+            frame[i * 3 + 2] = (uint8_t) (255 - n);
+            }
+        }
+    else if (pattern == "stripes")  // Coloured bars moving along a dark background.
+        {
+        for (size_t i = 0; i < leds; i++)
+            {
+            size_t position = (i + n) % 48;
+            bool bLit = position < 12;
+            frame[i * 3] = bLit ? (uint8_t) (position * 20) : 0;
+            frame[i * 3 + 1] = bLit ? 64 : 0;
+            frame[i * 3 + 2] = bLit ? (uint8_t) (i / 48 * 16) : 2;
+            }
+        }
+    else
+        {
+        return(false);
+        }
+    return(true);
+    }
+
+
+/// @brief Encodes one packet.
+/// @param before The LEDs as the receiver has them, or NULL for no deltas.
+static EncodePacket encodePacket(const std::string& encoding, const uint8_t* leds, const uint8_t* before,
+                                 uint8_t segment, uint16_t offset, uint16_t count, uint8_t sequence, bool bEndOfFrame)
+    {
+    static uint8_t payloads[INGEST_ENCODINGS][INGEST_MAX_PAYLOAD_BYTES];
+    size_t lengths[INGEST_ENCODINGS] = { 0 };
+    bool bAuto = (encoding == "auto");
+    lengths[INGEST_RAW] = ingestEncodeRaw(leds, count, payloads[INGEST_RAW], INGEST_MAX_PAYLOAD_BYTES);
+    if (bAuto || encoding == "rle")
+        {
+        lengths[INGEST_RLE] = ingestEncodeRle(leds, count, payloads[INGEST_RLE], INGEST_MAX_PAYLOAD_BYTES);
+        }
+    if ((bAuto || encoding == "xor") && before != NULL)
+        {
+        lengths[INGEST_XOR] = ingestEncodeXor(leds, before, count, payloads[INGEST_XOR], INGEST_MAX_PAYLOAD_BYTES);
+        }
+    uint8_t best = INGEST_RAW;     // If nothing else fits (or it's a keyframe, for xor).
+    if (encoding == "rle" && lengths[INGEST_RLE] > 0)
+        {
+        best = INGEST_RLE;
+        }
+    else if (encoding == "xor" && lengths[INGEST_XOR] > 0)
+        {
+        best = INGEST_XOR;
+        }
+    for (uint8_t candidate = INGEST_RLE; bAuto && candidate < INGEST_ENCODINGS; candidate++)
+        {
+        if (lengths[candidate] > 0 && lengths[candidate] < lengths[best])
+            {
+            best = candidate;
+            }
+        }
+    FastLedIngestHeader header = { };
+    header.encoding = best;
+    header.flags = bEndOfFrame ? INGEST_FLAG_END_OF_FRAME : 0;
+    header.segment = segment;
+    header.sequence = sequence;
+    header.offset = offset;
+    header.count = count;
+    header.payloadBytes = (uint16_t) lengths[best];
+    header.payloadCheck = ingestPayloadCheck(payloads[best], lengths[best]);
+    EncodePacket packet;
+    packet.bytes.resize(INGEST_HEADER_BYTES + ingestPaddedBytes(lengths[best]), 0);
+    ingestPackHeader(packet.bytes.data(), &header);
+    memcpy(packet.bytes.data() + INGEST_HEADER_BYTES, payloads[best], lengths[best]);
+    packet.payloadBytes = header.payloadBytes;
+    packet.encoding = best;
+    return(packet);
+    }
+
+
+/// @brief The receiving end, as fastLedIngestTask() but into a copy of the LEDs.
+/// @return true if the packet ended a frame that would be shown.
+static bool encodeLoopback(FastLedIngestReceiver* receiver, const std::vector<uint16_t>& starts,
+                           std::vector<uint8_t>& mirror, const EncodePacket& packet)
+    {
+    FastLedIngestHeader header;
+    FastLedIngestResult result = ingestParseHeader(packet.bytes.data(), &header);
+    if (result != INGEST_OK)
+        {
+        ingestReceiverReject(receiver, result);
+        return(false);
+        }
+    result = ingestReceiverAccept(receiver, &header);
+    const uint8_t* payload = packet.bytes.data() + INGEST_HEADER_BYTES;
+    if (result == INGEST_OK && ingestPayloadCheck(payload, header.payloadBytes) != header.payloadCheck)
+        {
+        result = INGEST_BAD_PAYLOAD;
+        }
+    if (result == INGEST_OK)
+        {
+        uint8_t* leds = mirror.data() + (starts[header.segment] + header.offset) * INGEST_BYTES_PER_LED;
+        result = ingestDecode(header.encoding, payload, header.payloadBytes, leds, header.count);
+        }
+    return(ingestReceiverFinish(receiver, &header, result));
+    }
+
+
+static double encodeNowUs(void)
+    {
+    return(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+
+int main(int argc, char** argv)
+    {
+    const char* inName = nullptr;
+    const char* outName = nullptr;
+    std::string pattern = "stripes";
+    std::string encoding = "auto";
+    std::vector<uint16_t> lengths = { 256, 256, 470, 470 };
+    uint32_t frames = 600;
+    uint32_t keyframeEvery = 30;
+    bool bLoopback = false;
+    double dropRate = 0;
+    double spiMhz = 8;
+    for (int i = 1; i < argc; i++)
+        {
+        std::string arg = argv[i];
+        bool bValue = i + 1 < argc;
+        if (arg == "--in" && bValue) inName = argv[++i];
+        else if (arg == "--out" && bValue) outName = argv[++i];
+        else if (arg == "--pattern" && bValue) pattern = argv[++i];
+        else if (arg == "--encoding" && bValue) encoding = argv[++i];
+        else if (arg == "--frames" && bValue) frames = (uint32_t) atoi(argv[++i]);
+        else if (arg == "--keyframe-every" && bValue) keyframeEvery = (uint32_t) atoi(argv[++i]);
+        else if (arg == "--drop-rate" && bValue) dropRate = atof(argv[++i]);
+        else if (arg == "--seed" && bValue) encodeRandomSeed((uint32_t) strtoul(argv[++i], nullptr, 0));
+        else if (arg == "--spi-mhz" && bValue) spiMhz = atof(argv[++i]);
+        else if (arg == "--loopback") bLoopback = true;
+        else if (arg == "--segments" && bValue)
+            {
+            lengths.clear();
+            for (char* next = argv[++i]; *next != '\0'; )
+                {
+                lengths.push_back((uint16_t) strtoul(next, &next, 10));
+                next += (*next == ',') ? 1 : 0;
+                }
+            }
+        else
+            {
+            fprintf(stderr, "Usage: %s [--in frames.rgb | --pattern stripes|sparse|fade|random] [--frames N]\n"
+                            "       [--encoding auto|raw|rle|xor] [--keyframe-every N] [--segments 256,256,470,470]\n"
+                            "       [--out packets.bin] [--loopback [--drop-rate R] [--seed S]] [--spi-mhz M]\n", argv[0]);
+            return(2);
+            }
+        }
+    if (lengths.empty() || lengths.size() > INGEST_MAX_SEGMENTS
+        || (encoding != "auto" && encoding != "raw" && encoding != "rle" && encoding != "xor"))
+        {
+        fprintf(stderr, "Bad --segments or --encoding\n");
+        return(2);
+        }
+    std::vector<uint16_t> starts;
+    uint32_t arenaLeds = 0;
+    for (uint16_t length : lengths)
+        {
+        starts.push_back((uint16_t) arenaLeds);
+        arenaLeds += length;
+        }
+
+    std::ifstream in;
+    if (inName)
+        {
+        in.open(inName, std::ios::binary);
+        if (!in)
+            {
+            fprintf(stderr, "Can't open %s\n", inName);
+            return(1);
+            }
+        }
+    FILE* out = nullptr;
+    if (outName && (out = fopen(outName, "wb")) == nullptr)
+        {
+        fprintf(stderr, "Can't open %s\n", outName);
+        return(1);
+        }
+
+    std::vector<uint8_t> frame(arenaLeds * INGEST_BYTES_PER_LED, 0);
+    std::vector<uint8_t> sent(frame.size(), 0);     // What the receiver should have.
+    std::vector<uint8_t> mirror(frame.size(), 0);   // What the loopback has.
+    FastLedIngestReceiver receiver;
+    ingestReceiverInit(&receiver, lengths.data(), (uint8_t) lengths.size());
+    uint64_t packetCounts[INGEST_ENCODINGS] = { 0 };
+    uint64_t wireBytes = 0;
+    double encodeUs = 0;
+    double decodeUs = 0;
+    uint32_t mismatches = 0;
+    uint32_t dropped = 0;
+    uint8_t sequence = 0;
+    uint32_t n = 0;
+    for (; n < frames || inName; n++)
+        {
+        if (inName ? !in.read((char*) frame.data(), frame.size()) : !encodePattern(pattern, n, frame))
+            {
+            if (!inName)
+                {
+                fprintf(stderr, "No pattern %s\n", pattern.c_str());
+                return(2);
+                }
+            break;
+            }
+        bool bKeyframe = keyframeEvery == 0 ? n == 0 : n % keyframeEvery == 0;
+        std::vector<EncodePacket> packets;
+        double startUs = encodeNowUs();
+        for (uint8_t segment = 0; segment < lengths.size(); segment++)
+            {
+            uint16_t offset = 0;
+            while (offset < lengths[segment])
+                {
+                // Raw starts on a word of the arena (every 4 LEDs) where it can.
+                uint16_t leadIn = (4 - (starts[segment] + offset) % 4) % 4;
+                uint16_t count = (leadIn > 0 && encoding == "raw") ? leadIn : ENCODE_MAX_LEDS_PER_PACKET;
+                count = (count < lengths[segment] - offset) ? count : lengths[segment] - offset;
+                size_t at = (starts[segment] + offset) * INGEST_BYTES_PER_LED;
+                bool bLast = segment == lengths.size() - 1 && offset + count == lengths[segment];
+                packets.push_back(encodePacket(encoding, &frame[at], bKeyframe ? NULL : &sent[at],
+                                               segment, offset, count, sequence++, bLast));
+                offset += count;
+                }
+            }
+        encodeUs += encodeNowUs() - startUs;
+        sent = frame;
+        for (const EncodePacket& packet : packets)
+            {
+            packetCounts[packet.encoding]++;
+            wireBytes += packet.bytes.size();
+            if (out)
+                {
+                fwrite(packet.bytes.data(), 1, packet.bytes.size(), out);
+                }
+            if (!bLoopback)
+                {
+                continue;
+                }
+            EncodePacket received = packet;
+            if (dropRate > 0 && encodeRandom() < dropRate * 4294967296.0)
+                {
+                dropped++;
+                if (encodeRandom() & 1)
+                    {
+                    continue;   // Lost altogether.
+                    }
+                received.bytes[encodeRandom() % received.bytes.size()] ^= 0x10;   // Or corrupted.
+                }
+            startUs = encodeNowUs();
+            bool bShow = encodeLoopback(&receiver, starts, mirror, received);
+            decodeUs += encodeNowUs() - startUs;
+            if (bShow && mirror != frame)
+                {
+                mismatches++;
+                }
+            }
+        }
+    if (out)
+        {
+        fclose(out);
+        }
+
+    double rawBytes = (double) arenaLeds * INGEST_BYTES_PER_LED;
+    double bytesPerFrame = n ? (double) wireBytes / n : 0;
+    printf("%u frames of %u LEDs (%s), encoding %s, keyframe every %u\n",
+           n, arenaLeds, inName ? inName : pattern.c_str(), encoding.c_str(), keyframeEvery);
+    printf("  %.1f bytes/frame on the wire, %.1f%% of raw LEDs, packets raw %llu rle %llu xor %llu\n",
+           bytesPerFrame, 100.0 * bytesPerFrame / rawBytes, (unsigned long long) packetCounts[INGEST_RAW],
+           (unsigned long long) packetCounts[INGEST_RLE], (unsigned long long) packetCounts[INGEST_XOR]);
+    printf("  SPI at %.1f MHz: %.2f ms/frame (frame period %.2f ms)\n",
+           spiMhz, bytesPerFrame * 8 / (spiMhz * 1000), ENCODE_MATRIX_PERIOD_US / 1000.0);
+    printf("  encode %.2f us/frame", n ? encodeUs / n : 0);
+    if (bLoopback)
+        {
+        printf(", decode %.2f us/frame\n", n ? decodeUs / n : 0);
+        printf("loopback: %u shown, %u discarded, %u dropped or corrupted, %u wrong.", receiver.framesShown,
+               receiver.framesDiscarded, dropped, mismatches);
+        for (int result = 0; result < INGEST_RESULTS; result++)
+            {
+            if (receiver.results[result] > 0)
+                {
+                printf(" %s %u", ingestResultNames[result], receiver.results[result]);
+                }
+            }
+        }
+    printf("\n");
+    return((mismatches > 0) ? 1 : 0);
+    }
@@ -0,0 +1,154 @@
+// Host side decoder for the '~' telemetry lines (see src/telemetry_format.h).
+//
+// Build (Linux):
+//      g++ -std=c++17 -O2 -I src -o telemetry_decode tools/telemetry_decode.cpp
+// Use:
+//      ./telemetry_decode [--csv] [capture.log]      (reads stdin if no file)
+//
+// Text mode copies the capture through, replacing each record with a
+// readable line and keeping the monitor's "HH:MM:SS.mmm > " prefix.
+// CSV mode writes only the records, one row per field:
+//      host_time,device_ms,record,field,value
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "telemetry_format.h"
+
+/// @brief Splits off a PlatformIO monitor "time" filter prefix if there is one.
+static size_t hostTimePrefix(const std::string& line, std::string& hostTime)
+    {
+    // "12:34:42.509 > "
+    static const char pattern[] = "dd:dd:dd.ddd > ";
+    const size_t length = sizeof(pattern) - 1;
+    if (line.size() < length)
+        {
+        return(0);
+        }
+    for (size_t i = 0; i < length; i++)
+        {
+        bool bMatch = (pattern[i] == 'd') ? (line[i] >= '0' && line[i] <= '9') : (line[i] == pattern[i]);
+        if (!bMatch)
+            {
+            return(0);
+            }
+        }
+    hostTime = line.substr(0, 12);
+    return(length);
+    }
+
+
+static std::string formatValue(const TelemetryField& field, uint32_t value)
+    {
+    char buffer[300];
+    if (field.decimals == 0)
+        {
+        snprintf(buffer, sizeof(buffer), "%u", value);
+        }
+    else
+        {
+        uint32_t scale = 1;
+        for (int i = 0; i < field.decimals; i++)
+            {
+            scale *= 10;
+            }
+        snprintf(buffer, sizeof(buffer), "%u.%0*u", value / scale, field.decimals, value % scale);
+        }
+    return(buffer);
+    }
+
+
+int main(int argc, char** argv)
+    {
+    bool bCsv = false;
+    const char* fileName = nullptr;
+    for (int i = 1; i < argc; i++)
+        {
+        if (strcmp(argv[i], "--csv") == 0)
+            {
+            bCsv = true;
+            }
+        else if (argv[i][0] == '-')
+            {
+            fprintf(stderr, "Usage: %s [--csv] [capture.log]\n", argv[0]);
+            return(2);
+            }
+        else
+            {
+            fileName = argv[i];
+            }
+        }
+    std::ifstream file;
+    if (fileName)
+        {
+        file.open(fileName, std::ios::binary);
+        if (!file)
+            {
+            fprintf(stderr, "Can't open %s\n", fileName);
+            return(1);
+            }
+        }
+    std::istream& in = fileName ? file : std::cin;
+
+    if (bCsv)
+        {
+        printf("host_time,device_ms,record,field,value\n");
+        }
+    unsigned records = 0;
+    unsigned badRecords = 0;
+    std::string line;
+    while (std::getline(in, line))
+        {
+        while (!line.empty() && line.back() == '\r') // The monitor writes "\r\r\n".
+            {
+            line.pop_back();
+            }
+        std::string hostTime;
+        size_t start = hostTimePrefix(line, hostTime);
+        uint8_t record[TELEMETRY_MAX_RECORD_BYTES];
+        uint8_t id = 0;
+        uint32_t timestampMs = 0;
+        uint32_t values[TELEMETRY_MAX_FIELDS];
+        bool bRecord = false;
+        if (line.size() > start && line[start] == TELEMETRY_LINE_START)
+            {
+            size_t length = telemetryDecodeLine(line.c_str() + start + 1, line.size() - start - 1, record, sizeof(record));
+            bRecord = telemetryUnpackRecord(record, length, &id, &timestampMs, values);
+            if (!bRecord)
+                {
+                badRecords++;
+                }
+            }
+        if (!bRecord)
+            {
+            if (!bCsv)
+                {
+                printf("%s\n", line.c_str());
+                }
+            continue;
+            }
+        records++;
+        const TelemetryRecord& descriptor = telemetryRecords[id];
+        if (bCsv)
+            {
+            for (int field = 0; field < descriptor.fieldCount; field++)
+                {
+                printf("%s,%u,%s,%s,%s\n", hostTime.c_str(), timestampMs, descriptor.name,
+                       descriptor.fields[field].name, formatValue(descriptor.fields[field], values[field]).c_str());
+                }
+            }
+        else
+            {
+            printf("%s[%u.%03u] %s", line.substr(0, start).c_str(), timestampMs / 1000, timestampMs % 1000, descriptor.name);
+            for (int field = 0; field < descriptor.fieldCount; field++)
+                {
+                printf(" %s=%s", descriptor.fields[field].name, formatValue(descriptor.fields[field], values[field]).c_str());
+                }
+            printf("\n");
+            }
+        }
+    fprintf(stderr, "%u record(s) decoded, %u bad.\n", records, badRecords);
+    return(0);
+    }